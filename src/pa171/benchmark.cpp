@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <lyra/lyra.hpp>
+
+#include <pa171/compressed_image_io.hpp>
+#include <pa171/compression_options.hpp>
+#include <pa171/image_decoder.hpp>
+#include <pa171/image_encoder.hpp>
+#include <pa171/image_io.hpp>
+#include <pa171/transform/boundary.hpp>
+#include <pa171/utils/parallel.hpp>
+
+namespace
+{
+
+// Options of the loss level with each wavelet in place of the default one
+auto
+wavelet_options(unsigned const loss_level,
+                pa171::transform::boundary_extension const boundary)
+  -> std::vector<std::pair<char const*, pa171::compression_options>>
+{
+  auto options = pa171::loss_level_options(loss_level);
+  auto* const iwt = pa171::iwt_options(options);
+  if (iwt == nullptr)
+  {
+    return { { "none", options } };
+  }
+
+  iwt->boundary = boundary;
+
+  return { { "haar", pa171::with_wavelet(options, "haar") },
+           { "bior", pa171::with_wavelet(options, "bior") },
+           { "db4", pa171::with_wavelet(options, "db4") } };
+}
+
+// Seconds per call of function, over num_runs calls
+template<typename Function>
+auto
+time_per_run(unsigned const num_runs, Function&& function) -> double
+{
+  auto const start = std::chrono::steady_clock::now();
+  for (auto i = 0u; i < num_runs; ++i)
+  {
+    function();
+  }
+
+  auto const duration = std::chrono::steady_clock::now() - start;
+
+  return std::chrono::duration<double>(duration).count() / num_runs;
+}
+
+} // namespace
+
+auto
+main(int const argc, char const* const* const argv) -> int
+{
+  try
+  {
+    // Parse arguments
+    auto show_help = false;
+    auto loss_level = 8u;
+    auto num_runs = 5u;
+    auto boundary = std::string{ "periodic" };
+    auto num_threads = pa171::default_num_threads();
+    auto in_paths = std::vector<std::string>{};
+
+    auto const parser =
+      lyra::cli_parser{}
+        .add_argument(lyra::help(show_help))
+        .add_argument(
+          lyra::opt(loss_level, "level")
+            .name("-l")
+            .name("--loss-level")
+            .help(fmt::format(
+              "Compression level. 0 = lossless; default = {}; max = {}",
+              loss_level,
+              pa171::max_loss_level)))
+        .add_argument(lyra::opt(num_runs, "runs")
+                        .name("-r")
+                        .name("--runs")
+                        .help(fmt::format("Timed runs of each encoding and "
+                                          "decoding; default = {}",
+                                          num_runs)))
+        .add_argument(
+          lyra::opt(boundary, "extension")
+            .name("--boundary")
+            .choices("periodic", "symmetric")
+            .help("How the wavelets extend each row and column past their "
+                  "ends; symmetric = mirrored; default = periodic"))
+        .add_argument(
+          lyra::opt(num_threads, "threads")
+            .name("-j")
+            .name("--threads")
+            .help(fmt::format("Number of worker threads; default = {}",
+                              num_threads)))
+        .add_argument(lyra::arg(in_paths, "in")
+                        .cardinality(1, 0)
+                        .help("Input image paths"));
+
+    if (auto const parse_result = parser.parse(lyra::args(argc, argv));
+        not parse_result)
+    {
+      fmt::print(stderr, "{}\n", parse_result.errorMessage());
+      fmt::print("See --help for correct usage");
+
+      return EXIT_FAILURE;
+    }
+
+    if (show_help)
+    {
+      // Display usage and exit
+      fmt::print("{}", parser);
+
+      return EXIT_SUCCESS;
+    }
+
+    num_runs = std::max(num_runs, 1u);
+
+    auto const all_options = wavelet_options(
+      loss_level,
+      boundary == "symmetric"
+        ? pa171::transform::boundary_extension::symmetric
+        : pa171::transform::boundary_extension::periodic);
+
+    fmt::print("{:<24} {:<7} {:>8} {:>10} {:>10} {:>10}\n",
+               "image",
+               "wavelet",
+               "ratio",
+               "error",
+               "enc MB/s",
+               "dec MB/s");
+
+    for (auto const& in_path : in_paths)
+    {
+      auto width = std::size_t{};
+      auto height = std::size_t{};
+      auto const image_data =
+        pa171::read_grayscale_image(in_path, width, height);
+      auto const input = pa171::view_2d{ image_data.get(), width, height };
+      auto const original_size = width * height;
+
+      for (auto const& [name, options] : all_options)
+      {
+        auto encoder = pa171::image_encoder{};
+        pa171::apply_options(options, encoder);
+        encoder.set_num_threads(num_threads);
+
+        auto decoder = pa171::image_decoder{};
+        pa171::apply_options(options, decoder);
+        decoder.set_num_threads(num_threads);
+
+        auto compressed_data = std::vector<std::byte>{};
+        auto const encode_time = time_per_run(
+          num_runs,
+          [&]
+          {
+            compressed_data.clear();
+            encoder(input, compressed_data);
+          });
+
+        auto output = std::vector<std::uint8_t>(original_size);
+        auto const decode_time = time_per_run(
+          num_runs,
+          [&]
+          {
+            decoder(compressed_data,
+                    pa171::view_2d{ output.data(), width, height });
+          });
+
+        // Mean absolute error of the decoded image
+        auto error = 0.0;
+        for (auto i = std::size_t{ 0 }; i < original_size; ++i)
+        {
+          error += std::abs(static_cast<int>(output[i]) -
+                            static_cast<int>(image_data.get()[i]));
+        }
+
+        auto const megabytes = static_cast<double>(original_size) / 1e6;
+
+        fmt::print("{:<24} {:<7} {:>8.4f} {:>10.3f} {:>10.1f} {:>10.1f}\n",
+                   std::filesystem::path{ in_path }.filename().string(),
+                   name,
+                   static_cast<double>(compressed_data.size() +
+                                       pa171::header_size()) /
+                     static_cast<double>(original_size),
+                   error / static_cast<double>(original_size),
+                   megabytes / encode_time,
+                   megabytes / decode_time);
+      }
+    }
+  }
+  catch (std::exception const& error)
+  {
+    fmt::print(stderr, "{}\n", error.what());
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
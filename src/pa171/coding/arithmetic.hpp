@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pa171::coding::arithmetic
+{
+
+// Binary range coder with adaptive bit models (the carry handling follows
+// LZMA). The decoder reads exactly the bytes the encoder wrote.
+
+class decode_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+static constexpr auto probability_bits = 15u;
+static constexpr auto probability_scale =
+    std::uint32_t{ 1 } << probability_bits;
+
+// Estimates the probability of a zero bit as the mean of a quickly and a
+// slowly adapting estimate
+class bit_model
+{
+public:
+    [[nodiscard]] auto probability() const noexcept -> std::uint32_t
+    {
+        return (std::uint32_t{ fast_ } + slow_) >> 1u;
+    }
+
+    void update(bool const bit) noexcept
+    {
+        adapt<fast_shift>(fast_, bit);
+        adapt<slow_shift>(slow_, bit);
+    }
+
+private:
+    static constexpr auto fast_shift = 4u;
+    static constexpr auto slow_shift = 7u;
+
+    // Both stay within (0, probability_scale)
+    std::uint16_t fast_ = probability_scale / 2u;
+    std::uint16_t slow_ = probability_scale / 2u;
+
+    template<unsigned Shift>
+    static void adapt(std::uint16_t& probability, bool const bit) noexcept
+    {
+        if (bit)
+        {
+            probability -= static_cast<std::uint16_t>(probability >> Shift);
+        }
+        else
+        {
+            probability += static_cast<std::uint16_t>(
+                (probability_scale - probability) >> Shift);
+        }
+    }
+};
+
+static constexpr auto range_top = std::uint32_t{ 1 } << 24u;
+
+class range_encoder
+{
+public:
+    // Appends to output
+    explicit range_encoder(std::vector<std::byte>& output) noexcept
+        : output_{ output }
+    {
+    }
+
+    void encode(bit_model& model, bool const bit)
+    {
+        auto const bound = (range_ >> probability_bits) * model.probability();
+
+        if (bit)
+        {
+            low_ += bound;
+            range_ -= bound;
+        }
+        else
+        {
+            range_ = bound;
+        }
+
+        model.update(bit);
+
+        while (range_ < range_top)
+        {
+            range_ <<= 8u;
+            shift_low();
+        }
+    }
+
+    // Writes the rest of the state; the encoder must not be used afterwards
+    void finish()
+    {
+        for (auto i = 0; i < 5; ++i)
+        {
+            shift_low();
+        }
+    }
+
+private:
+    std::vector<std::byte>& output_;
+    std::uint64_t low_ = 0u;
+    std::uint32_t range_ = 0xFFFF'FFFFu;
+    // Top byte not written yet, followed by pending_ - 1 bytes of 0xFF, all of
+    // which a carry may still increment
+    std::uint8_t cache_ = 0u;
+    std::uint64_t pending_ = 1u;
+
+    void shift_low()
+    {
+        if (low_ < 0xFF00'0000u or low_ > 0xFFFF'FFFFu)
+        {
+            auto const carry = static_cast<std::uint8_t>(low_ >> 32u);
+            auto value = cache_;
+
+            do
+            {
+                output_.push_back(static_cast<std::byte>(value + carry));
+                value = 0xFFu;
+            } while (--pending_ != 0u);
+
+            cache_ = static_cast<std::uint8_t>(low_ >> 24u);
+        }
+
+        ++pending_;
+        low_ = (low_ & 0x00FF'FFFFu) << 8u;
+    }
+};
+
+class range_decoder
+{
+public:
+    // With allow_truncation, input may be a prefix of a stream: bytes past its
+    // end read as zeros instead of failing, see truncated()
+    explicit range_decoder(std::span<std::byte const> const input,
+                           bool const allow_truncation = false)
+        : input_{ input }
+        , allow_truncation_{ allow_truncation }
+    {
+        for (auto i = 0; i < 5; ++i)
+        {
+            code_ = (code_ << 8u) | next_byte();
+        }
+    }
+
+    [[nodiscard]] auto decode(bit_model& model) -> bool
+    {
+        auto const bound = (range_ >> probability_bits) * model.probability();
+        auto const bit = code_ >= bound;
+
+        if (bit)
+        {
+            code_ -= bound;
+            range_ -= bound;
+        }
+        else
+        {
+            range_ = bound;
+        }
+
+        model.update(bit);
+
+        while (range_ < range_top)
+        {
+            range_ <<= 8u;
+            code_ = (code_ << 8u) | next_byte();
+        }
+
+        return bit;
+    }
+
+    // Whether all input was read, as it is after decoding everything encoded
+    [[nodiscard]] auto finished() const noexcept -> bool
+    {
+        return input_.empty();
+    }
+
+    // Whether a byte past the end of a truncated input was read. Until then,
+    // every decision matches the encoded one; later ones need not.
+    [[nodiscard]] auto truncated() const noexcept -> bool
+    {
+        return truncated_;
+    }
+
+private:
+    std::span<std::byte const> input_;
+    bool allow_truncation_;
+    bool truncated_ = false;
+    std::uint32_t code_ = 0u;
+    std::uint32_t range_ = 0xFFFF'FFFFu;
+
+    auto next_byte() -> std::uint32_t
+    {
+        if (input_.empty())
+        {
+            if (not allow_truncation_)
+            {
+                throw decode_error{ "Unexpected end of input" };
+            }
+
+            truncated_ = true;
+            return 0u;
+        }
+
+        auto const value = std::to_integer<std::uint32_t>(input_.front());
+        input_ = input_.subspan(1u);
+        return value;
+    }
+};
+
+} // namespace pa171::coding::arithmetic
@@ -0,0 +1 @@
+#include <pa171/coding/bitpack_base.hpp>
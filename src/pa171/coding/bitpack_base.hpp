@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include <pa171/quantization/subband.hpp>
+
+namespace pa171::coding::bitpack
+{
+
+// Stores each block of block_size values with the fewest bits that hold all
+// of them, as in FastPFor's SIMD-BP128. Signed values are zig-zag encoded
+// first (0, -1, 1, -2, ... become 0, 1, 2, 3, ...) so that small magnitudes
+// need few bits; the samples of untransformed regions are packed as they are.
+//
+// The subband layout only tells signed values from samples: blocks run on
+// across subbands, as most of them are too small for blocks of their own,
+// and the last block of each segment of the same signedness is padded with
+// zeros. Without a subband layout, the input is all signed.
+//
+// A stream holds the input size (uint64 LE), then for each block its bit
+// width (a byte, at most max_width) and its packed values. Values are laid
+// out vertically over block_lanes byte lanes, value i in lane i % block_lanes:
+// each lane concatenates the bits of its values, the first one lowest, and
+// byte j of lane l is stored at j * block_lanes + l. A block of width w thus
+// packs into w vectors of block_lanes bytes, with only shifts within lanes.
+
+static constexpr auto block_size = std::size_t{ 128 };
+static constexpr auto block_lanes = std::size_t{ 16 };
+static constexpr auto values_per_lane = block_size / block_lanes;
+static constexpr auto max_width = 8u;
+
+class decode_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+[[nodiscard]] constexpr auto packed_size(unsigned const width) noexcept
+    -> std::size_t
+{
+    return width * block_lanes;
+}
+
+[[nodiscard]] constexpr auto zig_zag(std::uint8_t const value) noexcept
+    -> std::uint8_t
+{
+    return static_cast<std::uint8_t>((value << 1u) ^
+                                     ((value & 0x80u) != 0u ? 0xFFu : 0u));
+}
+
+[[nodiscard]] constexpr auto unzig_zag(std::uint8_t const value) noexcept
+    -> std::uint8_t
+{
+    return static_cast<std::uint8_t>((value >> 1u) ^ (0u - (value & 1u)));
+}
+
+// Calls f(offset, size, is_signed) for each segment of consecutive subbands
+// of the same signedness, in data of the given size laid out as the
+// subbands; throws std::invalid_argument unless they cover the data exactly
+template<typename F>
+void for_each_segment(std::size_t const size,
+                      std::span<quantization::subband const> const subbands,
+                      F&& f)
+{
+    auto segment_offset = std::size_t{ 0 };
+    auto offset = std::size_t{ 0 };
+    auto is_signed = true;
+
+    for (auto const& band : subbands)
+    {
+        if (band.size() > size - offset)
+        {
+            throw std::invalid_argument{ "Subbands exceed the data" };
+        }
+
+        auto const band_is_signed =
+            band.kind != quantization::subband_kind::samples;
+        if (band_is_signed != is_signed)
+        {
+            if (offset != segment_offset)
+            {
+                f(segment_offset, offset - segment_offset, is_signed);
+            }
+
+            segment_offset = offset;
+            is_signed = band_is_signed;
+        }
+
+        offset += band.size();
+    }
+
+    if (not subbands.empty() and offset != size)
+    {
+        throw std::invalid_argument{ "Subbands do not cover the data" };
+    }
+
+    if (size != segment_offset)
+    {
+        f(segment_offset, size - segment_offset, is_signed);
+    }
+}
+
+} // namespace pa171::coding::bitpack
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include <pa171/coding/bitpack_base.hpp>
+#include <pa171/quantization/subband.hpp>
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/simd.hpp>
+
+namespace pa171::coding::bitpack
+{
+
+// Unpacks blocks with SSE2 where available; the scalar path decodes the same
+// output
+class decoder
+{
+public:
+    explicit decoder(bool const allow_simd = true)
+        : use_simd_{ allow_simd and has_sse2() }
+    {
+    }
+
+    // Decodes a whole stream into output, laid out as the given subbands, and
+    // returns the decoded size; throws if the stream is invalid or does not
+    // match the subbands
+    auto operator()(std::span<std::byte const> input,
+                    std::span<quantization::subband const> const subbands,
+                    std::span<std::byte> const output) const -> std::size_t
+    {
+        if (input.size() < sizeof(std::uint64_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto const size = load_le<std::uint64_t>(input.data());
+        input = input.subspan(sizeof(std::uint64_t));
+
+        if (size > output.size())
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        auto first = input.data();
+        auto const last = first + input.size();
+
+        try
+        {
+            for_each_segment(
+                static_cast<std::size_t>(size),
+                subbands,
+                [&](std::size_t const offset,
+                    std::size_t const band_size,
+                    bool const is_signed)
+                {
+                    auto result = output.data() + offset;
+                    auto const result_last = result + band_size;
+
+                    while (result != result_last)
+                    {
+                        if (first == last)
+                        {
+                            throw decode_error{ "Unexpected end of input" };
+                        }
+
+                        auto const width = std::to_integer<unsigned>(*first++);
+                        if (width > max_width)
+                        {
+                            throw decode_error{ "Invalid bit width" };
+                        }
+
+                        if (static_cast<std::size_t>(last - first) <
+                            packed_size(width))
+                        {
+                            throw decode_error{ "Unexpected end of input" };
+                        }
+
+                        if (static_cast<std::size_t>(result_last - result) >=
+                            block_size)
+                        {
+                            decode_block(first, width, is_signed, result);
+                            result += block_size;
+                        }
+                        else
+                        {
+                            auto padded = std::array<std::byte, block_size>{};
+                            decode_block(
+                                first, width, is_signed, padded.data());
+                            result = std::copy(padded.begin(),
+                                               padded.begin() +
+                                                   (result_last - result),
+                                               result);
+                        }
+
+                        first += packed_size(width);
+                    }
+                });
+        }
+        catch (std::invalid_argument const&)
+        {
+            throw decode_error{ "Stream does not match the subbands" };
+        }
+
+        if (first != last)
+        {
+            throw decode_error{ "Invalid bit packed stream" };
+        }
+
+        return static_cast<std::size_t>(size);
+    }
+
+private:
+    bool use_simd_;
+
+    // Writes the block_size values of the block packed at input
+    void decode_block(std::byte const* const input,
+                      unsigned const width,
+                      bool const is_signed,
+                      std::byte* const values) const
+    {
+#ifdef PA171_X86_SIMD
+        if (use_simd_)
+        {
+            unpack_sse2(input,
+                        width,
+                        is_signed,
+                        values,
+                        std::make_index_sequence<max_width + 1u>{});
+            return;
+        }
+#endif
+
+        decode_block_scalar(input, width, is_signed, values);
+    }
+
+    static void decode_block_scalar(std::byte const* const input,
+                                    unsigned const width,
+                                    bool const is_signed,
+                                    std::byte* const values)
+    {
+        auto const mask = (1u << width) - 1u;
+
+        for (auto lane = std::size_t{ 0 }; lane < block_lanes; ++lane)
+        {
+            auto bits = std::uint64_t{ 0 };
+            for (auto j = std::size_t{ 0 }; j < width; ++j)
+            {
+                bits |= std::to_integer<std::uint64_t>(
+                            input[j * block_lanes + lane])
+                        << (8u * j);
+            }
+
+            for (auto i = std::size_t{ 0 }; i < values_per_lane; ++i)
+            {
+                auto const value =
+                    static_cast<std::uint8_t>((bits >> (i * width)) & mask);
+                values[i * block_lanes + lane] = static_cast<std::byte>(
+                    is_signed ? unzig_zag(value) : value);
+            }
+        }
+    }
+
+#ifdef PA171_X86_SIMD
+    template<std::size_t... Widths>
+    PA171_TARGET_SSE2 static void unpack_sse2(std::byte const* const input,
+                                              unsigned const width,
+                                              bool const is_signed,
+                                              std::byte* const values,
+                                              std::index_sequence<Widths...>)
+    {
+        ((width == Widths
+              ? unpack_sse2<Widths>(input,
+                                    is_signed,
+                                    values,
+                                    std::make_index_sequence<values_per_lane>{})
+              : void()),
+         ...);
+    }
+
+    template<std::size_t Width, std::size_t... Indices>
+    PA171_TARGET_SSE2 static void unpack_sse2(std::byte const* const input,
+                                              bool const is_signed,
+                                              std::byte* const values,
+                                              std::index_sequence<Indices...>)
+    {
+        // One more vector than needed, as the array cannot be empty
+        __m128i packed[Width + 1u] = {};
+        for (auto j = std::size_t{ 0 }; j < Width; ++j)
+        {
+            packed[j] = _mm_loadu_si128(
+                reinterpret_cast<__m128i const*>(input + j * block_lanes));
+        }
+
+        (unpack_value_sse2<Width, Indices>(
+             packed, is_signed, values + Indices * block_lanes),
+         ...);
+    }
+
+    // Extracts value Index of each lane from their bits
+    template<std::size_t Width, std::size_t Index>
+    PA171_TARGET_SSE2 static void
+    unpack_value_sse2(__m128i const (&packed)[Width + 1u],
+                      bool const is_signed,
+                      std::byte* const output)
+    {
+        constexpr auto position = Index * Width;
+        constexpr auto byte = position / 8u;
+        constexpr auto shift = static_cast<int>(position % 8u);
+
+        auto value = _mm_and_si128(
+            _mm_srli_epi16(packed[byte], shift),
+            _mm_set1_epi8(static_cast<char>((0xFFu >> shift) &
+                                            ((1u << Width) - 1u))));
+
+        if constexpr (shift + Width > 8u)
+        {
+            value = _mm_or_si128(
+                value,
+                _mm_and_si128(_mm_slli_epi16(packed[byte + 1u], 8 - shift),
+                              _mm_set1_epi8(static_cast<char>(
+                                  (0xFFu << (8 - shift)) &
+                                  ((1u << Width) - 1u)))));
+        }
+
+        if (is_signed)
+        {
+            value = _mm_xor_si128(
+                _mm_and_si128(_mm_srli_epi16(value, 1), _mm_set1_epi8(0x7F)),
+                _mm_sub_epi8(_mm_setzero_si128(),
+                             _mm_and_si128(value, _mm_set1_epi8(1))));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output), value);
+    }
+#endif
+};
+
+} // namespace pa171::coding::bitpack
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <pa171/coding/bitpack_base.hpp>
+#include <pa171/quantization/subband.hpp>
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/simd.hpp>
+
+namespace pa171::coding::bitpack
+{
+
+// Packs blocks with SSE2 where available; the scalar path writes the same
+// stream
+class encoder
+{
+public:
+    explicit encoder(bool const allow_simd = true)
+        : use_simd_{ allow_simd and has_sse2() }
+    {
+    }
+
+    // Appends the coded input, laid out as the given subbands, to output
+    void operator()(std::span<std::byte const> const input,
+                    std::span<quantization::subband const> const subbands,
+                    std::vector<std::byte>& output) const
+    {
+        // Reserve the worst case: every subband may end with a partial block
+        auto const max_blocks =
+            input.size() / block_size + subbands.size() + 1u;
+        auto const output_offset = output.size();
+        output.resize(output_offset + sizeof(std::uint64_t) +
+                      max_blocks * (1u + packed_size(max_width)));
+        store_le(output.data() + output_offset,
+                 static_cast<std::uint64_t>(input.size()));
+
+        auto position = output.data() + output_offset + sizeof(std::uint64_t);
+
+        for_each_segment(
+            input.size(),
+            subbands,
+            [&](std::size_t const offset,
+                std::size_t const size,
+                bool const is_signed)
+            {
+                auto values = input.subspan(offset, size);
+                for (; values.size() >= block_size;
+                     values = values.subspan(block_size))
+                {
+                    position = encode_block(values.data(), is_signed, position);
+                }
+
+                if (not values.empty())
+                {
+                    auto padded = std::array<std::byte, block_size>{};
+                    std::ranges::copy(values, padded.begin());
+                    position = encode_block(padded.data(), is_signed, position);
+                }
+            });
+
+        output.resize(static_cast<std::size_t>(position - output.data()));
+    }
+
+private:
+    bool use_simd_;
+
+    // Writes the block of block_size values and returns the end of its output
+    auto encode_block(std::byte const* const values,
+                      bool const is_signed,
+                      std::byte* const output) const -> std::byte*
+    {
+#ifdef PA171_X86_SIMD
+        if (use_simd_)
+        {
+            return encode_block_sse2(values, is_signed, output);
+        }
+#endif
+
+        return encode_block_scalar(values, is_signed, output);
+    }
+
+    static auto encode_block_scalar(std::byte const* const values,
+                                    bool const is_signed,
+                                    std::byte* output) -> std::byte*
+    {
+        auto coded = std::array<std::uint8_t, block_size>{};
+        auto all_bits = 0u;
+        for (auto i = std::size_t{ 0 }; i < block_size; ++i)
+        {
+            auto const value = std::to_integer<std::uint8_t>(values[i]);
+            coded[i] = is_signed ? zig_zag(value) : value;
+            all_bits |= coded[i];
+        }
+
+        auto const width = static_cast<unsigned>(std::bit_width(all_bits));
+        *output++ = static_cast<std::byte>(width);
+
+        for (auto lane = std::size_t{ 0 }; lane < block_lanes; ++lane)
+        {
+            auto bits = std::uint64_t{ 0 };
+            for (auto i = std::size_t{ 0 }; i < values_per_lane; ++i)
+            {
+                bits |= std::uint64_t{ coded[i * block_lanes + lane] }
+                        << (i * width);
+            }
+
+            for (auto j = std::size_t{ 0 }; j < width; ++j)
+            {
+                output[j * block_lanes + lane] =
+                    static_cast<std::byte>(bits >> (8u * j));
+            }
+        }
+
+        return output + packed_size(width);
+    }
+
+#ifdef PA171_X86_SIMD
+    // Plain arrays, as std::array would drop the vector type's attributes
+    using vector_block = __m128i[values_per_lane];
+
+    PA171_TARGET_SSE2 static auto encode_block_sse2(
+        std::byte const* const values,
+        bool const is_signed,
+        std::byte* output) -> std::byte*
+    {
+        vector_block coded;
+        auto all_bits = _mm_setzero_si128();
+        for (auto i = std::size_t{ 0 }; i < values_per_lane; ++i)
+        {
+            coded[i] = _mm_loadu_si128(
+                reinterpret_cast<__m128i const*>(values + i * block_lanes));
+
+            if (is_signed)
+            {
+                coded[i] = _mm_xor_si128(
+                    _mm_add_epi8(coded[i], coded[i]),
+                    _mm_cmpgt_epi8(_mm_setzero_si128(), coded[i]));
+            }
+
+            all_bits = _mm_or_si128(all_bits, coded[i]);
+        }
+
+        all_bits = _mm_or_si128(all_bits, _mm_srli_si128(all_bits, 8));
+        all_bits = _mm_or_si128(all_bits, _mm_srli_si128(all_bits, 4));
+        all_bits = _mm_or_si128(all_bits, _mm_srli_si128(all_bits, 2));
+        all_bits = _mm_or_si128(all_bits, _mm_srli_si128(all_bits, 1));
+
+        auto const width = static_cast<unsigned>(std::bit_width(
+            static_cast<std::uint8_t>(_mm_cvtsi128_si32(all_bits))));
+        *output++ = static_cast<std::byte>(width);
+
+        pack_sse2(coded,
+                  width,
+                  output,
+                  std::make_index_sequence<max_width + 1u>{});
+
+        return output + packed_size(width);
+    }
+
+    template<std::size_t... Widths>
+    PA171_TARGET_SSE2 static void pack_sse2(vector_block const& values,
+                                            unsigned const width,
+                                            std::byte* const output,
+                                            std::index_sequence<Widths...>)
+    {
+        ((width == Widths
+              ? pack_sse2<Widths>(
+                    values, output, std::make_index_sequence<values_per_lane>{})
+              : void()),
+         ...);
+    }
+
+    template<std::size_t Width, std::size_t... Indices>
+    PA171_TARGET_SSE2 static void pack_sse2(vector_block const& values,
+                                            std::byte* const output,
+                                            std::index_sequence<Indices...>)
+    {
+        if constexpr (Width != 0u)
+        {
+            __m128i packed[Width] = {};
+            (pack_value_sse2<Width, Indices>(values[Indices], packed), ...);
+
+            for (auto j = std::size_t{ 0 }; j < Width; ++j)
+            {
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(output + j * block_lanes),
+                    packed[j]);
+            }
+        }
+    }
+
+    // Adds value Index of each lane to its bits
+    template<std::size_t Width, std::size_t Index>
+    PA171_TARGET_SSE2 static void
+    pack_value_sse2(__m128i const value, __m128i (&packed)[Width])
+    {
+        // There are no byte shifts: shift the 16 bit lanes and drop the bits
+        // that cross into the neighbouring byte
+        constexpr auto position = Index * Width;
+        constexpr auto byte = position / 8u;
+        constexpr auto shift = static_cast<int>(position % 8u);
+
+        packed[byte] = _mm_or_si128(
+            packed[byte],
+            _mm_and_si128(_mm_slli_epi16(value, shift),
+                          _mm_set1_epi8(static_cast<char>(0xFFu << shift))));
+
+        if constexpr (shift + Width > 8u)
+        {
+            packed[byte + 1u] = _mm_or_si128(
+                packed[byte + 1u],
+                _mm_and_si128(
+                    _mm_srli_epi16(value, 8 - shift),
+                    _mm_set1_epi8(static_cast<char>(0xFFu >> (8 - shift)))));
+        }
+    }
+#endif
+};
+
+} // namespace pa171::coding::bitpack
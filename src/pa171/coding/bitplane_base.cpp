@@ -0,0 +1 @@
+#include <pa171/coding/bitplane_base.hpp>
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/quantization/subband.hpp>
+
+namespace pa171::coding::bitplane
+{
+
+// Embedded coder for the subbands of transformed regions: the magnitudes of
+// all values are coded one bit plane at a time, from the most significant
+// one, so that any prefix of a stream decodes to the values with their lower
+// bits unknown (and reconstructed at the middle of their possible range).
+//
+// A value one level coarser affects four times as many pixels, so the planes
+// of coarser subbands come earlier: pass k codes plane k - l of the subbands
+// of level l. Each pass visits the regions in order, and within a region its
+// subbands from the approximation to the finest level. A value that is still
+// zero is coded as a significance decision, in contexts selected by its
+// subband and by the significance of its four neighbours and of its parent
+// (the value at the same place one level coarser); its sign follows once it
+// becomes nonzero, and later passes refine its magnitude. Each subband
+// first codes the number of planes its magnitudes need, so that empty high
+// planes cost nothing. Untransformed samples are coded as signed values,
+// with their top bit flipped.
+//
+// A stream is the range coder output alone; its size follows from the
+// subbands.
+
+using arithmetic::decode_error;
+
+static constexpr auto num_planes = 8u;
+static constexpr auto num_level_classes = std::size_t{ 4 };
+// Approximations and samples, then details by orientation and level class
+static constexpr auto num_band_classes = 1u + 3u * num_level_classes;
+// Number of significant neighbours, 0 to 4
+static constexpr auto num_neighbour_classes = std::size_t{ 5 };
+
+// Codes the values of the given subbands, which must cover the data exactly.
+// code_bit(model, bit) codes a single decision: an encoder codes the given
+// bit and returns it, a decoder returns the decoded bit. Before each
+// decision, stop() tells whether to stop coding, as a decoder of a truncated
+// stream does once its decisions are no longer reliable. With mutable data,
+// the values are stored at the end, from the bits coded until then.
+class model
+{
+public:
+    template<typename T, typename CodeBit, typename Stop>
+    requires std::same_as<std::remove_const_t<T>, std::byte> and
+             std::invocable<CodeBit&, arithmetic::bit_model&, bool> and
+             std::predicate<Stop&>
+    void code(std::span<T> const data,
+              std::span<quantization::subband const> const subbands,
+              CodeBit&& code_bit,
+              Stop&& stop)
+    {
+        init_bands(data.size(), subbands);
+        init_values(data);
+
+        significance_.fill({});
+        sign_.fill({});
+        refinement_.fill({});
+        plane_counts_.fill({});
+
+        // Coded down to stop_pass_ before the stop position, one pass less
+        // from there on
+        stop_pass_ = 0u;
+        stop_band_ = bands_.size();
+        stop_index_ = 0u;
+
+        if (code_plane_counts(code_bit, stop))
+        {
+            for (auto pass = num_planes + max_shift_; pass > 0u; --pass)
+            {
+                if (not code_pass(pass - 1u, code_bit, stop))
+                {
+                    break;
+                }
+            }
+        }
+
+        if constexpr (not std::is_const_v<T>)
+        {
+            store_values(data);
+        }
+    }
+
+private:
+    struct band_info
+    {
+        std::size_t offset;
+        std::size_t width;
+        std::size_t height;
+        std::size_t band_class;
+        std::uint8_t flip;
+        // Index of the parent subband
+        std::optional<std::size_t> parent;
+        // Passes before the one coding the lowest plane
+        unsigned shift;
+        unsigned num_planes;
+    };
+
+    // Flags of a value
+    static constexpr auto significant = std::uint8_t{ 1 };
+    static constexpr auto negative = std::uint8_t{ 2 };
+    static constexpr auto refined = std::uint8_t{ 4 };
+
+    using plane_count_contexts = std::array<arithmetic::bit_model, 16>;
+
+    std::array<std::array<std::array<arithmetic::bit_model, 2>,
+                          num_neighbour_classes>,
+               num_band_classes>
+        significance_;
+    std::array<arithmetic::bit_model, num_band_classes> sign_;
+    std::array<std::array<arithmetic::bit_model, 2>, num_band_classes>
+        refinement_;
+    std::array<plane_count_contexts, num_band_classes> plane_counts_;
+
+    // Subbands in coding order
+    std::vector<band_info> bands_;
+    std::vector<std::uint8_t> magnitudes_;
+    std::vector<std::uint8_t> flags_;
+
+    unsigned max_shift_ = 0u;
+    unsigned stop_pass_ = 0u;
+    std::size_t stop_band_ = 0u;
+    std::size_t stop_index_ = 0u;
+
+    void init_bands(std::size_t const size,
+                    std::span<quantization::subband const> const subbands)
+    {
+        bands_.clear();
+        max_shift_ = 0u;
+
+        auto region_offset = std::size_t{ 0 };
+        auto region_first = subbands.begin();
+
+        for (auto it = subbands.begin(); it != subbands.end(); ++it)
+        {
+            if (it->kind != quantization::subband_kind::approximation and
+                it->kind != quantization::subband_kind::samples)
+            {
+                continue;
+            }
+
+            // The approximation (or the samples) ends a region; its subbands
+            // are coded in reverse, so that parents precede their children
+            auto const region = std::span{ region_first, it + 1 };
+            auto region_size = std::size_t{ 0 };
+            for (auto const& band : region)
+            {
+                region_size += band.size();
+            }
+
+            if (region_size > size - region_offset)
+            {
+                throw std::invalid_argument{ "Subbands exceed the data" };
+            }
+
+            auto const approximation = bands_.size();
+            auto parents = std::array<std::size_t, 3>{
+                approximation, approximation, approximation
+            };
+
+            auto offset = region_offset + region_size;
+            for (auto i = region.size(); i > 0u; --i)
+            {
+                auto const& band = region[i - 1u];
+                offset -= band.size();
+
+                auto info = band_info{ .offset = offset,
+                                       .width = band.width,
+                                       .height = band.height,
+                                       .band_class = 0u,
+                                       .flip = 0u,
+                                       .parent = std::nullopt,
+                                       .shift = 0u,
+                                       .num_planes = 0u };
+
+                if (band.kind == quantization::subband_kind::samples)
+                {
+                    info.flip = 0x80u;
+                }
+                else
+                {
+                    info.shift = static_cast<unsigned>(band.level);
+                    max_shift_ = std::max(max_shift_, info.shift);
+                }
+
+                if (band.kind != quantization::subband_kind::samples and
+                    band.kind != quantization::subband_kind::approximation)
+                {
+                    auto const orientation =
+                        static_cast<std::size_t>(band.kind);
+                    info.band_class =
+                        1u + orientation * num_level_classes +
+                        std::min(band.level, num_level_classes - 1u);
+                    info.parent = parents[orientation];
+                    parents[orientation] = bands_.size();
+                }
+
+                bands_.push_back(info);
+            }
+
+            region_offset += region_size;
+            region_first = it + 1;
+        }
+
+        if (region_first != subbands.end() or region_offset != size)
+        {
+            throw std::invalid_argument{ "Subbands do not cover the data" };
+        }
+    }
+
+    template<typename T>
+    void init_values(std::span<T> const data)
+    {
+        magnitudes_.assign(data.size(), 0u);
+        flags_.assign(data.size(), 0u);
+
+        if constexpr (std::is_const_v<T>)
+        {
+            for (auto& band : bands_)
+            {
+                auto all_bits = 0u;
+                for (auto i = band.offset;
+                     i < band.offset + band.width * band.height;
+                     ++i)
+                {
+                    auto const value = static_cast<std::int8_t>(
+                        std::to_integer<std::uint8_t>(data[i]) ^ band.flip);
+                    magnitudes_[i] =
+                        static_cast<std::uint8_t>(std::abs(int{ value }));
+                    flags_[i] = value < 0 ? negative : 0u;
+                    all_bits |= magnitudes_[i];
+                }
+
+                band.num_planes =
+                    static_cast<unsigned>(std::bit_width(all_bits));
+            }
+        }
+    }
+
+    // Codes the number of planes of each subband; returns false if stopped
+    template<typename CodeBit, typename Stop>
+    auto code_plane_counts(CodeBit& code_bit, Stop& stop) -> bool
+    {
+        for (auto& band : bands_)
+        {
+            // As a binary tree of 4 decisions
+            auto& contexts = plane_counts_[band.band_class];
+            auto node = 1u;
+            for (auto bit = 4u; bit > 0u; --bit)
+            {
+                if (stop())
+                {
+                    stop_pass_ = num_planes + max_shift_ - 1u;
+                    stop_band_ = 0u;
+                    return false;
+                }
+
+                auto const value =
+                    code_bit(contexts[node],
+                             ((band.num_planes >> (bit - 1u)) & 1u) != 0u);
+                node = 2u * node + (value ? 1u : 0u);
+            }
+
+            band.num_planes = node - 16u;
+            if (band.num_planes > num_planes)
+            {
+                throw decode_error{ "Invalid number of bit planes" };
+            }
+        }
+
+        return true;
+    }
+
+    // Codes a plane of each subband that has it; returns false if stopped
+    template<typename CodeBit, typename Stop>
+    auto code_pass(unsigned const pass, CodeBit& code_bit, Stop& stop) -> bool
+    {
+        for (auto b = std::size_t{ 0 }; b < bands_.size(); ++b)
+        {
+            auto const& band = bands_[b];
+            if (pass < band.shift or pass - band.shift >= band.num_planes)
+            {
+                continue;
+            }
+
+            auto const plane_bit =
+                static_cast<std::uint8_t>(1u << (pass - band.shift));
+
+            for (auto y = std::size_t{ 0 }; y < band.height; ++y)
+            {
+                for (auto x = std::size_t{ 0 }; x < band.width; ++x)
+                {
+                    auto const i = band.offset + y * band.width + x;
+
+                    if (stop())
+                    {
+                        record_stop(pass, b, i - band.offset);
+                        return false;
+                    }
+
+                    auto& flags = flags_[i];
+                    auto const bit = (magnitudes_[i] & plane_bit) != 0u;
+
+                    if ((flags & significant) != 0u)
+                    {
+                        auto& context = refinement_[band.band_class]
+                                                   [(flags & refined) != 0u];
+                        if (code_bit(context, bit))
+                        {
+                            magnitudes_[i] |= plane_bit;
+                        }
+                        flags |= refined;
+                        continue;
+                    }
+
+                    auto& context =
+                        significance_[band.band_class]
+                                     [significant_neighbours(band, x, y)]
+                                     [parent_is_significant(band, x, y)];
+                    if (not code_bit(context, bit))
+                    {
+                        continue;
+                    }
+
+                    // The value stays zero at this plane without its sign
+                    if (stop())
+                    {
+                        record_stop(pass, b, i - band.offset);
+                        return false;
+                    }
+
+                    auto const is_negative = code_bit(
+                        sign_[band.band_class], (flags & negative) != 0u);
+                    magnitudes_[i] |= plane_bit;
+                    flags = significant | (is_negative ? negative : 0u);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void record_stop(unsigned const pass,
+                     std::size_t const band,
+                     std::size_t const index) noexcept
+    {
+        stop_pass_ = pass;
+        stop_band_ = band;
+        stop_index_ = index;
+    }
+
+    [[nodiscard]] auto significant_neighbours(band_info const& band,
+                                              std::size_t const x,
+                                              std::size_t const y) const
+        noexcept -> std::size_t
+    {
+        auto const flags = flags_.data() + band.offset + y * band.width + x;
+        auto count = std::size_t{ 0 };
+
+        count += x > 0u and (flags[-1] & significant) != 0u;
+        count += x + 1u < band.width and (flags[1] & significant) != 0u;
+        count += y > 0u and
+                 (flags[-static_cast<std::ptrdiff_t>(band.width)] &
+                  significant) != 0u;
+        count += y + 1u < band.height and
+                 (flags[band.width] & significant) != 0u;
+
+        return count;
+    }
+
+    [[nodiscard]] auto parent_is_significant(band_info const& band,
+                                             std::size_t const x,
+                                             std::size_t const y) const
+        noexcept -> std::size_t
+    {
+        if (not band.parent)
+        {
+            return 0u;
+        }
+
+        auto const& parent = bands_[*band.parent];
+        if (parent.width == 0u or parent.height == 0u)
+        {
+            return 0u;
+        }
+
+        auto const parent_flags =
+            flags_[parent.offset +
+                   std::min(y / 2u, parent.height - 1u) * parent.width +
+                   std::min(x / 2u, parent.width - 1u)];
+        return (parent_flags & significant) != 0u ? 1u : 0u;
+    }
+
+    template<typename T>
+    void store_values(std::span<T> const data) const
+    {
+        for (auto b = std::size_t{ 0 }; b < bands_.size(); ++b)
+        {
+            auto const& band = bands_[b];
+            auto const size = band.width * band.height;
+
+            for (auto index = std::size_t{ 0 }; index < size; ++index)
+            {
+                auto const i = band.offset + index;
+
+                auto value = 0;
+                if ((flags_[i] & significant) != 0u)
+                {
+                    // Planes below the lowest coded one are unknown
+                    auto const lowest_pass =
+                        b < stop_band_ or (b == stop_band_ and
+                                           index < stop_index_)
+                            ? stop_pass_
+                            : stop_pass_ + 1u;
+                    auto const lowest_plane = lowest_pass > band.shift
+                                                  ? lowest_pass - band.shift
+                                                  : 0u;
+                    auto const magnitude =
+                        magnitudes_[i] + ((1 << lowest_plane) >> 1);
+
+                    value = (flags_[i] & negative) != 0u
+                                ? std::max(-magnitude, -128)
+                                : std::min(magnitude, 127);
+                }
+
+                data[i] = static_cast<std::byte>(
+                    static_cast<std::uint8_t>(value) ^ band.flip);
+            }
+        }
+    }
+};
+
+} // namespace pa171::coding::bitplane
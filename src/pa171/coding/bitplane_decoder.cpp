@@ -0,0 +1 @@
+#include <pa171/coding/bitplane_decoder.hpp>
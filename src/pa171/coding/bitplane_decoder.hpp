@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/coding/bitplane_base.hpp>
+#include <pa171/quantization/subband.hpp>
+
+namespace pa171::coding::bitplane
+{
+
+class decoder
+{
+public:
+    // Decodes a stream, or any prefix of one, into output laid out as the given
+    // subbands and returns the decoded size; values are only as precise as the
+    // planes that the input holds. Throws if the stream is invalid or does not
+    // match the subbands.
+    auto operator()(std::span<std::byte const> const input,
+                    std::span<quantization::subband const> const subbands,
+                    std::span<std::byte> const output) -> std::size_t
+    {
+        auto range_decoder =
+            arithmetic::range_decoder{ input, /*allow_truncation=*/true };
+
+        try
+        {
+            model_.code(output,
+                        subbands,
+                        [&](arithmetic::bit_model& model, bool /*bit*/)
+                        { return range_decoder.decode(model); },
+                        [&] { return range_decoder.truncated(); });
+        }
+        catch (std::invalid_argument const&)
+        {
+            throw decode_error{ "Stream does not match the subbands" };
+        }
+
+        if (not range_decoder.truncated() and not range_decoder.finished())
+        {
+            throw decode_error{ "Invalid bit plane stream" };
+        }
+
+        return output.size();
+    }
+
+private:
+    model model_;
+};
+
+} // namespace pa171::coding::bitplane
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/coding/bitplane_base.hpp>
+#include <pa171/quantization/subband.hpp>
+
+namespace pa171::coding::bitplane
+{
+
+class encoder
+{
+public:
+    // Appends the coded input, laid out as the given subbands, to output
+    void operator()(std::span<std::byte const> const input,
+                    std::span<quantization::subband const> const subbands,
+                    std::vector<std::byte>& output)
+    {
+        auto range_encoder = arithmetic::range_encoder{ output };
+
+        model_.code(
+            input,
+            subbands,
+            [&](arithmetic::bit_model& model, bool const bit)
+            {
+                range_encoder.encode(model, bit);
+                return bit;
+            },
+            [] { return false; });
+
+        range_encoder.finish();
+    }
+
+private:
+    model model_;
+};
+
+} // namespace pa171::coding::bitplane
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/numeric.hpp>
+#include <pa171/utils/parallel.hpp>
+
+namespace pa171::coding
+{
+
+// A chunked payload starts with a table holding the end offset of each chunk
+// (relative to the end of the table), followed by the coded chunks. Each chunk
+// covers chunk_size input bytes (the last one may be shorter) and is coded
+// independently, so the payload does not depend on the number of threads.
+
+using chunk_offset_type = std::uint64_t;
+
+class chunk_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+[[nodiscard]] constexpr auto
+chunk_count(std::size_t const input_size, std::size_t const chunk_size) noexcept
+    -> std::size_t
+{
+    return ceil_div(input_size, chunk_size);
+}
+
+// encode_chunk(worker_index, chunk_input, chunk_output) must replace the
+// contents of chunk_output with the coded chunk
+template<std::invocable<std::size_t,
+                        std::span<std::byte const>,
+                        std::vector<std::byte>&> EncodeChunk>
+void
+encode_chunked(std::span<std::byte const> const input,
+               std::size_t const chunk_size,
+               std::vector<std::byte>& output,
+               std::vector<std::vector<std::byte>>& chunk_buffers,
+               std::size_t const num_threads,
+               EncodeChunk&& encode_chunk)
+{
+    auto const num_chunks = chunk_count(input.size(), chunk_size);
+    chunk_buffers.resize(std::max(chunk_buffers.size(), num_chunks));
+
+    parallel_for(num_threads,
+                 num_chunks,
+                 [&](std::size_t const worker_index, std::size_t const i)
+                 {
+                     encode_chunk(worker_index,
+                                  input.subspan(i * chunk_size,
+                                                std::min(chunk_size,
+                                                         input.size() -
+                                                           i * chunk_size)),
+                                  chunk_buffers[i]);
+                 });
+
+    // Write the offset table, then concatenate the chunks
+    auto table_offset = output.size();
+    output.resize(table_offset + num_chunks * sizeof(chunk_offset_type));
+
+    auto chunk_end = chunk_offset_type{ 0 };
+
+    for (auto const& chunk : std::span{ chunk_buffers }.first(num_chunks))
+    {
+        chunk_end += chunk.size();
+        store_le(output.data() + table_offset, chunk_end);
+        table_offset += sizeof(chunk_offset_type);
+    }
+
+    output.reserve(output.size() + chunk_end);
+
+    for (auto const& chunk : std::span{ chunk_buffers }.first(num_chunks))
+    {
+        output.insert(output.end(), chunk.begin(), chunk.end());
+    }
+}
+
+// decode_chunk(worker_index, chunk_input, chunk_output) must decode the chunk
+// into chunk_output and return the decoded length. Returns the total decoded
+// length.
+template<std::invocable<std::size_t,
+                        std::span<std::byte const>,
+                        std::span<std::byte>> DecodeChunk>
+auto
+decode_chunked(std::span<std::byte const> const input,
+               std::size_t const chunk_size,
+               std::span<std::byte> const output,
+               std::size_t const num_threads,
+               DecodeChunk&& decode_chunk) -> std::size_t
+{
+    auto const num_chunks = chunk_count(output.size(), chunk_size);
+    auto const table_size = num_chunks * sizeof(chunk_offset_type);
+
+    if (input.size() < table_size)
+    {
+        throw chunk_error{ "Chunk table is truncated" };
+    }
+
+    auto const chunks = input.subspan(table_size);
+    auto chunk_bounds = std::vector<std::size_t>(num_chunks + 1u);
+
+    for (auto i = std::size_t{ 0 }; i < num_chunks; ++i)
+    {
+        auto const chunk_end = load_le<chunk_offset_type>(
+            input.data() + i * sizeof(chunk_offset_type));
+
+        if (chunk_end < chunk_bounds[i] or chunk_end > chunks.size())
+        {
+            throw chunk_error{ "Invalid chunk offset" };
+        }
+
+        chunk_bounds[i + 1u] = static_cast<std::size_t>(chunk_end);
+    }
+
+    auto decoded_sizes = std::vector<std::size_t>(num_chunks);
+
+    parallel_for(num_threads,
+                 num_chunks,
+                 [&](std::size_t const worker_index, std::size_t const i)
+                 {
+                     decoded_sizes[i] = decode_chunk(
+                         worker_index,
+                         chunks.subspan(chunk_bounds[i],
+                                        chunk_bounds[i + 1u] - chunk_bounds[i]),
+                         output.subspan(i * chunk_size,
+                                        std::min(chunk_size,
+                                                 output.size() -
+                                                   i * chunk_size)));
+                 });
+
+    auto decoded_size = std::size_t{ 0 };
+
+    for (auto i = std::size_t{ 0 }; i < num_chunks; ++i)
+    {
+        if (decoded_sizes[i] != std::min(chunk_size,
+                                         output.size() - i * chunk_size))
+        {
+            // A short chunk would leave a gap in the output
+            return decoded_size + decoded_sizes[i];
+        }
+
+        decoded_size += decoded_sizes[i];
+    }
+
+    return decoded_size;
+}
+
+} // namespace pa171::coding
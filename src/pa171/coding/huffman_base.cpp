@@ -0,0 +1 @@
+#include <pa171/coding/huffman_base.hpp>
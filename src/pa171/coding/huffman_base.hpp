@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pa171::coding::huffman
+{
+
+// Canonical Huffman coder over bytes, with codes limited to max_code_length
+// bits so that a decoder can resolve any code (and often a few more) with a
+// single lookup into a table of 1 << max_code_length entries.
+//
+// A stream holds the input size (uint64 LE); unless it is empty, the code
+// length of each byte value follows (4 bits each, the lower nibble first, 0
+// for unused values), then the codes. Codes are packed from the least
+// significant bit of each byte, with their first bit lowest, so a decoder
+// can peek the next bits of a little endian word.
+
+using code_t = std::uint32_t;
+
+using code_length_t = std::uint8_t;
+
+static constexpr auto num_symbols = std::size_t{ 256 };
+static constexpr auto max_code_length = code_length_t{ 12 };
+
+static constexpr auto code_lengths_size = num_symbols / 2u;
+
+class decode_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+using code_lengths = std::array<code_length_t, num_symbols>;
+
+// Computes Huffman code lengths for the byte counts, limited to
+// max_code_length. Symbols that do not occur get no code; a lone symbol
+// gets a code of one bit.
+[[nodiscard]] inline auto
+make_code_lengths(std::span<std::size_t const, num_symbols> const counts)
+    -> code_lengths
+{
+    auto lengths = code_lengths{};
+
+    auto symbols = std::vector<std::size_t>{};
+    for (auto symbol = std::size_t{ 0 }; symbol < num_symbols; ++symbol)
+    {
+        if (counts[symbol] != 0u)
+        {
+            symbols.push_back(symbol);
+        }
+    }
+
+    if (symbols.size() <= 1u)
+    {
+        for (auto const symbol : symbols)
+        {
+            lengths[symbol] = 1u;
+        }
+
+        return lengths;
+    }
+
+    // Build the tree bottom up: leaves are nodes [0, n), inner nodes follow
+    struct weighted_node
+    {
+        std::size_t weight;
+        std::size_t index;
+
+        auto operator>(weighted_node const& other) const noexcept -> bool
+        {
+            return weight != other.weight ? weight > other.weight
+                                          : index > other.index;
+        }
+    };
+
+    auto queue = std::priority_queue<weighted_node,
+                                     std::vector<weighted_node>,
+                                     std::greater<>>{};
+    auto parents = std::vector<std::size_t>(2u * symbols.size() - 1u);
+
+    for (auto i = std::size_t{ 0 }; i < symbols.size(); ++i)
+    {
+        queue.push({ counts[symbols[i]], i });
+    }
+
+    for (auto next = symbols.size(); queue.size() > 1u; ++next)
+    {
+        auto const first = queue.top();
+        queue.pop();
+        auto const second = queue.top();
+        queue.pop();
+
+        parents[first.index] = next;
+        parents[second.index] = next;
+        queue.push({ first.weight + second.weight, next });
+    }
+
+    // Depths, from the root (the last node) down
+    auto depths = std::vector<std::size_t>(parents.size());
+    for (auto i = parents.size() - 1u; i > 0u; --i)
+    {
+        depths[i - 1u] = depths[parents[i - 1u]] + 1u;
+    }
+
+    // Count the codes of each length, moving the too long ones to the limit
+    // and then lengthening others until the lengths form a prefix code again
+    // (as in miniz)
+    auto num_codes = std::array<std::size_t, max_code_length + 1u>{};
+    for (auto i = std::size_t{ 0 }; i < symbols.size(); ++i)
+    {
+        ++num_codes[std::min(depths[i], std::size_t{ max_code_length })];
+    }
+
+    auto kraft_total = std::size_t{ 0 };
+    for (auto length = std::size_t{ 1 }; length <= max_code_length; ++length)
+    {
+        kraft_total += num_codes[length] << (max_code_length - length);
+    }
+
+    for (; kraft_total > (std::size_t{ 1 } << max_code_length); --kraft_total)
+    {
+        --num_codes[max_code_length];
+
+        for (auto length = max_code_length - 1u; length > 0u; --length)
+        {
+            if (num_codes[length] != 0u)
+            {
+                --num_codes[length];
+                num_codes[length + 1u] += 2u;
+                break;
+            }
+        }
+    }
+
+    // Give the shortest codes to the most frequent symbols
+    std::ranges::stable_sort(symbols,
+                             std::greater{},
+                             [&](std::size_t const symbol)
+                             { return counts[symbol]; });
+
+    auto position = symbols.begin();
+    for (auto length = std::size_t{ 1 }; length <= max_code_length; ++length)
+    {
+        for (auto i = std::size_t{ 0 }; i < num_codes[length]; ++i)
+        {
+            lengths[*position++] = static_cast<code_length_t>(length);
+        }
+    }
+
+    return lengths;
+}
+
+// Assigns canonical codes to the lengths, bit reversed so that the first
+// bit of each code is its lowest. Returns false unless the lengths form a
+// prefix code.
+[[nodiscard]] inline auto
+make_codes(code_lengths const& lengths, std::span<code_t, num_symbols> codes)
+    -> bool
+{
+    auto num_codes = std::array<code_t, max_code_length + 1u>{};
+    for (auto const length : lengths)
+    {
+        if (length > max_code_length)
+        {
+            return false;
+        }
+
+        ++num_codes[length];
+    }
+    num_codes[0] = 0u;
+
+    auto next_codes = std::array<code_t, max_code_length + 1u>{};
+    auto code = code_t{ 0 };
+    for (auto length = std::size_t{ 1 }; length <= max_code_length; ++length)
+    {
+        code = (code + num_codes[length - 1u]) << 1u;
+        next_codes[length] = code;
+
+        if (code + num_codes[length] > (code_t{ 1 } << length))
+        {
+            return false;
+        }
+    }
+
+    for (auto symbol = std::size_t{ 0 }; symbol < num_symbols; ++symbol)
+    {
+        auto const length = lengths[symbol];
+        if (length == 0u)
+        {
+            codes[symbol] = 0u;
+            continue;
+        }
+
+        auto const canonical = next_codes[length]++;
+        auto reversed = code_t{ 0 };
+        for (auto bit = 0u; bit < length; ++bit)
+        {
+            reversed |= ((canonical >> bit) & 1u) << (length - 1u - bit);
+        }
+        codes[symbol] = reversed;
+    }
+
+    return true;
+}
+
+inline void
+write_code_lengths(code_lengths const& lengths, std::byte* const output)
+{
+    for (auto i = std::size_t{ 0 }; i < code_lengths_size; ++i)
+    {
+        output[i] = static_cast<std::byte>(lengths[2u * i] |
+                                           (lengths[2u * i + 1u] << 4u));
+    }
+}
+
+[[nodiscard]] inline auto
+read_code_lengths(std::byte const* const input) -> code_lengths
+{
+    auto lengths = code_lengths{};
+    for (auto i = std::size_t{ 0 }; i < code_lengths_size; ++i)
+    {
+        auto const value = std::to_integer<code_length_t>(input[i]);
+        lengths[2u * i] = value & 0x0Fu;
+        lengths[2u * i + 1u] = value >> 4u;
+    }
+
+    return lengths;
+}
+
+} // namespace pa171::coding::huffman
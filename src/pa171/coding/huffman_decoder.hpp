@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/huffman_base.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::huffman
+{
+
+class decoder
+{
+public:
+    // Decodes a whole stream into output and returns the decoded size;
+    // throws if the stream is invalid or the output does not fit
+    auto operator()(std::span<std::byte const> input,
+                    std::span<std::byte> const output) -> std::size_t
+    {
+        if (input.size() < sizeof(std::uint64_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto const size = load_le<std::uint64_t>(input.data());
+        input = input.subspan(sizeof(std::uint64_t));
+
+        if (size > output.size())
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        if (size == 0u)
+        {
+            return 0u;
+        }
+
+        if (input.size() < code_lengths_size)
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        init_tables(read_code_lengths(input.data()));
+        input = input.subspan(code_lengths_size);
+
+        auto first = input.data();
+        auto const last = first + input.size();
+        auto result = output.data();
+        auto const result_last = result + size;
+
+        // Unread bits, the next one lowest; bits above num_bits may hold
+        // parts of the bytes after first
+        auto bits = std::uint64_t{ 0 };
+        auto num_bits = 0u;
+
+        // Refill to at least 56 bits, enough for four lookups, each writing
+        // a whole word of symbols
+        constexpr auto lookups_per_refill = 4;
+        constexpr auto max_written = static_cast<std::ptrdiff_t>(
+            lookups_per_refill * max_entry_symbols + sizeof(entry_type));
+
+        while (last - first >= static_cast<std::ptrdiff_t>(sizeof(bits)) and
+               result_last - result >= max_written)
+        {
+            bits |= load_le<std::uint64_t>(first) << num_bits;
+            first += (63u - num_bits) >> 3u;
+            num_bits |= 56u;
+
+            for (auto i = 0; i < lookups_per_refill; ++i)
+            {
+                auto const entry = table_[bits & table_mask];
+                auto const length = (entry >> 24u) & 0x0Fu;
+
+                if (length == 0u)
+                {
+                    throw decode_error{ "Invalid Huffman code" };
+                }
+
+                store_le(result, entry);
+                result += entry >> 28u;
+                bits >>= length;
+                num_bits -= length;
+            }
+        }
+
+        while (result != result_last)
+        {
+            for (; num_bits <= 56u and first != last; num_bits += 8u)
+            {
+                bits |= std::to_integer<std::uint64_t>(*first++) << num_bits;
+            }
+
+            auto const entry = single_[bits & table_mask];
+            auto const length = static_cast<unsigned>(entry >> 8u);
+
+            if (length == 0u or length > num_bits)
+            {
+                throw decode_error{ "Invalid Huffman code" };
+            }
+
+            *result++ = static_cast<std::byte>(entry & 0xFFu);
+            bits >>= length;
+            num_bits -= length;
+        }
+
+        // Only the padding of the last byte may remain
+        if (first != last or num_bits >= 8u)
+        {
+            throw decode_error{ "Invalid Huffman stream" };
+        }
+
+        return static_cast<std::size_t>(size);
+    }
+
+private:
+    // Up to max_entry_symbols decoded symbols (a byte each, the first one
+    // lowest), the total length of their codes (4 bits) and their number
+    // (2 bits); all zero where no code matches
+    using entry_type = std::uint32_t;
+
+    static constexpr auto max_entry_symbols = 3u;
+    static constexpr auto table_size = std::size_t{ 1 } << max_code_length;
+    static constexpr auto table_mask = table_size - 1u;
+
+    std::vector<entry_type> table_ = std::vector<entry_type>(table_size);
+    // The first symbol and its code length (above it) for each lookup
+    std::vector<std::uint16_t> single_ = std::vector<std::uint16_t>(table_size);
+
+    void init_tables(code_lengths const& lengths)
+    {
+        auto codes = std::array<code_t, num_symbols>{};
+        if (not make_codes(lengths, codes) or
+            std::ranges::all_of(lengths,
+                                [](code_length_t const length)
+                                { return length == 0u; }))
+        {
+            throw decode_error{ "Invalid code lengths" };
+        }
+
+        std::ranges::fill(single_, std::uint16_t{ 0 });
+
+        for (auto symbol = std::size_t{ 0 }; symbol < num_symbols; ++symbol)
+        {
+            auto const length = lengths[symbol];
+            if (length == 0u)
+            {
+                continue;
+            }
+
+            // Every lookup starting with the code
+            for (auto index = std::size_t{ codes[symbol] }; index < table_size;
+                 index += std::size_t{ 1 } << length)
+            {
+                single_[index] =
+                    static_cast<std::uint16_t>(symbol | (length << 8u));
+            }
+        }
+
+        // Append the codes that fit completely after the first one
+        for (auto index = std::size_t{ 0 }; index < table_size; ++index)
+        {
+            auto symbols = entry_type{ 0 };
+            auto total_length = 0u;
+            auto count = 0u;
+
+            while (count < max_entry_symbols)
+            {
+                auto const next = single_[index >> total_length];
+                auto const length = static_cast<unsigned>(next >> 8u);
+
+                if (length == 0u or total_length + length > max_code_length)
+                {
+                    break;
+                }
+
+                symbols |= entry_type{ next & 0xFFu } << (8u * count);
+                total_length += length;
+                ++count;
+            }
+
+            table_[index] = symbols | (total_length << 24u) | (count << 28u);
+        }
+    }
+};
+
+} // namespace pa171::coding::huffman
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/huffman_base.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::huffman
+{
+
+class encoder
+{
+public:
+    // Appends the coded input to output
+    void operator()(std::span<std::byte const> const input,
+                    std::vector<std::byte>& output) const
+    {
+        auto const output_offset = output.size();
+        output.resize(output_offset + sizeof(std::uint64_t));
+        store_le(output.data() + output_offset,
+                 static_cast<std::uint64_t>(input.size()));
+
+        if (input.empty())
+        {
+            return;
+        }
+
+        auto counts = std::array<std::size_t, num_symbols>{};
+        for (auto const value : input)
+        {
+            ++counts[std::to_integer<std::size_t>(value)];
+        }
+
+        auto const lengths = make_code_lengths(counts);
+        auto codes = std::array<code_t, num_symbols>{};
+        [[maybe_unused]] auto const is_prefix_code = make_codes(lengths, codes);
+        assert(is_prefix_code);
+
+        // Reserve the worst case, with room for whole words at the end
+        auto const codes_offset = output.size() + code_lengths_size;
+        output.resize(codes_offset +
+                      input.size() * max_code_length / 8u +
+                      2u * sizeof(std::uint32_t));
+        write_code_lengths(lengths,
+                           output.data() + codes_offset - code_lengths_size);
+
+        auto position = output.data() + codes_offset;
+        auto bits = std::uint64_t{ 0 };
+        auto num_bits = 0u;
+
+        for (auto const value : input)
+        {
+            auto const symbol = std::to_integer<std::size_t>(value);
+            bits |= std::uint64_t{ codes[symbol] } << num_bits;
+            num_bits += lengths[symbol];
+
+            if (num_bits >= 32u)
+            {
+                store_le(position, static_cast<std::uint32_t>(bits));
+                position += sizeof(std::uint32_t);
+                bits >>= 32u;
+                num_bits -= 32u;
+            }
+        }
+
+        // Write the remaining whole and partial bytes
+        store_le(position, static_cast<std::uint32_t>(bits));
+        position += (num_bits + 7u) / 8u;
+
+        output.resize(static_cast<std::size_t>(position - output.data()));
+    }
+};
+
+} // namespace pa171::coding::huffman
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace pa171::coding::lzw
@@ -7,16 +8,79 @@ namespace pa171::coding::lzw
 
 using code_point_size_t = std::uint32_t;
 
+using code_point_t = std::uint32_t;
+
 static constexpr auto default_code_size = code_point_size_t{16};
 
+// Supported code sizes. The dictionaries take, in the worst case, 12 bytes
+// per code point in the encoder and 9 in the decoder, plus 10 more on both
+// sides with reuse_code_points:
+//
+//   code size | encoder   | decoder   | reuse_code_points
+//   ----------+-----------+-----------+------------------
+//          12 |    48 KiB |    36 KiB |           +40 KiB
+//          16 |   768 KiB |   576 KiB |          +640 KiB
+//          20 |    12 MiB |     9 MiB |           +10 MiB
+//          24 |   192 MiB |   144 MiB |          +160 MiB
+//
+// Chunked coding has one encoder or decoder per worker thread.
+static constexpr auto min_code_size = code_point_size_t{ 9 };
+static constexpr auto max_code_size = code_point_size_t{ 24 };
+
 using options_t = std::uint32_t;
 
 enum : options_t
 {
     dynamic_code_size = 1u << 0u,
+    // Clear the dictionary as soon as it is full, unless adaptive_reset or
+    // reuse_code_points decide what happens to a full dictionary
     flush_full_dict = 1u << 1u,
+    // Once the dictionary is full, clear it whenever the compression ratio
+    // gets worse (like the CLEAR code of Unix compress)
+    adaptive_reset = 1u << 2u,
+    // Once the dictionary is full, replace its least recently used entry
+    // (which is not a prefix of another one) instead of flushing it
+    reuse_code_points = 1u << 3u,
 
     default_options = dynamic_code_size | flush_full_dict,
 };
 
+static constexpr auto end_input_code_point = code_point_t{ 256 };
+
+// Only reserved with adaptive_reset
+static constexpr auto clear_code_point = code_point_t{ 257 };
+
+// Input bytes between compression ratio checks with adaptive_reset
+static constexpr auto adaptive_reset_interval = std::size_t{ 8192 };
+
+[[nodiscard]] constexpr auto
+encoder_memory_size(code_point_size_t const code_size,
+                    options_t const options) noexcept -> std::size_t
+{
+    return ((options & reuse_code_points) ? 22u : 12u) *
+           (std::size_t{ 1 } << code_size);
+}
+
+[[nodiscard]] constexpr auto
+decoder_memory_size(code_point_size_t const code_size,
+                    options_t const options) noexcept -> std::size_t
+{
+    return ((options & reuse_code_points) ? 19u : 9u) *
+           (std::size_t{ 1 } << code_size);
+}
+
+[[nodiscard]] constexpr auto
+first_dynamic_code_point(options_t const options) noexcept -> code_point_t
+{
+    return (options & adaptive_reset) ? clear_code_point + 1u
+                                      : end_input_code_point + 1u;
+}
+
+[[nodiscard]] constexpr auto
+flushes_full_dict(options_t const options) noexcept -> bool
+{
+    return (options & flush_full_dict) and
+           not(options & (adaptive_reset | reuse_code_points));
+}
+
 } // namespace pa171::coding::lzw
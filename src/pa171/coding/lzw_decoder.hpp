@@ -6,14 +6,19 @@
 #include <cstddef>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
 #include <span>
 #include <stdexcept>
-#include <string>
-#include <string_view>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <pa171/coding/lzw_base.hpp>
+#include <pa171/coding/lzw_dictionary.hpp>
+#include <pa171/coding/lzw_preset.hpp>
+#include <pa171/utils/endian.hpp>
 
 namespace pa171::coding::lzw
 {
@@ -27,11 +32,23 @@ public:
 class decoder
 {
 public:
-    explicit decoder(code_point_size_t const code_size = default_code_size,
-                     options_t const options = default_options)
+    explicit decoder(
+        code_point_size_t const code_size = default_code_size,
+        options_t const options = default_options,
+        std::shared_ptr<preset_dictionary const> preset = nullptr)
         : code_size_{ code_size }
         , options_{ options }
+        , first_dynamic_code_point_{ first_dynamic_code_point(options) }
+        , table_{ code_size, first_dynamic_code_point_ }
+        , preset_{ std::move(preset) }
+        , sequence_buffer_(std::size_t{ 1 } << code_size)
     {
+        if (options & reuse_code_points)
+        {
+            lru_.emplace(code_size, first_dynamic_code_point_);
+        }
+
+        reset();
     }
 
     template<std::ranges::input_range R, std::output_iterator<std::byte> O>
@@ -43,86 +60,209 @@ public:
             std::ranges::begin(range), std::ranges::end(range), result);
     }
 
+    // Decodes a whole stream; throws if the input ends before the stream
+    template<std::input_iterator I,
+             std::sentinel_for<I> S,
+             std::output_iterator<std::byte> O>
+    requires std::same_as<std::iter_value_t<I>, std::byte>
+    auto operator()(I const first, S const last, O const result)
+        -> std::pair<I, O>
+    {
+        reset();
+        auto const decode_result =
+            decode(first, last, result, std::unreachable_sentinel);
+        finish();
+
+        return decode_result;
+    }
+
+    // Decodes into a bounded buffer; throws if the output does not fit
+    template<std::ranges::input_range R>
+    requires std::same_as<std::ranges::range_value_t<R>, std::byte>
+    auto operator()(R&& range, std::span<std::byte> const output)
+        -> std::pair<std::ranges::iterator_t<R>, std::byte*>
+    {
+        reset();
+        auto const decode_result = decode(std::ranges::begin(range),
+                                          std::ranges::end(range),
+                                          output.data(),
+                                          output.data() + output.size());
+        finish();
+
+        return decode_result;
+    }
+
+    template<std::ranges::input_range R, std::output_iterator<std::byte> O>
+    requires std::same_as<std::ranges::range_value_t<R>, std::byte>
+    auto feed(R&& range, O const result)
+        -> std::pair<std::ranges::iterator_t<R>, O>
+    {
+        return feed(std::ranges::begin(range), std::ranges::end(range), result);
+    }
+
+    // Decodes the next part of a stream. All input is consumed, unless the
+    // end of the stream is reached, in which case the returned input iterator
+    // points past the last byte read.
     template<std::input_iterator I,
              std::sentinel_for<I> S,
              std::output_iterator<std::byte> O>
     requires std::same_as<std::iter_value_t<I>, std::byte>
-    auto operator()(I first, S const last, O result) -> std::pair<I, O>
+    auto feed(I const first, S const last, O const result) -> std::pair<I, O>
+    {
+        return decode(first, last, result, std::unreachable_sentinel);
+    }
+
+    template<std::ranges::input_range R>
+    requires std::same_as<std::ranges::range_value_t<R>, std::byte>
+    auto feed(R&& range, std::span<std::byte> const output)
+        -> std::pair<std::ranges::iterator_t<R>, std::byte*>
+    {
+        return decode(std::ranges::begin(range),
+                      std::ranges::end(range),
+                      output.data(),
+                      output.data() + output.size());
+    }
+
+    // Whether the end of the stream has been decoded
+    [[nodiscard]] auto finished() const noexcept -> bool
+    {
+        return end_of_input_;
+    }
+
+    // Checks that the stream is complete, then starts a new stream
+    void finish()
+    {
+        if (not end_of_input_)
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        reset();
+    }
+
+    // Discards the current stream
+    void reset() noexcept
     {
         init_table();
+        block_ = {};
         block_end_ = block_size;
+        previous_code_point_ = std::nullopt;
+        end_of_input_ = false;
+    }
 
-        auto accumulator = std::string{};
-        auto end_of_input = false;
+private:
+    using block_type = std::uint64_t;
+    using block_index_type = std::uint32_t;
+    using code_point_type = code_point_t;
+    using table_type = decoder_dictionary;
 
-        do
+    static constexpr auto initial_dynamic_code_size = code_point_size_t{ 9 };
+    static constexpr auto block_size = std::numeric_limits<block_type>::digits;
+
+    code_point_size_t code_size_;
+    options_t options_;
+    code_point_type first_dynamic_code_point_;
+    table_type table_;
+    std::optional<code_point_lru> lru_;
+    std::shared_ptr<preset_dictionary const> preset_;
+    std::vector<std::byte> sequence_buffer_;
+    code_point_size_t current_code_size_ = {};
+    std::optional<code_point_type> next_code_point_ = {};
+    block_type block_ = {};
+    block_index_type block_end_ = {};
+    std::optional<code_point_type> previous_code_point_ = {};
+    bool end_of_input_ = false;
+
+    // Decodes until the end of the stream, or until the input runs out
+    template<std::input_iterator I,
+             std::sentinel_for<I> S,
+             std::output_iterator<std::byte> O,
+             std::sentinel_for<O> OS>
+    requires std::same_as<std::iter_value_t<I>, std::byte>
+    auto decode(I first, S const last, O result, OS const result_last)
+        -> std::pair<I, O>
+    {
+        while (not end_of_input_)
         {
-            if ((options_ & flush_full_dict) and not next_code_point_)
+            if (flushes_full_dict(options_) and not next_code_point_)
             {
                 init_table();
+
+                // A multi-byte previous sequence is not part of the new table,
+                // so the next entry cannot be reconstructed. Mark it with the
+                // end of input code point, which never precedes an entry.
+                if (previous_code_point_ and
+                    *previous_code_point_ >= first_dynamic_code_point_)
+                {
+                    previous_code_point_ = end_input_code_point;
+                }
             }
 
             auto const code_point = read_code_point(first, last);
 
             if (not code_point)
             {
-                throw decode_error{ "Unexpected end of input" };
+                // Wait for more input
+                break;
             }
             else if (*code_point == end_input_code_point)
             {
-                end_of_input = true;
+                end_of_input_ = true;
             }
-            else if (*code_point >= table_.size())
+            else if ((options_ & adaptive_reset) and
+                     *code_point == clear_code_point)
+            {
+                init_table();
+                previous_code_point_ = std::nullopt;
+            }
+            else if (not table_.contains(*code_point))
             {
                 throw decode_error{ "Unknown code point found" };
             }
             else
             {
-                auto decoded = table_[*code_point];
-                assert(not decoded.empty());
+                auto first_byte = std::byte{};
+                std::tie(result, first_byte) =
+                    write_sequence(result, result_last, *code_point);
 
-                result = write_sequence(result, decoded);
+                if (lru_)
+                {
+                    lru_->touch(*code_point);
+                }
 
                 if (not next_code_point_)
                 {
-                    // Table is full, do not create new code points
+                    if (lru_ and previous_code_point_)
+                    {
+                        reuse_code_point(*previous_code_point_, first_byte);
+                        previous_code_point_ = code_point;
+                    }
+
+                    // Otherwise the table is full, do not create new code
+                    // points
                     continue;
                 }
 
-                if (not accumulator.empty())
+                if (previous_code_point_)
                 {
-                    accumulator.push_back(decoded.front());
-
-                    table_.push_back(std::move(accumulator));
+                    if (*previous_code_point_ == end_input_code_point)
+                    {
+                        table_.push_back_unknown();
+                    }
+                    else
+                    {
+                        push_back(*previous_code_point_, first_byte);
+                    }
                     update_next_code_point();
                 }
 
-                accumulator = std::move(decoded);
+                previous_code_point_ = code_point;
             }
-        } while (not end_of_input);
+        }
 
         return std::pair{ first, result };
     }
 
-private:
-    using block_type = std::uint64_t;
-    using block_index_type = std::uint32_t;
-    using code_point_type = std::uint32_t;
-    using table_type = std::vector<std::string>;
-
-    static constexpr auto initial_dynamic_code_size = code_point_size_t{ 9 };
-    static constexpr auto end_input_code_point = code_point_type{ 256 };
-    static constexpr auto first_dynamic_code_point = code_point_type{ 257 };
-    static constexpr auto block_size = std::numeric_limits<block_type>::digits;
-
-    code_point_size_t code_size_;
-    options_t options_;
-    table_type table_;
-    code_point_size_t current_code_size_ = {};
-    std::optional<code_point_type> next_code_point_ = {};
-    block_type block_ = {};
-    block_index_type block_end_ = {};
-
     void update_next_code_point() noexcept
     {
         if (not next_code_point_)
@@ -153,23 +293,59 @@ private:
         ++*next_code_point_;
     }
 
-    void init_table()
+    void push_back(code_point_type const prefix, std::byte const last) noexcept
+    {
+        if (lru_)
+        {
+            lru_->add(table_.size(), prefix);
+        }
+
+        table_.push_back(prefix, last);
+    }
+
+    // Moves the least recently used entry to a new sequence
+    void reuse_code_point(code_point_type const prefix,
+                          std::byte const last) noexcept
+    {
+        auto const code_point = lru_->pop_oldest(prefix);
+
+        if (not code_point)
+        {
+            return;
+        }
+
+        lru_->remove_child(table_.prefix(*code_point));
+        table_.replace(*code_point, prefix, last);
+        lru_->add(*code_point, prefix);
+    }
+
+    void init_table() noexcept
     {
         table_.clear();
+
+        if (lru_)
+        {
+            lru_->clear();
+        }
+
         current_code_size_ = (options_ & dynamic_code_size)
                                  ? initial_dynamic_code_size
                                  : code_size_;
+        next_code_point_ = first_dynamic_code_point_;
 
-        for (auto const base_symbol :
-             std::views::iota(code_point_type{ 0 }, code_point_type{ 256 }))
+        if (preset_)
         {
-            auto const base_symbol_char = static_cast<char>(base_symbol);
-            table_.emplace_back(std::string_view{ &base_symbol_char, 1u });
-        }
-
-        table_.emplace_back(); // Empty slot for the end of input code point
+            auto const entries = preset_->entries().first(
+                preset_->load_size(code_size_, first_dynamic_code_point_));
 
-        next_code_point_ = first_dynamic_code_point;
+            for (auto const& entry : entries)
+            {
+                push_back(preset_dictionary::prefix_code_point(
+                              entry.prefix, first_dynamic_code_point_),
+                          entry.next);
+                update_next_code_point();
+            }
+        }
     }
 
     template<std::input_iterator I, std::sentinel_for<I> S>
@@ -180,6 +356,25 @@ private:
         static_assert(block_size >=
                       std::numeric_limits<code_point_type>::digits);
 
+        if constexpr (std::contiguous_iterator<I> and
+                      std::sized_sentinel_for<S, I>)
+        {
+            if (block_size - block_end_ < current_code_size_ and
+                last - first >= static_cast<std::iter_difference_t<I>>(
+                                    sizeof(block_type)))
+            {
+                // Load a whole block, but only consume complete bytes
+                auto const word = load_le<block_type>(std::to_address(first));
+                auto const shift = block_end_ & ~block_index_type{ 7 };
+
+                block_ = shift < block_size ? (block_ >> shift) |
+                                                  (word << (block_size - shift))
+                                            : word;
+                first += shift / 8u;
+                block_end_ -= shift;
+            }
+        }
+
         if (block_size - block_end_ < current_code_size_)
         {
             while (block_end_ >= 8u and first != last)
@@ -205,12 +400,41 @@ private:
         return code_point;
     }
 
-    template<std::output_iterator<std::byte> O>
+    // Returns the advanced output iterator and the first byte of the sequence
+    template<std::output_iterator<std::byte> O, std::sentinel_for<O> OS>
     [[nodiscard]] auto write_sequence(O const result,
-                                      std::string_view const sequence) -> O
+                                      OS const result_last,
+                                      code_point_type const code_point)
+        -> std::pair<O, std::byte>
     {
-        return std::ranges::copy(std::as_bytes(std::span{ sequence }), result)
-            .out;
+        if constexpr (std::sized_sentinel_for<OS, O>)
+        {
+            if (result_last - result <
+                static_cast<std::iter_difference_t<O>>(
+                    table_.length(code_point)))
+            {
+                throw decode_error{ "Output buffer too small" };
+            }
+        }
+
+        if constexpr (std::random_access_iterator<O> and
+                      std::indirectly_readable<O>)
+        {
+            // Write the sequence directly to the output
+            return { table_.write(code_point, result), *result };
+        }
+        else
+        {
+            auto const sequence_end =
+                table_.write(code_point, sequence_buffer_.begin());
+
+            return {
+                std::ranges::copy(
+                    sequence_buffer_.begin(), sequence_end, result)
+                    .out,
+                sequence_buffer_.front(),
+            };
+        }
     }
 };
 
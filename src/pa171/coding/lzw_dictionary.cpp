@@ -0,0 +1 @@
+#include <pa171/coding/lzw_dictionary.hpp>
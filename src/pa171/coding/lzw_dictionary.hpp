@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <vector>
+
+#include <pa171/coding/lzw_base.hpp>
+
+namespace pa171::coding::lzw
+{
+
+// Maps (prefix code point, next byte) pairs to the code point of the
+// extended sequence. Single byte sequences are implicit (their code point
+// is the byte value), so an empty dictionary already contains them.
+//
+// Code points are kept in a flat open-addressed table with linear probing,
+// sized for a load factor of at most 1/2 with all code points in use, while
+// the keys are stored once per code point. Each slot is stamped with the
+// epoch it was written in, so clearing the table only needs to start a new
+// epoch.
+class encoder_dictionary
+{
+public:
+    explicit encoder_dictionary(code_point_size_t const code_size)
+        : slots_(slot_count(code_size))
+        , keys_(std::size_t{ 1 } << code_size)
+        , index_shift_{ static_cast<unsigned>(
+              std::numeric_limits<std::uint64_t>::digits -
+              std::countr_zero(slots_.size())) }
+    {
+    }
+
+    void clear() noexcept
+    {
+        if (++epoch_ > slot_type{ 0xFF })
+        {
+            // Out of epoch bits, stale slots could appear valid
+            std::ranges::fill(slots_, slot_type{});
+            epoch_ = 1u;
+        }
+    }
+
+    [[nodiscard]] auto find(code_point_t const prefix,
+                            std::byte const next) const noexcept
+        -> std::optional<code_point_t>
+    {
+        auto const key = make_key(prefix, next);
+
+        for (auto index = slot_index(key);; index = next_index(index))
+        {
+            auto const slot = slots_[index];
+
+            if (slot_epoch(slot) != epoch_)
+            {
+                return std::nullopt;
+            }
+
+            if (keys_[slot_code_point(slot)] == key)
+            {
+                return slot_code_point(slot);
+            }
+        }
+    }
+
+    // Does not map the sequence to the new code point if it already has
+    // one, but still records it as the sequence of code_point
+    void insert(code_point_t const prefix,
+                std::byte const next,
+                code_point_t const code_point) noexcept
+    {
+        auto const key = make_key(prefix, next);
+        keys_[code_point] = key;
+
+        for (auto index = slot_index(key);; index = next_index(index))
+        {
+            auto& slot = slots_[index];
+
+            if (slot_epoch(slot) != epoch_)
+            {
+                slot = make_slot(code_point);
+                return;
+            }
+
+            if (keys_[slot_code_point(slot)] == key)
+            {
+                return;
+            }
+        }
+    }
+
+    // Prefix code point of the sequence recorded for an inserted code point
+    [[nodiscard]] auto prefix(code_point_t const code_point) const noexcept
+        -> code_point_t
+    {
+        return keys_[code_point] >> 8u;
+    }
+
+    // Removes an inserted code point, shifting back the slots that probed
+    // past it so that no tombstones are needed
+    void erase(code_point_t const code_point) noexcept
+    {
+        auto index = slot_index(keys_[code_point]);
+        while (slot_code_point(slots_[index]) != code_point)
+        {
+            if (slot_epoch(slots_[index]) != epoch_)
+            {
+                // The sequence was mapped to another code point
+                return;
+            }
+
+            index = next_index(index);
+        }
+
+        for (auto next = next_index(index);
+             slot_epoch(slots_[next]) == epoch_;
+             next = next_index(next))
+        {
+            auto const home =
+                slot_index(keys_[slot_code_point(slots_[next])]);
+
+            // Move the slot unless its home lies cyclically in (index, next]
+            if (((next - home) & (slots_.size() - 1u)) >=
+                ((next - index) & (slots_.size() - 1u)))
+            {
+                slots_[index] = slots_[next];
+                index = next;
+            }
+        }
+
+        slots_[index] = slot_type{};
+    }
+
+private:
+    // The code point, with the epoch in the top byte
+    using slot_type = std::uint32_t;
+    using key_type = std::uint32_t;
+
+    static constexpr auto epoch_shift = 24u;
+    static constexpr auto code_point_mask = slot_type{ 0xFF'FFFF };
+
+    std::vector<slot_type> slots_;
+    std::vector<key_type> keys_;
+    unsigned index_shift_;
+    slot_type epoch_ = 1u;
+
+    [[nodiscard]] static auto slot_count(code_point_size_t const code_size)
+        -> std::size_t
+    {
+        assert(code_size <= max_code_size);
+
+        return std::size_t{ 2 } << code_size;
+    }
+
+    [[nodiscard]] static constexpr auto make_key(code_point_t const prefix,
+                                                 std::byte const next) noexcept
+        -> key_type
+    {
+        return static_cast<key_type>(prefix << 8u) |
+               std::to_integer<key_type>(next);
+    }
+
+    [[nodiscard]] auto make_slot(code_point_t const code_point) const noexcept
+        -> slot_type
+    {
+        return (epoch_ << epoch_shift) | code_point;
+    }
+
+    [[nodiscard]] static constexpr auto slot_epoch(
+        slot_type const slot) noexcept -> slot_type
+    {
+        return slot >> epoch_shift;
+    }
+
+    [[nodiscard]] static constexpr auto slot_code_point(
+        slot_type const slot) noexcept -> code_point_t
+    {
+        return slot & code_point_mask;
+    }
+
+    [[nodiscard]] auto slot_index(key_type const key) const noexcept
+        -> std::size_t
+    {
+        // Fibonacci hashing
+        return static_cast<std::size_t>(
+            (std::uint64_t{ key } * 0x9E3779B97F4A7C15u) >> index_shift_);
+    }
+
+    [[nodiscard]] auto next_index(std::size_t const index) const noexcept
+        -> std::size_t
+    {
+        return (index + 1u) & (slots_.size() - 1u);
+    }
+};
+
+// Stores each code point as its prefix code point and last byte (packed in
+// one word), so that sequences are reconstructed by walking the prefixes
+// from the last byte backwards. Memory is allocated once for the largest
+// code point.
+class decoder_dictionary
+{
+public:
+    decoder_dictionary(code_point_size_t const code_size,
+                       code_point_t const first_dynamic_code_point)
+        : entries_(std::size_t{ 1 } << code_size)
+        , first_dynamic_code_point_{ first_dynamic_code_point }
+    {
+        for (auto const base_symbol :
+             std::views::iota(code_point_t{ 0 }, code_point_t{ 256 }))
+        {
+            entries_[base_symbol] = make_entry(
+                base_symbol, 1u, static_cast<std::byte>(base_symbol));
+        }
+
+        clear();
+    }
+
+    // Keeps the single byte entries and the reserved code points
+    void clear() noexcept { size_ = first_dynamic_code_point_; }
+
+    [[nodiscard]] auto size() const noexcept -> code_point_t { return size_; }
+
+    [[nodiscard]] auto contains(code_point_t const code_point) const noexcept
+        -> bool
+    {
+        return code_point < size_ and entries_[code_point].length != 0u;
+    }
+
+    [[nodiscard]] auto length(code_point_t const code_point) const noexcept
+        -> std::uint32_t
+    {
+        assert(contains(code_point));
+
+        return entries_[code_point].length;
+    }
+
+    void push_back(code_point_t const prefix, std::byte const last) noexcept
+    {
+        assert(contains(prefix));
+        assert(size_ < entries_.size());
+
+        entries_[size_++] =
+            make_entry(prefix, entries_[prefix].length + 1u, last);
+    }
+
+    // Gives an existing code point a new sequence. No other entry may use
+    // it as a prefix.
+    void replace(code_point_t const code_point,
+                 code_point_t const prefix,
+                 std::byte const last) noexcept
+    {
+        assert(contains(code_point));
+        assert(contains(prefix) and prefix != code_point);
+
+        entries_[code_point] =
+            make_entry(prefix, entries_[prefix].length + 1u, last);
+    }
+
+    [[nodiscard]] auto prefix(code_point_t const code_point) const noexcept
+        -> code_point_t
+    {
+        assert(contains(code_point));
+
+        return entries_[code_point].link >> 8u;
+    }
+
+    // Reserves a code point for a sequence that cannot be reconstructed
+    void push_back_unknown() noexcept
+    {
+        assert(size_ < entries_.size());
+
+        entries_[size_++] = entry{};
+    }
+
+    // Writes the sequence to [result, result + length(code_point))
+    template<std::random_access_iterator O>
+    requires std::output_iterator<O, std::byte>
+    auto write(code_point_t code_point, O const result) const -> O
+    {
+        assert(contains(code_point));
+
+        auto const length = entries_[code_point].length;
+
+        for (auto i = static_cast<std::ptrdiff_t>(length) - 1; i >= 0; --i)
+        {
+            auto const link = entries_[code_point].link;
+            result[i] = static_cast<std::byte>(link & 0xFFu);
+            code_point = link >> 8u;
+        }
+
+        return result + static_cast<std::ptrdiff_t>(length);
+    }
+
+private:
+    struct entry
+    {
+        // Prefix code point in the high bits, last byte in the low byte
+        std::uint32_t link = {};
+        std::uint32_t length = {};
+    };
+
+    std::vector<entry> entries_;
+    code_point_t first_dynamic_code_point_;
+    code_point_t size_ = {};
+
+    [[nodiscard]] static constexpr auto make_entry(
+        code_point_t const prefix,
+        std::uint32_t const length,
+        std::byte const last) noexcept -> entry
+    {
+        return {
+            .link = (prefix << 8u) | std::to_integer<std::uint32_t>(last),
+            .length = length,
+        };
+    }
+};
+
+// Orders the dynamic code points that are not the prefix of any entry from
+// least to most recently used, to pick the entry to replace with
+// reuse_code_points. The encoder and decoder make the same calls in the same
+// order, so they always agree on it.
+class code_point_lru
+{
+public:
+    code_point_lru(code_point_size_t const code_size,
+                   code_point_t const first_dynamic_code_point)
+        : links_(std::size_t{ 1 } << code_size)
+        , num_children_(std::size_t{ 1 } << code_size)
+        , first_dynamic_code_point_{ first_dynamic_code_point }
+    {
+    }
+
+    void clear() noexcept
+    {
+        oldest_ = none;
+        newest_ = none;
+    }
+
+    // Adds a new entry as the most recently used one
+    void add(code_point_t const code_point, code_point_t const prefix) noexcept
+    {
+        if (prefix >= first_dynamic_code_point_ and
+            num_children_[prefix]++ == 0u)
+        {
+            unlink(prefix);
+        }
+
+        num_children_[code_point] = 0u;
+        link_newest(code_point);
+    }
+
+    // Makes an entry the most recently used one
+    void touch(code_point_t const code_point) noexcept
+    {
+        if (code_point >= first_dynamic_code_point_ and
+            num_children_[code_point] == 0u)
+        {
+            unlink(code_point);
+            link_newest(code_point);
+        }
+    }
+
+    // Removes the least recently used entry, skipping the given one
+    [[nodiscard]] auto pop_oldest(code_point_t const skipped) noexcept
+        -> std::optional<code_point_t>
+    {
+        auto code_point = oldest_;
+        if (code_point == skipped)
+        {
+            code_point = links_[code_point].newer;
+        }
+
+        if (code_point == none)
+        {
+            return std::nullopt;
+        }
+
+        unlink(code_point);
+        return code_point;
+    }
+
+    // Updates the prefix of a removed entry
+    void remove_child(code_point_t const prefix) noexcept
+    {
+        if (prefix >= first_dynamic_code_point_ and
+            --num_children_[prefix] == 0u)
+        {
+            link_oldest(prefix);
+        }
+    }
+
+private:
+    static constexpr auto none = std::numeric_limits<code_point_t>::max();
+
+    struct link
+    {
+        code_point_t older = none;
+        code_point_t newer = none;
+    };
+
+    std::vector<link> links_;
+    std::vector<std::uint16_t> num_children_;
+    code_point_t first_dynamic_code_point_;
+    code_point_t oldest_ = none;
+    code_point_t newest_ = none;
+
+    void unlink(code_point_t const code_point) noexcept
+    {
+        auto const [older, newer] = links_[code_point];
+        (older != none ? links_[older].newer : oldest_) = newer;
+        (newer != none ? links_[newer].older : newest_) = older;
+    }
+
+    void link_newest(code_point_t const code_point) noexcept
+    {
+        links_[code_point] = link{ .older = newest_, .newer = none };
+        (newest_ != none ? links_[newest_].newer : oldest_) = code_point;
+        newest_ = code_point;
+    }
+
+    void link_oldest(code_point_t const code_point) noexcept
+    {
+        links_[code_point] = link{ .older = none, .newer = oldest_ };
+        (oldest_ != none ? links_[oldest_].older : newest_) = code_point;
+        oldest_ = code_point;
+    }
+};
+
+} // namespace pa171::coding::lzw
@@ -6,29 +6,67 @@
 #include <cstddef>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
 #include <span>
-#include <string>
-#include <string_view>
-
-#include <absl/container/flat_hash_map.h>
+#include <utility>
 
 #include <pa171/coding/lzw_base.hpp>
+#include <pa171/coding/lzw_dictionary.hpp>
+#include <pa171/coding/lzw_preset.hpp>
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/numeric.hpp>
 
 namespace pa171::coding::lzw
 {
 
+// Upper bound on the bytes written by one encoder call (operator(), feed() or
+// finish()) for an input of the given size. Contiguous outputs (such as
+// pointers) are written a whole block at a time and must have room for at
+// least this many bytes.
+[[nodiscard]] constexpr auto
+max_encoded_size(std::size_t const input_size,
+                 code_point_size_t const code_size = default_code_size) noexcept
+    -> std::size_t
+{
+    constexpr auto min_code_size = code_point_size_t{ 9 };
+    constexpr auto block_bytes = sizeof(std::uint64_t);
+
+    // At most one code point per input byte, plus the held back match and
+    // the end of input, plus the clear code points of adaptive_reset
+    auto const max_code_points =
+        input_size + 2u + (input_size / adaptive_reset_interval + 1u);
+    auto const max_bits =
+        max_code_points * std::max(code_size, min_code_size);
+
+    // A block of bits carried over from the previous call, plus the overhang
+    // of the last whole block store
+    return ceil_div(max_bits, std::size_t{ 8 }) + 2u * block_bytes;
+}
+
 class encoder
 {
 public:
-    explicit encoder(code_point_size_t const code_size = default_code_size,
-                     options_t const options = default_options)
+    explicit encoder(
+        code_point_size_t const code_size = default_code_size,
+        options_t const options = default_options,
+        std::shared_ptr<preset_dictionary const> preset = nullptr)
         : code_size_{ code_size }
         , options_{ options }
+        , first_dynamic_code_point_{ first_dynamic_code_point(options) }
+        , table_{ code_size }
+        , preset_{ std::move(preset) }
     {
+        if (options & reuse_code_points)
+        {
+            lru_.emplace(code_size, first_dynamic_code_point_);
+        }
+
+        init_table();
     }
 
-    template<std::ranges::forward_range R, std::output_iterator<std::byte> O>
+    template<std::ranges::input_range R, std::output_iterator<std::byte> O>
     requires std::same_as<std::ranges::range_value_t<R>, std::byte>
     auto operator()(R&& range, O const result) -> O
     {
@@ -36,86 +74,190 @@ public:
             std::ranges::begin(range), std::ranges::end(range), result);
     }
 
-    template<std::forward_iterator I,
+    // Encodes a whole stream
+    template<std::input_iterator I,
              std::sentinel_for<I> S,
              std::output_iterator<std::byte> O>
     requires std::same_as<std::iter_value_t<I>, std::byte>
-    auto operator()(I first, S const last, O result) -> O
+    auto operator()(I const first, S const last, O const result) -> O
     {
-        init_table();
-        block_end_ = 0u;
+        reset();
+        return finish(feed(first, last, result));
+    }
 
-        auto input_accumulator = std::string{};
-        auto next_code_word = std::string{};
-        auto code_point = code_point_type{};
+    template<std::ranges::input_range R, std::output_iterator<std::byte> O>
+    requires std::same_as<std::ranges::range_value_t<R>, std::byte>
+    auto feed(R&& range, O const result) -> O
+    {
+        return feed(std::ranges::begin(range), std::ranges::end(range), result);
+    }
 
+    // Encodes the next part of a stream. The last match is held back until
+    // more input is fed, or the stream is finished.
+    template<std::input_iterator I,
+             std::sentinel_for<I> S,
+             std::output_iterator<std::byte> O>
+    requires std::same_as<std::iter_value_t<I>, std::byte>
+    auto feed(I first, S const last, O result) -> O
+    {
         while (first != last)
         {
-            if ((options_ & flush_full_dict) and not next_code_point_)
+            if (flushes_full_dict(options_) and not next_code_point_)
             {
                 init_table();
+
+                // The prefix of the pending entry refers to the old table;
+                // unless it is a single byte, the entry cannot be reached
+                if (next_entry_ and
+                    next_entry_->prefix >= first_dynamic_code_point_)
+                {
+                    next_entry_->reachable = false;
+                }
             }
 
             auto const input_byte = *first++;
-            input_accumulator.push_back(static_cast<char>(input_byte));
 
-            if (auto const match = table_.find(input_accumulator);
-                match != table_.end())
+            if (not next_code_point_)
+            {
+                ++full_input_size_;
+            }
+
+            if (not has_match_)
+            {
+                has_match_ = true;
+                code_point_ = std::to_integer<code_point_type>(input_byte);
+                continue;
+            }
+
+            if (auto const match = table_.find(code_point_, input_byte))
             {
-                code_point = match->second;
+                code_point_ = *match;
                 continue;
             }
 
-            result = write_code_point(result, code_point);
+            result = write_code_point(result, code_point_);
+
+            if (lru_)
+            {
+                lru_->touch(code_point_);
+            }
 
             if (next_code_point_)
             {
-                if (not next_code_word.empty())
+                if (next_entry_)
                 {
-                    table_.emplace(std::move(next_code_word),
-                                   *next_code_point_);
+                    if (next_entry_->reachable)
+                    {
+                        insert_entry(*next_entry_, *next_code_point_);
+                    }
                     update_next_code_point();
                 }
 
-                next_code_word = std::move(input_accumulator);
+                next_entry_ = pending_entry{ code_point_, input_byte };
             }
+            else
+            {
+                full_output_bits_ += current_code_size_;
 
-            input_accumulator = static_cast<char>(input_byte);
+                if (lru_)
+                {
+                    if (next_entry_)
+                    {
+                        reuse_code_point(*next_entry_);
+                    }
+
+                    next_entry_ = pending_entry{ code_point_, input_byte };
+                }
 
-            auto const match = table_.find(input_accumulator);
-            assert(match != table_.end());
-            code_point = match->second;
+                if ((options_ & adaptive_reset) and
+                    full_input_size_ - checked_input_size_ >=
+                      adaptive_reset_interval)
+                {
+                    result = check_compression_ratio(result);
+                }
+            }
+
+            code_point_ = std::to_integer<code_point_type>(input_byte);
         }
 
-        if (not input_accumulator.empty())
+        return result;
+    }
+
+    // Writes the held back match and the end of input, then starts a new
+    // stream
+    template<std::output_iterator<std::byte> O>
+    auto finish(O result) -> O
+    {
+        if (has_match_)
         {
-            result = write_code_point(result, code_point);
+            result = write_code_point(result, code_point_);
         }
 
         result = write_code_point(result, end_input_code_point);
         result = flush_block(result);
 
+        reset();
+
         return result;
     }
 
+    // Discards the current stream
+    void reset() noexcept
+    {
+        init_table();
+        block_ = {};
+        block_end_ = {};
+        has_match_ = false;
+        code_point_ = {};
+        next_entry_ = std::nullopt;
+    }
+
+    // Number of clear codes written with adaptive_reset, over all streams
+    [[nodiscard]] auto num_clears() const noexcept -> std::size_t
+    {
+        return num_clears_;
+    }
+
 private:
     using block_type = std::uint64_t;
     using block_index_type = std::uint32_t;
-    using code_point_type = std::uint32_t;
-    using table_type = absl::flat_hash_map<std::string, code_point_type>;
+    using code_point_type = code_point_t;
+    using table_type = encoder_dictionary;
+
+    // Entries are added one code point late, at the same moment the decoder
+    // is able to reconstruct them
+    struct pending_entry
+    {
+        code_point_type prefix;
+        std::byte next;
+        bool reachable = true;
+    };
 
     static constexpr auto initial_dynamic_code_size = code_point_size_t{ 9 };
-    static constexpr auto end_input_code_point = code_point_type{ 256 };
-    static constexpr auto first_dynamic_code_point = code_point_type{ 257 };
     static constexpr auto block_size = std::numeric_limits<block_type>::digits;
 
     code_point_size_t code_size_;
     options_t options_;
+    code_point_type first_dynamic_code_point_;
     table_type table_;
+    std::optional<code_point_lru> lru_;
+    std::shared_ptr<preset_dictionary const> preset_;
     code_point_size_t current_code_size_ = {};
     std::optional<code_point_type> next_code_point_ = {};
     block_type block_ = {};
     block_index_type block_end_ = {};
+    bool has_match_ = false;
+    code_point_type code_point_ = {};
+    std::optional<pending_entry> next_entry_ = {};
+
+    // Statistics for adaptive_reset, gathered while the dictionary is full
+    std::size_t full_input_size_ = {};
+    std::size_t full_output_bits_ = {};
+    std::size_t checked_input_size_ = {};
+    std::size_t checked_output_bits_ = {};
+    std::size_t window_input_size_ = {};
+    std::size_t window_output_bits_ = {};
+    std::size_t num_clears_ = {};
 
     void update_next_code_point() noexcept
     {
@@ -147,22 +289,100 @@ private:
         ++*next_code_point_;
     }
 
-    void init_table()
+    void insert_entry(pending_entry const& entry,
+                      code_point_type const code_point) noexcept
+    {
+        table_.insert(entry.prefix, entry.next, code_point);
+
+        if (lru_)
+        {
+            lru_->add(code_point, entry.prefix);
+        }
+    }
+
+    // Moves the least recently used entry to a new sequence
+    void reuse_code_point(pending_entry const& entry) noexcept
+    {
+        auto const code_point = lru_->pop_oldest(entry.prefix);
+
+        if (not code_point)
+        {
+            return;
+        }
+
+        lru_->remove_child(table_.prefix(*code_point));
+        table_.erase(*code_point);
+        insert_entry(entry, *code_point);
+    }
+
+    void init_table() noexcept
     {
         table_.clear();
+
+        if (lru_)
+        {
+            lru_->clear();
+        }
+
         current_code_size_ = (options_ & dynamic_code_size)
                                  ? initial_dynamic_code_size
                                  : code_size_;
+        next_code_point_ = first_dynamic_code_point_;
 
-        for (auto const base_symbol :
-             std::views::iota(code_point_type{ 0 }, code_point_type{ 256 }))
+        if (preset_)
         {
-            auto const base_symbol_char = static_cast<char>(base_symbol);
-            table_.emplace(std::string_view{ &base_symbol_char, 1u },
-                           base_symbol);
+            auto const entries = preset_->entries().first(
+                preset_->load_size(code_size_, first_dynamic_code_point_));
+
+            for (auto const& entry : entries)
+            {
+                insert_entry(
+                    pending_entry{
+                        .prefix = preset_dictionary::prefix_code_point(
+                            entry.prefix, first_dynamic_code_point_),
+                        .next = entry.next,
+                    },
+                    *next_code_point_);
+                update_next_code_point();
+            }
         }
 
-        next_code_point_ = first_dynamic_code_point;
+        full_input_size_ = {};
+        full_output_bits_ = {};
+        checked_input_size_ = {};
+        checked_output_bits_ = {};
+        window_input_size_ = {};
+        window_output_bits_ = {};
+    }
+
+    // Clears the dictionary if it compressed the input since the last check
+    // worse than the window before it
+    template<std::output_iterator<std::byte> O>
+    [[nodiscard]] auto check_compression_ratio(O result) -> O
+    {
+        auto const input_size = full_input_size_ - checked_input_size_;
+        auto const output_bits = full_output_bits_ - checked_output_bits_;
+
+        // Compare output bits per input byte (cross-multiplied)
+        auto const got_worse =
+            window_input_size_ > 0u and
+            output_bits * window_input_size_ > window_output_bits_ * input_size;
+
+        if (not got_worse)
+        {
+            checked_input_size_ = full_input_size_;
+            checked_output_bits_ = full_output_bits_;
+            window_input_size_ = input_size;
+            window_output_bits_ = output_bits;
+            return result;
+        }
+
+        result = write_code_point(result, clear_code_point);
+        init_table();
+        next_entry_ = std::nullopt;
+        ++num_clears_;
+
+        return result;
     }
 
     template<std::output_iterator<std::byte> O>
@@ -174,12 +394,25 @@ private:
 
         if (block_size - block_end_ < current_code_size_)
         {
-            while (block_end_ >= 8u)
+            if constexpr (std::contiguous_iterator<O>)
             {
-                *result++ = static_cast<std::byte>(block_ & 0xFFu);
+                // Store the whole block, but only advance past complete bytes
+                store_le(std::to_address(result), block_);
 
-                block_ >>= 8u;
-                block_end_ -= 8u;
+                auto const shift = block_end_ & ~block_index_type{ 7 };
+                result += shift / 8u;
+                block_ = shift < block_size ? block_ >> shift : block_type{};
+                block_end_ -= shift;
+            }
+            else
+            {
+                while (block_end_ >= 8u)
+                {
+                    *result++ = static_cast<std::byte>(block_ & 0xFFu);
+
+                    block_ >>= 8u;
+                    block_end_ -= 8u;
+                }
             }
         }
 
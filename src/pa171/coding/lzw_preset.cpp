@@ -0,0 +1,332 @@
+#include <pa171/coding/lzw_preset.hpp>
+
+#include <array>
+#include <bit>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <pa171/coding/lzw_dictionary.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::lzw
+{
+
+namespace
+{
+
+struct preset_dictionary_header
+{
+    static constexpr auto magic = std::string_view{ "PA171_LZWDICT" };
+
+    std::array<char, magic.size()> magic_value;
+    std::uint32_t num_entries;
+
+    void set_magic() noexcept { std::ranges::copy(magic, magic_value.begin()); }
+
+    [[nodiscard]] auto is_valid() const noexcept -> bool
+    {
+        return std::string_view{ magic_value.data(), magic_value.size() } ==
+               magic;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<preset_dictionary_header>);
+
+// Entries are stored as a little endian prefix followed by the next byte
+constexpr auto serialized_entry_size = sizeof(code_point_t) + 1u;
+
+void
+serialize_entry(preset_dictionary::entry const& entry, std::byte* const output)
+{
+    store_le(output, entry.prefix);
+    output[sizeof(code_point_t)] = entry.next;
+}
+
+[[nodiscard]] auto
+deserialize_entry(std::byte const* const input) -> preset_dictionary::entry
+{
+    return {
+        .prefix = load_le<code_point_t>(input),
+        .next = input[sizeof(code_point_t)],
+    };
+}
+
+// 32-bit FNV-1a over the serialized entries
+[[nodiscard]] auto
+hash_entries(std::span<preset_dictionary::entry const> const entries)
+    -> std::uint32_t
+{
+    auto hash = std::uint32_t{ 0x811C'9DC5 };
+    auto buffer = std::array<std::byte, serialized_entry_size>{};
+
+    for (auto const& entry : entries)
+    {
+        serialize_entry(entry, buffer.data());
+
+        for (auto const value : buffer)
+        {
+            hash ^= std::to_integer<std::uint32_t>(value);
+            hash *= 0x0100'0193u;
+        }
+    }
+
+    return hash != 0u ? hash : 1u;
+}
+
+} // namespace
+
+preset_dictionary::preset_dictionary(std::vector<entry> entries)
+    : entries_{ std::move(entries) }
+{
+    for (auto i = std::size_t{ 0 }; i < entries_.size(); ++i)
+    {
+        if (entries_[i].prefix >= 256u + i)
+        {
+            throw std::invalid_argument{
+                "Preset dictionary entry refers to a later entry"
+            };
+        }
+    }
+
+    id_ = hash_entries(entries_);
+}
+
+auto
+train_preset_dictionary(std::span<std::span<std::byte const> const> samples,
+                        std::size_t const max_entries) -> preset_dictionary
+{
+    struct node
+    {
+        code_point_t prefix;
+        std::byte next;
+        std::size_t length;
+        std::size_t uses;
+    };
+
+    // Grow a larger dictionary than requested, then keep its best entries
+    constexpr auto min_code_size = code_point_size_t{ 12 };
+    constexpr auto max_code_size = code_point_size_t{ 22 };
+    auto const code_size = std::clamp(
+        static_cast<code_point_size_t>(std::bit_width(max_entries * 16u)),
+        min_code_size,
+        max_code_size);
+    auto const max_nodes = (std::size_t{ 1 } << code_size) - 256u;
+
+    auto table = encoder_dictionary{ code_size };
+    auto nodes = std::vector<node>{};
+
+    auto const count_use = [&](code_point_t const code_point)
+    {
+        if (code_point >= 256u)
+        {
+            ++nodes[code_point - 256u].uses;
+        }
+    };
+
+    for (auto const sample : samples)
+    {
+        auto has_match = false;
+        auto code_point = code_point_t{};
+
+        for (auto const input_byte : sample)
+        {
+            if (not has_match)
+            {
+                has_match = true;
+                code_point = std::to_integer<code_point_t>(input_byte);
+                continue;
+            }
+
+            if (auto const match = table.find(code_point, input_byte))
+            {
+                code_point = *match;
+                continue;
+            }
+
+            count_use(code_point);
+
+            if (nodes.size() < max_nodes)
+            {
+                table.insert(code_point,
+                             input_byte,
+                             static_cast<code_point_t>(256u + nodes.size()));
+                nodes.push_back(node{
+                    .prefix = code_point,
+                    .next = input_byte,
+                    .length = code_point < 256u
+                                  ? 2u
+                                  : nodes[code_point - 256u].length + 1u,
+                    .uses = 0u,
+                });
+            }
+
+            code_point = std::to_integer<code_point_t>(input_byte);
+        }
+
+        if (has_match)
+        {
+            count_use(code_point);
+        }
+    }
+
+    // Select nodes by the number of input bytes they covered, adding any
+    // missing prefixes along with them
+    auto order = std::vector<std::size_t>(nodes.size());
+    std::iota(order.begin(), order.end(), std::size_t{ 0 });
+    std::ranges::stable_sort(
+        order,
+        std::greater{},
+        [&](std::size_t const index)
+        { return nodes[index].uses * nodes[index].length; });
+
+    auto selected = std::vector<bool>(nodes.size());
+    auto num_selected = std::size_t{ 0 };
+
+    for (auto const index : order)
+    {
+        if (nodes[index].uses == 0u or num_selected == max_entries)
+        {
+            break;
+        }
+
+        auto num_missing = std::size_t{ 0 };
+        for (auto i = index; not selected[i]; i = nodes[i].prefix - 256u)
+        {
+            ++num_missing;
+
+            if (nodes[i].prefix < 256u)
+            {
+                break;
+            }
+        }
+
+        if (num_selected + num_missing > max_entries)
+        {
+            continue;
+        }
+
+        for (auto i = index; not selected[i]; i = nodes[i].prefix - 256u)
+        {
+            selected[i] = true;
+
+            if (nodes[i].prefix < 256u)
+            {
+                break;
+            }
+        }
+
+        num_selected += num_missing;
+    }
+
+    // Prefixes were created before their extensions, so keeping the node
+    // order only refers to earlier entries
+    auto entry_indices = std::vector<code_point_t>(nodes.size());
+    auto entries = std::vector<preset_dictionary::entry>{};
+    entries.reserve(num_selected);
+
+    for (auto i = std::size_t{ 0 }; i < nodes.size(); ++i)
+    {
+        if (not selected[i])
+        {
+            continue;
+        }
+
+        auto const prefix = nodes[i].prefix;
+        entry_indices[i] = static_cast<code_point_t>(entries.size());
+        entries.push_back(preset_dictionary::entry{
+            .prefix = prefix < 256u ? prefix
+                                    : 256u + entry_indices[prefix - 256u],
+            .next = nodes[i].next,
+        });
+    }
+
+    return preset_dictionary{ std::move(entries) };
+}
+
+auto
+read_preset_dictionary(std::filesystem::path const& path) -> preset_dictionary
+{
+    auto file = std::ifstream{ path, std::ios::binary };
+
+    // Read and validate header
+    auto header = preset_dictionary_header{};
+
+    if (not file.read(
+            reinterpret_cast<char*>(&header),
+            static_cast<std::streamsize>(sizeof(preset_dictionary_header))))
+    {
+        throw std::runtime_error{ "Failed to read dictionary header" };
+    }
+
+    if (not header.is_valid())
+    {
+        throw std::runtime_error{ "Invalid dictionary header" };
+    }
+
+    // More entries than the largest codes can address cannot be used, and
+    // would only make a corrupt file allocate a lot
+    if (header.num_entries > (std::size_t{ 1 } << max_code_size) - 256u)
+    {
+        throw std::runtime_error{ "Too many dictionary entries" };
+    }
+
+    // Read entries
+    auto data =
+        std::vector<std::byte>(header.num_entries * serialized_entry_size);
+
+    if (not file.read(reinterpret_cast<char*>(data.data()),
+                      static_cast<std::streamsize>(data.size())))
+    {
+        throw std::runtime_error{ "Failed to read dictionary entries" };
+    }
+
+    auto entries = std::vector<preset_dictionary::entry>(header.num_entries);
+    for (auto i = std::size_t{ 0 }; i < entries.size(); ++i)
+    {
+        entries[i] = deserialize_entry(data.data() + i * serialized_entry_size);
+    }
+
+    return preset_dictionary{ std::move(entries) };
+}
+
+void
+write_preset_dictionary(std::filesystem::path const& path,
+                        preset_dictionary const& dictionary)
+{
+    auto file = std::ofstream{ path, std::ios::binary };
+
+    // Write header
+    auto header = preset_dictionary_header{};
+    header.num_entries =
+        static_cast<std::uint32_t>(dictionary.entries().size());
+    header.set_magic();
+
+    if (not file.write(
+            reinterpret_cast<char*>(&header),
+            static_cast<std::streamsize>(sizeof(preset_dictionary_header))))
+    {
+        throw std::runtime_error{ "Failed to write dictionary header" };
+    }
+
+    // Write entries
+    auto data = std::vector<std::byte>(dictionary.entries().size() *
+                                       serialized_entry_size);
+    for (auto i = std::size_t{ 0 }; i < dictionary.entries().size(); ++i)
+    {
+        serialize_entry(dictionary.entries()[i],
+                        data.data() + i * serialized_entry_size);
+    }
+
+    if (not file.write(reinterpret_cast<char const*>(data.data()),
+                       static_cast<std::streamsize>(data.size())))
+    {
+        throw std::runtime_error{ "Failed to write dictionary entries" };
+    }
+}
+
+} // namespace pa171::coding::lzw
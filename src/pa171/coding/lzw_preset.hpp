@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/lzw_base.hpp>
+
+namespace pa171::coding::lzw
+{
+
+// Dictionary entries loaded whenever the encoder or decoder (re)initializes
+// its table, so that similar inputs start with their common sequences
+// already known. Entries do not depend on the reserved code points: a
+// prefix below 256 is a single byte, and 256 + i refers to entry i.
+class preset_dictionary
+{
+public:
+    struct entry
+    {
+        code_point_t prefix;
+        std::byte next;
+    };
+
+    preset_dictionary() = default;
+
+    // Throws std::invalid_argument if an entry refers to itself or a later one
+    explicit preset_dictionary(std::vector<entry> entries);
+
+    [[nodiscard]] auto entries() const noexcept -> std::span<entry const>
+    {
+        return entries_;
+    }
+
+    // Hash of the entries, recorded in compressed files to find the
+    // dictionary again. Never 0, which stands for no dictionary.
+    [[nodiscard]] auto id() const noexcept -> std::uint32_t { return id_; }
+
+    // Number of entries loaded into a table of the given code size. At most
+    // half of the dynamic code points are used, the rest are left for
+    // sequences of the input itself.
+    [[nodiscard]] auto load_size(
+        code_point_size_t const code_size,
+        code_point_t const first_dynamic_code_point) const noexcept
+        -> std::size_t
+    {
+        auto const dynamic_code_points =
+            (std::size_t{ 1 } << code_size) - first_dynamic_code_point;
+
+        return std::min(entries_.size(), dynamic_code_points / 2u);
+    }
+
+    // Code point of an entry prefix, in a table whose dynamic code points
+    // start at first_dynamic_code_point
+    [[nodiscard]] static constexpr auto prefix_code_point(
+        code_point_t const prefix,
+        code_point_t const first_dynamic_code_point) noexcept -> code_point_t
+    {
+        return prefix < 256u ? prefix
+                             : first_dynamic_code_point + (prefix - 256u);
+    }
+
+private:
+    std::vector<entry> entries_;
+    std::uint32_t id_ = {};
+};
+
+// Collects the sequences that an LZW dictionary grown over all samples used
+// the most (weighted by their length), together with their prefixes, up to
+// max_entries entries
+[[nodiscard]] auto
+train_preset_dictionary(std::span<std::span<std::byte const> const> samples,
+                        std::size_t max_entries) -> preset_dictionary;
+
+[[nodiscard]] auto read_preset_dictionary(std::filesystem::path const& path)
+    -> preset_dictionary;
+
+void write_preset_dictionary(std::filesystem::path const& path,
+                             preset_dictionary const& dictionary);
+
+} // namespace pa171::coding::lzw
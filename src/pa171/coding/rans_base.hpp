@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pa171::coding::rans
+{
+
+// Range asymmetric numeral system coder with a static model: the frequency
+// of each byte value over the whole input is stored in front of the stream.
+//
+// A stream holds the input size (uint64 LE); unless it is empty, the
+// frequency table (a LEB128 frequency per byte value) and the final encoder
+// state (uint32 LE) follow, then the renormalization bytes in decoding order.
+
+using state_t = std::uint32_t;
+
+using frequency_t = std::uint32_t;
+
+// Frequencies are normalized to sum up to probability_scale
+static constexpr auto probability_bits = 14u;
+static constexpr auto probability_scale = frequency_t{ 1 } << probability_bits;
+
+// States are kept in [state_lower_bound, state_lower_bound << 8) and
+// renormalized a byte at a time
+static constexpr auto state_lower_bound = state_t{ 1 } << 23u;
+
+// The interleaved format spreads consecutive symbols over independent states
+// (lanes), which share one stream of 16-bit renormalization words. States
+// are kept in [interleaved_state_lower_bound, 1 << 32), so each symbol needs
+// at most one word, and a decoding step fits in 32-bit SIMD lanes.
+//
+// A stream holds the input size (uint64 LE); unless it is empty, the
+// frequency table, the final state of each lane (uint32 LE) and the
+// renormalization words (uint16 LE) in decoding order follow.
+static constexpr auto interleaved_lanes = std::size_t{ 16 };
+static constexpr auto interleaved_probability_bits = 12u;
+static constexpr auto interleaved_state_lower_bound = state_t{ 1 } << 16u;
+
+class decode_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+template<unsigned ProbabilityBits>
+class basic_frequency_table
+{
+public:
+    static constexpr auto num_symbols = std::size_t{ 256 };
+    static constexpr auto scale = frequency_t{ 1 } << ProbabilityBits;
+
+    // Normalizes the byte counts of the input; every byte value present in
+    // the input keeps a nonzero frequency
+    [[nodiscard]] static auto from_input(
+        std::span<std::byte const> const input) -> basic_frequency_table
+    {
+        auto counts = std::array<std::size_t, num_symbols>{};
+        for (auto const value : input)
+        {
+            ++counts[std::to_integer<std::size_t>(value)];
+        }
+
+        auto table = basic_frequency_table{};
+        auto total = frequency_t{ 0 };
+
+        for (auto symbol = std::size_t{ 0 }; symbol < num_symbols; ++symbol)
+        {
+            if (counts[symbol] != 0u)
+            {
+                table.frequencies_[symbol] = std::max(
+                    frequency_t{ 1 },
+                    static_cast<frequency_t>(counts[symbol] * scale /
+                                             input.size()));
+                total += table.frequencies_[symbol];
+            }
+        }
+
+        // Give the rounding error to (or take it from) the most frequent
+        // symbols, which it affects the least
+        while (total != scale)
+        {
+            auto const most_frequent =
+                std::ranges::max_element(table.frequencies_);
+
+            if (total < scale)
+            {
+                *most_frequent += scale - total;
+                total = scale;
+            }
+            else
+            {
+                auto const excess = std::min(total - scale,
+                                             *most_frequent / 2u);
+                *most_frequent -= excess;
+                total -= excess;
+            }
+        }
+
+        table.update_cumulative();
+        return table;
+    }
+
+    [[nodiscard]] auto frequency(std::byte const symbol) const noexcept
+        -> frequency_t
+    {
+        return frequencies_[std::to_integer<std::size_t>(symbol)];
+    }
+
+    [[nodiscard]] auto cumulative(std::byte const symbol) const noexcept
+        -> frequency_t
+    {
+        return cumulative_[std::to_integer<std::size_t>(symbol)];
+    }
+
+    void write(std::vector<std::byte>& output) const
+    {
+        for (auto frequency : frequencies_)
+        {
+            do
+            {
+                auto const low_bits = frequency & 0x7Fu;
+                frequency >>= 7u;
+                output.push_back(static_cast<std::byte>(
+                    frequency != 0u ? low_bits | 0x80u : low_bits));
+            } while (frequency != 0u);
+        }
+    }
+
+    // Reads a table written by write(), advancing the input past it
+    [[nodiscard]] static auto read(std::span<std::byte const>& input)
+        -> basic_frequency_table
+    {
+        auto table = basic_frequency_table{};
+
+        for (auto& frequency : table.frequencies_)
+        {
+            for (auto shift = 0u;; shift += 7u)
+            {
+                if (input.empty() or shift > ProbabilityBits)
+                {
+                    throw decode_error{ "Invalid frequency table" };
+                }
+
+                auto const value = std::to_integer<frequency_t>(input.front());
+                input = input.subspan(1u);
+
+                frequency |= (value & 0x7Fu) << shift;
+
+                if ((value & 0x80u) == 0u)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (std::accumulate(table.frequencies_.begin(),
+                            table.frequencies_.end(),
+                            std::uint64_t{ 0 }) != scale)
+        {
+            throw decode_error{ "Invalid frequency table" };
+        }
+
+        table.update_cumulative();
+        return table;
+    }
+
+private:
+    std::array<frequency_t, num_symbols> frequencies_ = {};
+    std::array<frequency_t, num_symbols> cumulative_ = {};
+
+    void update_cumulative() noexcept
+    {
+        std::exclusive_scan(frequencies_.begin(),
+                            frequencies_.end(),
+                            cumulative_.begin(),
+                            frequency_t{ 0 });
+    }
+};
+
+using frequency_table = basic_frequency_table<probability_bits>;
+
+using interleaved_frequency_table =
+    basic_frequency_table<interleaved_probability_bits>;
+
+} // namespace pa171::coding::rans
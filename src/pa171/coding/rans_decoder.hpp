@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/rans_base.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::rans
+{
+
+class decoder
+{
+public:
+    // Decodes a whole stream into output and returns the decoded size;
+    // throws if the stream is invalid or the output does not fit
+    auto operator()(std::span<std::byte const> input,
+                    std::span<std::byte> const output) -> std::size_t
+    {
+        if (input.size() < sizeof(std::uint64_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto const size = load_le<std::uint64_t>(input.data());
+        input = input.subspan(sizeof(std::uint64_t));
+
+        if (size > output.size())
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        if (size == 0u)
+        {
+            return 0u;
+        }
+
+        init_slots(frequency_table::read(input));
+
+        if (input.size() < sizeof(state_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto state = load_le<state_t>(input.data());
+        auto first = input.begin() + sizeof(state_t);
+        auto const last = input.end();
+
+        for (auto& value : output.first(static_cast<std::size_t>(size)))
+        {
+            auto const& slot = slots_[state & (probability_scale - 1u)];
+            value = slot.symbol;
+            state = slot.frequency * (state >> probability_bits) + slot.offset;
+
+            while (state < state_lower_bound)
+            {
+                if (first == last)
+                {
+                    throw decode_error{ "Unexpected end of input" };
+                }
+
+                state = (state << 8u) | std::to_integer<state_t>(*first++);
+            }
+        }
+
+        // The encoder starts from the lower bound
+        if (state != state_lower_bound or first != last)
+        {
+            throw decode_error{ "Invalid rANS stream" };
+        }
+
+        return static_cast<std::size_t>(size);
+    }
+
+private:
+    // Decoding step for each value of the low probability_bits of the state
+    struct slot
+    {
+        std::uint16_t frequency;
+        std::uint16_t offset;
+        std::byte symbol;
+    };
+
+    std::vector<slot> slots_ = std::vector<slot>(probability_scale);
+
+    void init_slots(frequency_table const& table) noexcept
+    {
+        for (auto value = std::size_t{ 0 };
+             value < frequency_table::num_symbols;
+             ++value)
+        {
+            auto const symbol = static_cast<std::byte>(value);
+            auto const frequency = table.frequency(symbol);
+            auto const begin = table.cumulative(symbol);
+
+            for (auto i = frequency_t{ 0 }; i < frequency; ++i)
+            {
+                slots_[begin + i] = slot{
+                    .frequency = static_cast<std::uint16_t>(frequency),
+                    .offset = static_cast<std::uint16_t>(i),
+                    .symbol = symbol,
+                };
+            }
+        }
+    }
+};
+
+} // namespace pa171::coding::rans
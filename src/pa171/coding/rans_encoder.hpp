@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/rans_base.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::rans
+{
+
+class encoder
+{
+public:
+    // Appends the coded input to output
+    void operator()(std::span<std::byte const> const input,
+                    std::vector<std::byte>& output)
+    {
+        auto const output_offset = output.size();
+        output.resize(output_offset + sizeof(std::uint64_t));
+        store_le(output.data() + output_offset,
+                 static_cast<std::uint64_t>(input.size()));
+
+        if (input.empty())
+        {
+            return;
+        }
+
+        auto const table = frequency_table::from_input(input);
+        table.write(output);
+
+        // Symbols are coded in reverse, so that the decoder reads them (and
+        // the renormalization bytes) forwards. Each symbol emits at most two
+        // bytes.
+        buffer_.resize(2u * input.size() + sizeof(state_t));
+        auto position = buffer_.size();
+        auto state = state_lower_bound;
+
+        for (auto i = input.size(); i > 0u; --i)
+        {
+            auto const symbol = input[i - 1u];
+            auto const frequency = table.frequency(symbol);
+            auto const max_state =
+                ((state_lower_bound >> probability_bits) << 8u) * frequency;
+
+            while (state >= max_state)
+            {
+                buffer_[--position] = static_cast<std::byte>(state & 0xFFu);
+                state >>= 8u;
+            }
+
+            state = ((state / frequency) << probability_bits) +
+                    state % frequency + table.cumulative(symbol);
+        }
+
+        position -= sizeof(state_t);
+        store_le(buffer_.data() + position, state);
+
+        output.insert(output.end(),
+                      buffer_.begin() + static_cast<std::ptrdiff_t>(position),
+                      buffer_.end());
+    }
+
+private:
+    std::vector<std::byte> buffer_;
+};
+
+} // namespace pa171::coding::rans
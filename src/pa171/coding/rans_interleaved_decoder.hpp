@@ -0,0 +1,279 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/rans_base.hpp>
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/simd.hpp>
+
+namespace pa171::coding::rans
+{
+
+// Decodes the interleaved format, see interleaved_lanes. With AVX2, whole
+// groups of interleaved_lanes symbols are decoded at once (as two vectors of
+// eight lanes); the scalar path decodes the same output.
+class interleaved_decoder
+{
+public:
+    explicit interleaved_decoder(bool const allow_simd = true)
+        : use_simd_{ allow_simd and has_avx2() }
+    {
+    }
+
+    // Decodes a whole stream into output and returns the decoded size;
+    // throws if the stream is invalid or the output does not fit
+    auto operator()(std::span<std::byte const> input,
+                    std::span<std::byte> const output) -> std::size_t
+    {
+        if (input.size() < sizeof(std::uint64_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto const size = load_le<std::uint64_t>(input.data());
+        input = input.subspan(sizeof(std::uint64_t));
+
+        if (size > output.size())
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        if (size == 0u)
+        {
+            return 0u;
+        }
+
+        init_slots(interleaved_frequency_table::read(input));
+
+        if (input.size() < interleaved_lanes * sizeof(state_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto states = std::array<state_t, interleaved_lanes>{};
+        for (auto lane = std::size_t{ 0 }; lane < interleaved_lanes; ++lane)
+        {
+            states[lane] =
+                load_le<state_t>(input.data() + lane * sizeof(state_t));
+        }
+
+        auto first = input.data() + interleaved_lanes * sizeof(state_t);
+        auto const last = input.data() + input.size();
+        auto result = output.data();
+        auto const result_last = result + size;
+
+#ifdef PA171_X86_SIMD
+        if (use_simd_)
+        {
+            decode_avx2(states, first, last, result, result_last);
+        }
+#endif
+
+        decode_scalar(states, first, last, result, result_last);
+
+        // The encoder starts from the lower bound
+        for (auto const state : states)
+        {
+            if (state != interleaved_state_lower_bound)
+            {
+                throw decode_error{ "Invalid rANS stream" };
+            }
+        }
+
+        if (first != last)
+        {
+            throw decode_error{ "Invalid rANS stream" };
+        }
+
+        return static_cast<std::size_t>(size);
+    }
+
+private:
+    using word_type = std::uint16_t;
+
+    // Decoding step for each value of the low probability bits of a state,
+    // packed as the symbol (8 bits), the offset of the value within the
+    // symbol's range (12 bits) and the symbol frequency minus one (12 bits)
+    using slot_type = std::uint32_t;
+
+    static constexpr auto slot_mask =
+        (slot_type{ 1 } << interleaved_probability_bits) - 1u;
+
+    std::vector<slot_type> slots_ =
+        std::vector<slot_type>(interleaved_frequency_table::scale);
+    bool use_simd_;
+
+    void init_slots(interleaved_frequency_table const& table) noexcept
+    {
+        for (auto value = std::size_t{ 0 };
+             value < interleaved_frequency_table::num_symbols;
+             ++value)
+        {
+            auto const symbol = static_cast<std::byte>(value);
+            auto const frequency = table.frequency(symbol);
+            auto const begin = table.cumulative(symbol);
+
+            for (auto i = frequency_t{ 0 }; i < frequency; ++i)
+            {
+                slots_[begin + i] =
+                    (static_cast<slot_type>(value) << 24u) |
+                    (i << interleaved_probability_bits) | (frequency - 1u);
+            }
+        }
+    }
+
+    // Decodes the remaining symbols; the next one belongs to the first lane
+    void decode_scalar(std::array<state_t, interleaved_lanes>& states,
+                       std::byte const*& first,
+                       std::byte const* const last,
+                       std::byte*& result,
+                       std::byte* const result_last) const
+    {
+        for (auto lane = std::size_t{ 0 }; result != result_last;
+             lane = (lane + 1u) % interleaved_lanes)
+        {
+            auto& state = states[lane];
+            auto const slot = slots_[state & slot_mask];
+
+            *result++ = static_cast<std::byte>(slot >> 24u);
+            state = ((slot & slot_mask) + 1u) *
+                        (state >> interleaved_probability_bits) +
+                    ((slot >> interleaved_probability_bits) & slot_mask);
+
+            if (state < interleaved_state_lower_bound)
+            {
+                if (last - first <
+                    static_cast<std::ptrdiff_t>(sizeof(word_type)))
+                {
+                    throw decode_error{ "Unexpected end of input" };
+                }
+
+                state = (state << 16u) | load_le<word_type>(first);
+                first += sizeof(word_type);
+            }
+        }
+    }
+
+#ifdef PA171_X86_SIMD
+    static_assert(interleaved_lanes == 16u);
+
+    // For each mask of lanes that need a word, the index of the word each
+    // lane takes (words are assigned to the lanes in order)
+    static constexpr auto word_permutations = []
+    {
+        auto permutations = std::array<std::array<std::uint32_t, 8>, 256>{};
+
+        for (auto mask = 0u; mask < 256u; ++mask)
+        {
+            for (auto lane = 0u; lane < 8u; ++lane)
+            {
+                permutations[mask][lane] = static_cast<std::uint32_t>(
+                    std::popcount(mask & ((1u << lane) - 1u)));
+            }
+        }
+
+        return permutations;
+    }();
+
+    // Decodes whole groups of symbols while the input surely holds all the
+    // words they may need
+    PA171_TARGET_AVX2 void
+    decode_avx2(std::array<state_t, interleaved_lanes>& states,
+                std::byte const*& first,
+                std::byte const* const last,
+                std::byte*& result,
+                std::byte* const result_last) const
+    {
+        constexpr auto max_group_words = interleaved_lanes * sizeof(word_type);
+
+        auto states_low = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(states.data()));
+        auto states_high = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(states.data() + 8));
+
+        while (result_last - result >=
+                   static_cast<std::ptrdiff_t>(interleaved_lanes) and
+               last - first >= static_cast<std::ptrdiff_t>(max_group_words))
+        {
+            auto const slots_low = gather_slots(states_low);
+            auto const slots_high = gather_slots(states_high);
+
+            // Narrow the symbols of both vectors to 16 consecutive bytes
+            auto const symbols_16 = _mm256_permute4x64_epi64(
+                _mm256_packus_epi32(_mm256_srli_epi32(slots_low, 24),
+                                    _mm256_srli_epi32(slots_high, 24)),
+                0xD8);
+            auto const symbols_8 = _mm256_permute4x64_epi64(
+                _mm256_packus_epi16(symbols_16, symbols_16), 0xD8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result),
+                             _mm256_castsi256_si128(symbols_8));
+            result += interleaved_lanes;
+
+            states_low = renormalize(advance(states_low, slots_low), first);
+            states_high = renormalize(advance(states_high, slots_high), first);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(states.data()),
+                            states_low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(states.data() + 8),
+                            states_high);
+    }
+
+    PA171_TARGET_AVX2 auto gather_slots(__m256i const states) const -> __m256i
+    {
+        return _mm256_i32gather_epi32(
+            reinterpret_cast<int const*>(slots_.data()),
+            _mm256_and_si256(states, _mm256_set1_epi32(slot_mask)),
+            sizeof(slot_type));
+    }
+
+    PA171_TARGET_AVX2 static auto advance(__m256i const states,
+                                          __m256i const slots) -> __m256i
+    {
+        auto const mask = _mm256_set1_epi32(slot_mask);
+        auto const frequencies = _mm256_add_epi32(_mm256_and_si256(slots, mask),
+                                                  _mm256_set1_epi32(1));
+        auto const offsets = _mm256_and_si256(
+            _mm256_srli_epi32(slots, interleaved_probability_bits), mask);
+
+        return _mm256_add_epi32(
+            _mm256_mullo_epi32(
+                frequencies,
+                _mm256_srli_epi32(states, interleaved_probability_bits)),
+            offsets);
+    }
+
+    // Shifts a word into each state below the lower bound, taking the words
+    // in lane order
+    PA171_TARGET_AVX2 static auto renormalize(__m256i const states,
+                                              std::byte const*& first)
+        -> __m256i
+    {
+        auto const needed = _mm256_cmpeq_epi32(_mm256_srli_epi32(states, 16),
+                                                _mm256_setzero_si256());
+        auto const mask = static_cast<unsigned>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(needed)));
+
+        auto const words = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(first)));
+        auto const lane_words = _mm256_permutevar8x32_epi32(
+            words,
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(
+                word_permutations[mask].data())));
+        first += static_cast<std::size_t>(std::popcount(mask)) *
+                 sizeof(word_type);
+
+        return _mm256_blendv_epi8(
+            states,
+            _mm256_or_si256(_mm256_slli_epi32(states, 16), lane_words),
+            needed);
+    }
+#endif
+};
+
+} // namespace pa171::coding::rans
@@ -0,0 +1 @@
+#include <pa171/coding/rans_interleaved_encoder.hpp>
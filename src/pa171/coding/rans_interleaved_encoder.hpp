@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/rans_base.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::rans
+{
+
+// Encodes the interleaved format, see interleaved_lanes
+class interleaved_encoder
+{
+public:
+    // Appends the coded input to output
+    void operator()(std::span<std::byte const> const input,
+                    std::vector<std::byte>& output)
+    {
+        using word_type = std::uint16_t;
+
+        auto const output_offset = output.size();
+        output.resize(output_offset + sizeof(std::uint64_t));
+        store_le(output.data() + output_offset,
+                 static_cast<std::uint64_t>(input.size()));
+
+        if (input.empty())
+        {
+            return;
+        }
+
+        auto const table = interleaved_frequency_table::from_input(input);
+        table.write(output);
+
+        // Symbols are coded in reverse, each into the state of its lane, so
+        // that the decoder reads them (and the words) forwards
+        buffer_.resize(input.size() * sizeof(word_type) +
+                       interleaved_lanes * sizeof(state_t));
+        auto position = buffer_.size();
+
+        auto states = std::array<state_t, interleaved_lanes>{};
+        states.fill(interleaved_state_lower_bound);
+
+        for (auto i = input.size(); i > 0u; --i)
+        {
+            auto const symbol = input[i - 1u];
+            auto const frequency = table.frequency(symbol);
+            // Can be 1 << 32 for a single symbol input
+            auto const max_state =
+                (std::uint64_t{ interleaved_state_lower_bound >>
+                                interleaved_probability_bits }
+                 << 16u) *
+                frequency;
+            auto& state = states[(i - 1u) % interleaved_lanes];
+
+            if (state >= max_state)
+            {
+                position -= sizeof(word_type);
+                store_le(buffer_.data() + position,
+                         static_cast<word_type>(state & 0xFFFFu));
+                state >>= 16u;
+            }
+
+            state = ((state / frequency) << interleaved_probability_bits) +
+                    state % frequency + table.cumulative(symbol);
+        }
+
+        for (auto lane = interleaved_lanes; lane > 0u; --lane)
+        {
+            position -= sizeof(state_t);
+            store_le(buffer_.data() + position, states[lane - 1u]);
+        }
+
+        output.insert(output.end(),
+                      buffer_.begin() + static_cast<std::ptrdiff_t>(position),
+                      buffer_.end());
+    }
+
+private:
+    std::vector<std::byte> buffer_;
+};
+
+} // namespace pa171::coding::rans
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/quantization/subband.hpp>
+
+namespace pa171::coding::subband
+{
+
+// Context modelled coder for the subbands of transformed regions. Each value
+// is coded as binary decisions (zero, sign, unary magnitude and an escape)
+// with the binary range coder, in contexts selected by the kind and level of
+// its subband and by the already coded values around it: its left and upper
+// neighbours and its parent (the value at the same place one level coarser).
+// Approximations and untransformed samples are predicted from their
+// neighbours first (as in LOCO-I) and their residuals coded instead.
+//
+// Within a region, subbands are coded from the approximation to the finest
+// level, so that parents precede their children. The models adapt over all
+// regions of the input.
+//
+// A stream holds the input size (uint64 LE) followed by the range coder
+// output.
+
+using arithmetic::decode_error;
+
+static constexpr auto num_level_classes = std::size_t{ 5 };
+static constexpr auto num_activity_classes = std::size_t{ 8 };
+static constexpr auto num_parent_classes = std::size_t{ 3 };
+static constexpr auto num_sign_classes = std::size_t{ 9 };
+static constexpr auto num_magnitude_classes = std::size_t{ 4 };
+
+// Magnitudes above this are coded as num_escape_bits binary digits
+static constexpr auto num_unary_bits = 14;
+static constexpr auto num_escape_bits = 7;
+
+// Codes the values of the given subbands, which must cover the data exactly.
+// code_bit(model, bit) codes a single decision: an encoder codes the given
+// bit and returns it, a decoder returns the decoded bit. With mutable data,
+// decoded values are stored as they are coded.
+class model
+{
+public:
+    template<typename T, typename CodeBit>
+    requires std::same_as<std::remove_const_t<T>, std::byte> and
+             std::invocable<CodeBit&, arithmetic::bit_model&, bool>
+    void code(std::span<T> const data,
+              std::span<quantization::subband const> const subbands,
+              CodeBit&& code_bit)
+    {
+        contexts_.fill({});
+
+        auto region_offset = std::size_t{ 0 };
+        auto region_first = subbands.begin();
+
+        for (auto it = subbands.begin(); it != subbands.end(); ++it)
+        {
+            if (it->kind != quantization::subband_kind::approximation and
+                it->kind != quantization::subband_kind::samples)
+            {
+                continue;
+            }
+
+            // The approximation (or the samples) ends a region
+            auto const region = std::span{ region_first, it + 1 };
+            auto region_size = std::size_t{ 0 };
+            for (auto const& band : region)
+            {
+                region_size += band.size();
+            }
+
+            if (region_size > data.size() - region_offset)
+            {
+                throw std::invalid_argument{ "Subbands exceed the data" };
+            }
+
+            code_region(
+                data.subspan(region_offset, region_size), region, code_bit);
+
+            region_offset += region_size;
+            region_first = it + 1;
+        }
+
+        if (region_first != subbands.end() or region_offset != data.size())
+        {
+            throw std::invalid_argument{ "Subbands do not cover the data" };
+        }
+    }
+
+private:
+    struct value_contexts
+    {
+        std::array<std::array<arithmetic::bit_model, num_parent_classes>,
+                   num_activity_classes>
+            zero;
+        std::array<arithmetic::bit_model, num_sign_classes> sign;
+        std::array<std::array<arithmetic::bit_model, num_unary_bits>,
+                   num_magnitude_classes>
+            magnitude;
+        std::array<arithmetic::bit_model, num_escape_bits> escape;
+    };
+
+    template<typename T>
+    struct plane
+    {
+        T* data;
+        std::size_t width;
+        std::size_t height;
+    };
+
+    // Detail contexts by orientation and level class, then the contexts of
+    // predicted values
+    std::array<value_contexts, 3u * num_level_classes + 1u> contexts_;
+    std::vector<std::size_t> offsets_;
+
+    template<typename T, typename CodeBit>
+    void code_region(std::span<T> const data,
+                     std::span<quantization::subband const> const region,
+                     CodeBit& code_bit)
+    {
+        offsets_.resize(region.size());
+        auto offset = std::size_t{ 0 };
+        for (auto i = std::size_t{ 0 }; i < region.size(); ++i)
+        {
+            offsets_[i] = offset;
+            offset += region[i].size();
+        }
+
+        // The last coded (so one level coarser) subband of each orientation
+        auto parents = std::array<std::optional<plane<T>>, 3>{};
+
+        for (auto i = region.size(); i > 0u; --i)
+        {
+            auto const& band = region[i - 1u];
+            auto const current = plane<T>{
+                data.data() + offsets_[i - 1u], band.width, band.height
+            };
+
+            switch (band.kind)
+            {
+                case quantization::subband_kind::approximation:
+                    code_predicted(current, 0x00u, code_bit);
+                    break;
+                case quantization::subband_kind::samples:
+                    // Unsigned values, flipping the top bit makes them signed
+                    code_predicted(current, 0x80u, code_bit);
+                    break;
+                default:
+                {
+                    auto const orientation =
+                        static_cast<std::size_t>(band.kind);
+                    auto& contexts =
+                        contexts_[orientation * num_level_classes +
+                                  std::min(band.level, num_level_classes - 1u)];
+
+                    code_detail(
+                        current, parents[orientation], contexts, code_bit);
+                    parents[orientation] = current;
+                    break;
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    [[nodiscard]] static auto load(T const* const data,
+                                   std::uint8_t const flip = 0u) noexcept
+        -> int
+    {
+        return static_cast<std::int8_t>(std::to_integer<std::uint8_t>(*data) ^
+                                        flip);
+    }
+
+    template<typename T>
+    static void
+    store(T* const data, int const value, std::uint8_t const flip = 0u) noexcept
+    {
+        if constexpr (not std::is_const_v<T>)
+        {
+            *data = static_cast<std::byte>(static_cast<std::uint8_t>(value) ^
+                                           flip);
+        }
+    }
+
+    [[nodiscard]] static auto activity_class(unsigned const activity) noexcept
+        -> std::size_t
+    {
+        return std::min(static_cast<std::size_t>(std::bit_width(activity)),
+                        num_activity_classes - 1u);
+    }
+
+    template<typename T, typename CodeBit>
+    void code_detail(plane<T> const band,
+                     std::optional<plane<T>> const& parent,
+                     value_contexts& contexts,
+                     CodeBit& code_bit)
+    {
+        auto const has_parent =
+            parent and parent->width != 0u and parent->height != 0u;
+
+        for (auto y = std::size_t{ 0 }; y < band.height; ++y)
+        {
+            auto const row = band.data + y * band.width;
+            auto const above = y > 0u ? row - band.width : row;
+
+            for (auto x = std::size_t{ 0 }; x < band.width; ++x)
+            {
+                auto const left = x > 0u ? load(row + x - 1u) : 0;
+                auto const top = y > 0u ? load(above + x) : 0;
+                auto const top_left = x > 0u and y > 0u ? load(above + x - 1u)
+                                                        : 0;
+                auto const top_right =
+                    y > 0u and x + 1u < band.width ? load(above + x + 1u) : 0;
+
+                auto const activity = static_cast<unsigned>(
+                    2 * (std::abs(left) + std::abs(top)) +
+                    std::abs(top_left) + std::abs(top_right));
+
+                auto parent_class = std::size_t{ 0 };
+                if (has_parent)
+                {
+                    auto const parent_value = load(
+                        parent->data +
+                        std::min(y / 2u, parent->height - 1u) * parent->width +
+                        std::min(x / 2u, parent->width - 1u));
+                    parent_class = std::min(
+                        static_cast<std::size_t>(std::abs(parent_value)),
+                        num_parent_classes - 1u);
+                }
+
+                auto const sign_class = static_cast<std::size_t>(
+                    (left > 0) - (left < 0) + 1) * 3u +
+                    static_cast<std::size_t>((top > 0) - (top < 0) + 1);
+
+                auto const value = code_value(contexts,
+                                              activity_class(activity),
+                                              parent_class,
+                                              sign_class,
+                                              load(row + x),
+                                              code_bit);
+                store(row + x, value);
+            }
+        }
+    }
+
+    // Codes the residuals of the median edge detecting predictor
+    template<typename T, typename CodeBit>
+    void code_predicted(plane<T> const band,
+                        std::uint8_t const flip,
+                        CodeBit& code_bit)
+    {
+        auto& contexts = contexts_.back();
+
+        for (auto y = std::size_t{ 0 }; y < band.height; ++y)
+        {
+            auto const row = band.data + y * band.width;
+            auto const above = y > 0u ? row - band.width : row;
+
+            for (auto x = std::size_t{ 0 }; x < band.width; ++x)
+            {
+                // Missing neighbours are replaced by the nearest present ones
+                auto left = x > 0u ? load(row + x - 1u, flip) : 0;
+                auto top = y > 0u ? load(above + x, flip) : left;
+                if (x == 0u)
+                {
+                    left = top;
+                }
+                auto const top_left =
+                    x > 0u and y > 0u ? load(above + x - 1u, flip) : top;
+                auto const top_right = y > 0u and x + 1u < band.width
+                                           ? load(above + x + 1u, flip)
+                                           : top;
+
+                auto prediction = left + top - top_left;
+                if (top_left >= std::max(left, top))
+                {
+                    prediction = std::min(left, top);
+                }
+                else if (top_left <= std::min(left, top))
+                {
+                    prediction = std::max(left, top);
+                }
+
+                auto const activity = static_cast<unsigned>(
+                    std::abs(top_right - top) + std::abs(top - top_left) +
+                    std::abs(top_left - left));
+
+                // Residuals wrap around like the values
+                auto const residual = wrap(load(row + x, flip) - prediction);
+                auto const value =
+                    wrap(prediction + code_value(contexts,
+                                                 activity_class(activity),
+                                                 0u,
+                                                 0u,
+                                                 residual,
+                                                 code_bit));
+                store(row + x, value, flip);
+            }
+        }
+    }
+
+    [[nodiscard]] static auto wrap(int const value) noexcept -> int
+    {
+        return static_cast<std::int8_t>(static_cast<std::uint8_t>(value));
+    }
+
+    // Codes a value in [-128, 127] and returns it (as decoded)
+    template<typename CodeBit>
+    [[nodiscard]] static auto code_value(value_contexts& contexts,
+                                         std::size_t const activity_class,
+                                         std::size_t const parent_class,
+                                         std::size_t const sign_class,
+                                         int const value,
+                                         CodeBit& code_bit) -> int
+    {
+        if (not code_bit(contexts.zero[activity_class][parent_class],
+                         value != 0))
+        {
+            return 0;
+        }
+
+        auto const negative = code_bit(contexts.sign[sign_class], value < 0);
+
+        // The magnitude is at least 1
+        auto const remainder = std::abs(value) - 1;
+        auto& unary = contexts.magnitude[std::min(activity_class / 2u,
+                                                  num_magnitude_classes - 1u)];
+        auto magnitude = 0;
+
+        while (magnitude < num_unary_bits and
+               code_bit(unary[static_cast<std::size_t>(magnitude)],
+                        remainder > magnitude))
+        {
+            ++magnitude;
+        }
+
+        if (magnitude == num_unary_bits)
+        {
+            auto const escape = remainder - num_unary_bits;
+            for (auto bit = num_escape_bits - 1; bit >= 0; --bit)
+            {
+                if (code_bit(contexts.escape[static_cast<std::size_t>(bit)],
+                             ((escape >> bit) & 1) != 0))
+                {
+                    magnitude += 1 << bit;
+                }
+            }
+        }
+
+        return negative ? -(magnitude + 1) : magnitude + 1;
+    }
+};
+
+} // namespace pa171::coding::subband
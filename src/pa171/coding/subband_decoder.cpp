@@ -0,0 +1 @@
+#include <pa171/coding/subband_decoder.hpp>
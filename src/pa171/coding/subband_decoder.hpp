@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/coding/subband_base.hpp>
+#include <pa171/quantization/subband.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::subband
+{
+
+class decoder
+{
+public:
+    // Decodes a whole stream into output, laid out as the given subbands, and
+    // returns the decoded size; throws if the stream is invalid or does not
+    // match the subbands
+    auto operator()(std::span<std::byte const> input,
+                    std::span<quantization::subband const> const subbands,
+                    std::span<std::byte> const output) -> std::size_t
+    {
+        if (input.size() < sizeof(std::uint64_t))
+        {
+            throw decode_error{ "Unexpected end of input" };
+        }
+
+        auto const size = load_le<std::uint64_t>(input.data());
+        input = input.subspan(sizeof(std::uint64_t));
+
+        if (size > output.size())
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        auto range_decoder = arithmetic::range_decoder{ input };
+
+        try
+        {
+            model_.code(output.first(static_cast<std::size_t>(size)),
+                        subbands,
+                        [&](arithmetic::bit_model& model, bool /*bit*/)
+                        { return range_decoder.decode(model); });
+        }
+        catch (std::invalid_argument const&)
+        {
+            throw decode_error{ "Stream does not match the subbands" };
+        }
+
+        if (not range_decoder.finished())
+        {
+            throw decode_error{ "Invalid subband stream" };
+        }
+
+        return static_cast<std::size_t>(size);
+    }
+
+private:
+    model model_;
+};
+
+} // namespace pa171::coding::subband
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <pa171/coding/arithmetic.hpp>
+#include <pa171/coding/subband_base.hpp>
+#include <pa171/quantization/subband.hpp>
+#include <pa171/utils/endian.hpp>
+
+namespace pa171::coding::subband
+{
+
+class encoder
+{
+public:
+    // Appends the coded input, laid out as the given subbands, to output
+    void operator()(std::span<std::byte const> const input,
+                    std::span<quantization::subband const> const subbands,
+                    std::vector<std::byte>& output)
+    {
+        auto const output_offset = output.size();
+        output.resize(output_offset + sizeof(std::uint64_t));
+        store_le(output.data() + output_offset,
+                 static_cast<std::uint64_t>(input.size()));
+
+        auto range_encoder = arithmetic::range_encoder{ output };
+
+        model_.code(input,
+                    subbands,
+                    [&](arithmetic::bit_model& model, bool const bit)
+                    {
+                        range_encoder.encode(model, bit);
+                        return bit;
+                    });
+
+        range_encoder.finish();
+    }
+
+private:
+    model model_;
+};
+
+} // namespace pa171::coding::subband
@@ -0,0 +1 @@
+#include <pa171/coding/zero_run.hpp>
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pa171::coding::zero_run
+{
+
+// Replaces runs of zero bytes, which dominate quantized detail subbands, by
+// their length. Nonzero bytes are kept as they are; each run of zeros becomes
+// a single zero byte followed by the number of further zeros (LEB128).
+
+using run_length_t = std::uint64_t;
+
+class decode_error : public std::runtime_error
+{
+public:
+    using runtime_error::runtime_error;
+};
+
+// Isolated zeros take two bytes
+[[nodiscard]] constexpr auto
+max_encoded_size(std::size_t const input_size) noexcept -> std::size_t
+{
+    return 2u * input_size;
+}
+
+// Appends the coded input to output
+inline void
+encode(std::span<std::byte const> const input, std::vector<std::byte>& output)
+{
+    constexpr auto zero = std::byte{ 0 };
+
+    auto first = input.begin();
+    auto const last = input.end();
+
+    while (first != last)
+    {
+        auto const run_first = std::find(first, last, zero);
+        output.insert(output.end(), first, run_first);
+
+        if (run_first == last)
+        {
+            break;
+        }
+
+        first = std::find_if(run_first + 1,
+                             last,
+                             [](std::byte const value)
+                             { return value != zero; });
+
+        output.push_back(zero);
+        for (auto extra = static_cast<run_length_t>(first - run_first - 1);;)
+        {
+            auto const low_bits = static_cast<std::uint8_t>(extra & 0x7Fu);
+            extra >>= 7u;
+
+            if (extra == 0u)
+            {
+                output.push_back(static_cast<std::byte>(low_bits));
+                break;
+            }
+
+            output.push_back(static_cast<std::byte>(low_bits | 0x80u));
+        }
+    }
+}
+
+// Decodes a whole stream into output and returns the decoded size; throws if
+// the stream is invalid or the output does not fit
+[[nodiscard]] inline auto
+decode(std::span<std::byte const> const input,
+       std::span<std::byte> const output) -> std::size_t
+{
+    constexpr auto zero = std::byte{ 0 };
+
+    auto first = input.begin();
+    auto const last = input.end();
+    auto result = output.begin();
+
+    while (first != last)
+    {
+        auto const run_first = std::find(first, last, zero);
+        if (run_first - first > output.end() - result)
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        result = std::copy(first, run_first, result);
+        first = run_first;
+
+        if (first == last)
+        {
+            break;
+        }
+
+        auto extra = run_length_t{ 0 };
+        for (auto shift = 0u;; shift += 7u)
+        {
+            if (++first == last or shift >= 63u)
+            {
+                throw decode_error{ "Invalid zero run" };
+            }
+
+            auto const value = std::to_integer<run_length_t>(*first);
+            extra |= (value & 0x7Fu) << shift;
+
+            if ((value & 0x80u) == 0u)
+            {
+                ++first;
+                break;
+            }
+        }
+
+        if (extra >= static_cast<run_length_t>(output.end() - result))
+        {
+            throw decode_error{ "Output buffer too small" };
+        }
+
+        result = std::fill_n(result, extra + 1u, zero);
+    }
+
+    return static_cast<std::size_t>(result - output.begin());
+}
+
+} // namespace pa171::coding::zero_run
@@ -1,32 +1,48 @@
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <variant>
 #include <vector>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 #include <lyra/lyra.hpp>
 
+#include <pa171/coding/lzw_base.hpp>
+#include <pa171/coding/lzw_preset.hpp>
 #include <pa171/compressed_image_io.hpp>
 #include <pa171/compression_options.hpp>
 #include <pa171/image_encoder.hpp>
 #include <pa171/image_io.hpp>
+#include <pa171/transform/boundary.hpp>
+#include <pa171/utils/parallel.hpp>
 
 auto
 main(int const argc, char const* const* const argv) -> int
 {
   try
   {
-    constexpr auto max_loss_level = 64u;
-    constexpr auto q_factor_per_loss_level = 2u;
-    constexpr auto region_size = 32u;
-
     // Parse arguments
     auto show_help = false;
     auto show_stats = false;
     auto loss_level = 8u;
+    auto wavelet = std::string{ "haar" };
+    auto boundary = std::string{ "periodic" };
+    auto coder = std::string{ "lzw" };
+    auto chunk_size_kib = 0u;
+    auto code_size = pa171::coding::lzw::default_code_size;
+    auto reuse_code_points = false;
+    auto adaptive_reset = false;
+    auto zero_runs = false;
+    auto num_threads = pa171::default_num_threads();
+    auto dictionary_path = std::filesystem::path{};
     auto in_path = std::filesystem::path{};
     auto out_path = std::filesystem::path{};
 
@@ -44,7 +60,84 @@ main(int const argc, char const* const* const argv) -> int
             .help(fmt::format(
               "Compression level. 0 = lossless; default = {}; max = {}",
               loss_level,
-              max_loss_level)))
+              pa171::max_loss_level)))
+        .add_argument(
+          lyra::opt(wavelet, "wavelet")
+            .name("-t")
+            .name("--transform")
+            .choices("haar", "bior", "db4")
+            .help("Wavelet of the lossy levels; bior = the 5/3-style "
+                  "biorthogonal one; default = haar"))
+        .add_argument(
+          lyra::opt(boundary, "extension")
+            .name("--boundary")
+            .choices("periodic", "symmetric")
+            .help("How the wavelet extends each row and column past its "
+                  "ends; symmetric = mirrored; default = periodic"))
+        .add_argument(lyra::opt(coder, "coder")
+                        .name("-e")
+                        .name("--coder")
+                        .choices("lzw",
+                                 "rans",
+                                 "rans16",
+                                 "subband",
+                                 "huffman",
+                                 "bitpack",
+                                 "bitplane")
+                        .help("Entropy coder; rans16 = rANS over 16 "
+                              "interleaved states, subband = context "
+                              "modelled, bitpack = blocks packed at their "
+                              "bit width, bitplane = embedded, decodable "
+                              "from any prefix (the last three ignore the "
+                              "chunk size); default = lzw"))
+        .add_argument(
+          lyra::opt(zero_runs)
+            .name("-z")
+            .name("--zero-runs")
+            .help("Code runs of zero bytes by their length before the "
+                  "entropy coder (not with the subband or bitplane "
+                  "coders)"))
+        .add_argument(
+          lyra::opt(chunk_size_kib, "KiB")
+            .name("-c")
+            .name("--chunk-size")
+            .help("Code the data in independent chunks of this size, in "
+                  "parallel. 0 = single chunk; default = 0"))
+        .add_argument(
+          lyra::opt(code_size, "bits")
+            .name("-b")
+            .name("--code-size")
+            .help(fmt::format("LZW code size. Each coder takes up to {} MiB "
+                              "with {} bits; default = {}; max = {}",
+                              pa171::coding::lzw::encoder_memory_size(
+                                pa171::coding::lzw::max_code_size,
+                                pa171::coding::lzw::reuse_code_points) >>
+                                20u,
+                              pa171::coding::lzw::max_code_size,
+                              code_size,
+                              pa171::coding::lzw::max_code_size)))
+        .add_argument(
+          lyra::opt(reuse_code_points)
+            .name("--reuse-code-points")
+            .help("Replace the least recently used LZW entries once the "
+                  "dictionary is full, instead of flushing it"))
+        .add_argument(
+          lyra::opt(adaptive_reset)
+            .name("--adaptive-reset")
+            .help("Clear the full LZW dictionary only when the compression "
+                  "ratio gets worse, instead of as soon as it is full"))
+        .add_argument(
+          lyra::opt(num_threads, "threads")
+            .name("-j")
+            .name("--threads")
+            .help(fmt::format("Number of worker threads; default = {}",
+                              num_threads)))
+        .add_argument(
+          lyra::opt(dictionary_path, "path")
+            .name("-d")
+            .name("--dictionary")
+            .help("Preset LZW dictionary (see pa171_train_dictionary). The "
+                  "same dictionary is needed for decompression"))
         .add_argument(
           lyra::arg(in_path, "in").help("Input compressed image path"))
         .add_argument(lyra::arg(out_path, "out").help("Output BMP image path"));
@@ -66,25 +159,93 @@ main(int const argc, char const* const* const argv) -> int
       return EXIT_SUCCESS;
     }
 
+    // Chunk sizes are stored in bytes, in 32 bits
+    constexpr auto max_chunk_size_kib =
+      std::numeric_limits<std::uint32_t>::max() / 1024u;
+    if (chunk_size_kib > max_chunk_size_kib)
+    {
+      fmt::print(
+        stderr, "Chunk size must be at most {} KiB\n", max_chunk_size_kib);
+
+      return EXIT_FAILURE;
+    }
+
     // Build compression options from arguments
-    auto options = pa171::compression_options{};
+    auto options =
+      pa171::with_wavelet(pa171::loss_level_options(loss_level), wavelet);
 
-    if (loss_level > 0u)
+    if (auto* const iwt = pa171::iwt_options(options))
     {
-      auto& haar_iwt_options =
-        options.transform
-          .emplace<pa171::compression_options::transform_haar_iwt>();
-      haar_iwt_options.q_factor = static_cast<int>(
-        q_factor_per_loss_level * std::min(loss_level, max_loss_level));
+      iwt->boundary = boundary == "symmetric"
+                        ? pa171::transform::boundary_extension::symmetric
+                        : pa171::transform::boundary_extension::periodic;
+    }
+
+    options.zero_runs = zero_runs;
+
+    auto const chunk_size =
+      chunk_size_kib > 0u ? std::optional{ chunk_size_kib * 1024u }
+                          : std::nullopt;
+    auto dictionary =
+      std::shared_ptr<pa171::coding::lzw::preset_dictionary const>{};
 
-      options.region_size = region_size;
+    if (coder == "rans")
+    {
+      options.coding =
+        pa171::compression_options::coding_rans{ .chunk_size = chunk_size };
+    }
+    else if (coder == "rans16")
+    {
+      options.coding = pa171::compression_options::coding_rans_interleaved{
+        .chunk_size = chunk_size
+      };
+    }
+    else if (coder == "subband")
+    {
+      options.coding = pa171::compression_options::coding_subband{};
+    }
+    else if (coder == "huffman")
+    {
+      options.coding =
+        pa171::compression_options::coding_huffman{ .chunk_size = chunk_size };
+    }
+    else if (coder == "bitpack")
+    {
+      options.coding = pa171::compression_options::coding_bitpack{};
+    }
+    else if (coder == "bitplane")
+    {
+      options.coding = pa171::compression_options::coding_bitplane{};
     }
     else
     {
-      options.transform = {};
-      options.region_size = std::nullopt;
+      auto& lzw_options =
+        std::get<pa171::compression_options::coding_lzw>(options.coding);
+      lzw_options.code_size = code_size;
+      lzw_options.chunk_size = chunk_size;
+
+      if (reuse_code_points)
+      {
+        lzw_options.options |= pa171::coding::lzw::reuse_code_points;
+      }
+
+      if (adaptive_reset)
+      {
+        lzw_options.options |= pa171::coding::lzw::adaptive_reset;
+      }
+
+      if (not dictionary_path.empty())
+      {
+        dictionary = std::make_shared<pa171::coding::lzw::preset_dictionary>(
+          pa171::coding::lzw::read_preset_dictionary(dictionary_path));
+
+        lzw_options.dictionary_id = dictionary->id();
+      }
     }
 
+    // Reject options that cannot be combined before reading the image
+    options.validate();
+
     // Read the input image
     auto width = std::size_t{};
     auto height = std::size_t{};
@@ -92,7 +253,12 @@ main(int const argc, char const* const* const argv) -> int
 
     // Encode the image
     auto encoder = pa171::image_encoder{};
+    if (dictionary)
+    {
+      encoder.add_lzw_dictionary(dictionary);
+    }
     pa171::apply_options(options, encoder);
+    encoder.set_num_threads(num_threads);
 
     auto compressed_data = std::vector<std::byte>();
     encoder(pa171::view_2d{ image_data.get(), width, height }, compressed_data);
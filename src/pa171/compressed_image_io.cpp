@@ -3,9 +3,12 @@
 #include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <type_traits>
 
+#include <pa171/transform/boundary.hpp>
+
 namespace pa171
 {
 
@@ -14,23 +17,37 @@ namespace
 
 struct compressed_image_header
 {
-  static constexpr auto magic = std::string_view{ "PA171_456394" };
+  static constexpr auto magic = std::string_view{ "PA171_IMGFMT" };
+  // The magic of the files from before the format was versioned, whose
+  // options are laid out differently
+  static constexpr auto unversioned_magic = std::string_view{ "PA171_456394" };
+  // Bumped whenever the layout of the header or of the payload changes; the
+  // unversioned files count as version 1
+  static constexpr auto current_version = std::uint32_t{ 3 };
 
   std::array<char, magic.size()> magic_value;
+  std::uint32_t version;
   compression_options options;
   std::uint32_t width;
   std::uint32_t height;
   std::uint64_t payload_length;
 
-  void set_magic() noexcept { std::ranges::copy(magic, magic_value.begin()); }
+  void set_format() noexcept
+  {
+    std::ranges::copy(magic, magic_value.begin());
+    version = current_version;
+  }
 
-  [[nodiscard]] auto is_valid() const noexcept -> bool
+  [[nodiscard]] auto has_magic(std::string_view const value) const noexcept
+    -> bool
   {
-    return std::string_view{ magic_value.data(), magic_value.size() } == magic;
+    return std::string_view{ magic_value.data(), magic_value.size() } == value;
   }
 };
 
 static_assert(std::is_trivially_copyable_v<compressed_image_header>);
+static_assert(compressed_image_header::unversioned_magic.size() ==
+              compressed_image_header::magic.size());
 
 } // namespace
 
@@ -45,7 +62,8 @@ read_compressed_image(std::filesystem::path const& path,
                       compression_options& options,
                       std::size_t& width,
                       std::size_t& height,
-                      std::vector<std::byte>& data)
+                      std::vector<std::byte>& data,
+                      std::optional<std::size_t> const max_payload_length)
 {
   auto file = std::ifstream{ path, std::ios::binary };
 
@@ -59,17 +77,42 @@ read_compressed_image(std::filesystem::path const& path,
     throw std::runtime_error{ "Failed to read image header" };
   }
 
-  if (not header.is_valid())
+  if (header.has_magic(compressed_image_header::unversioned_magic))
+  {
+    throw std::runtime_error{
+      "Image written by an older, unversioned format; compress it again"
+    };
+  }
+
+  if (not header.has_magic(compressed_image_header::magic))
   {
     throw std::runtime_error{ "Invalid image header" };
   }
 
+  if (header.version != compressed_image_header::current_version)
+  {
+    throw std::runtime_error{ "Unsupported image format version " +
+                              std::to_string(header.version) };
+  }
+
+  // Files from before the boundary extension are rejected by their version
+  // above, so this only catches corrupt headers
+  if (auto const* const iwt = iwt_options(header.options);
+      iwt != nullptr and
+      iwt->boundary > transform::boundary_extension::symmetric)
+  {
+    throw std::runtime_error{ "Invalid boundary extension in image header" };
+  }
+
   options = header.options;
   width = header.width;
   height = header.height;
 
   // Read payload
-  data.resize(header.payload_length);
+  data.resize(max_payload_length
+                ? std::min<std::size_t>(header.payload_length,
+                                        *max_payload_length)
+                : header.payload_length);
 
   if (not file.read(reinterpret_cast<char*>(data.data()),
                     static_cast<std::streamsize>(data.size())))
@@ -93,7 +136,7 @@ write_compressed_image(std::filesystem::path const& path,
   header.width = static_cast<std::uint32_t>(width);
   header.height = static_cast<std::uint32_t>(height);
   header.payload_length = data.size();
-  header.set_magic();
+  header.set_format();
 
   if (not file.write(
         reinterpret_cast<char*>(&header),
@@ -3,6 +3,7 @@
 #include <array>
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -13,11 +14,14 @@ namespace pa171
 
 [[nodiscard]] auto header_size() noexcept -> std::size_t;
 
-void read_compressed_image(std::filesystem::path const& path,
-                           compression_options& options,
-                           std::size_t& width,
-                           std::size_t& height,
-                           std::vector<std::byte>& data);
+// Reads at most max_payload_length bytes of the payload, if given
+void read_compressed_image(
+  std::filesystem::path const& path,
+  compression_options& options,
+  std::size_t& width,
+  std::size_t& height,
+  std::vector<std::byte>& data,
+  std::optional<std::size_t> max_payload_length = std::nullopt);
 
 void write_compressed_image(std::filesystem::path const& path,
                             compression_options const& options,
@@ -1 +1,96 @@
 #include <pa171/compression_options.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+namespace pa171
+{
+
+void
+compression_options::check_zero_runs(bool const zero_runs,
+                                     bool const coding_models_zeros)
+{
+  if (zero_runs and coding_models_zeros)
+  {
+    throw std::invalid_argument{
+      "Zero runs cannot be combined with the subband or bitplane coding"
+    };
+  }
+}
+
+void
+compression_options::validate() const
+{
+  check_zero_runs(zero_runs,
+                  std::holds_alternative<coding_subband>(coding) or
+                    std::holds_alternative<coding_bitplane>(coding));
+}
+
+auto
+loss_level_options(unsigned const loss_level) -> compression_options
+{
+  constexpr auto q_factor_per_loss_level = 2u;
+  constexpr auto region_size = 32u;
+
+  auto options = compression_options{};
+
+  if (loss_level > 0u)
+  {
+    auto& haar_iwt_options =
+      options.transform.emplace<compression_options::transform_haar_iwt>();
+    haar_iwt_options.q_factor = static_cast<std::int16_t>(
+      q_factor_per_loss_level * std::min(loss_level, max_loss_level));
+
+    options.region_size = region_size;
+  }
+
+  return options;
+}
+
+auto
+iwt_options(compression_options& options) -> compression_options::transform_iwt*
+{
+  return std::visit(
+    ranges::overload(
+      [](std::monostate) -> compression_options::transform_iwt*
+      { return nullptr; },
+      [](compression_options::transform_iwt& transform)
+        -> compression_options::transform_iwt* { return &transform; }),
+    options.transform);
+}
+
+auto
+with_wavelet(compression_options options, std::string_view const wavelet)
+  -> compression_options
+{
+  auto const* const current = iwt_options(options);
+  if (current == nullptr)
+  {
+    return options;
+  }
+
+  auto const iwt = *current;
+
+  if (wavelet == "haar")
+  {
+    options.transform = compression_options::transform_haar_iwt{ iwt };
+  }
+  else if (wavelet == "bior")
+  {
+    options.transform = compression_options::transform_bior_2_2_iwt{ iwt };
+  }
+  else if (wavelet == "db4")
+  {
+    options.transform = compression_options::transform_db4_iwt{ iwt };
+  }
+  else
+  {
+    throw std::invalid_argument{ "Unknown wavelet " + std::string{ wavelet } };
+  }
+
+  return options;
+}
+
+} // namespace pa171
@@ -1,41 +1,146 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <string_view>
 #include <variant>
 
 #include <range/v3/functional/overload.hpp>
 
 #include <pa171/coding/lzw_base.hpp>
+#include <pa171/transform/boundary.hpp>
 
 namespace pa171
 {
 
 struct compression_options
 {
-  struct transform_haar_iwt
+  // The options shared by the integer wavelet transforms: the levels, the
+  // quantization of their subbands and the boundary extension
+  struct transform_iwt
   {
     std::optional<std::size_t> num_iters = std::nullopt;
     std::int16_t q_factor = 32;
     std::int16_t q_alpha = 8;
     std::int16_t q_beta = 0;
+    // How the lifting steps extend each row and column past its ends
+    transform::boundary_extension boundary =
+      transform::boundary_extension::periodic;
+  };
+
+  struct transform_haar_iwt : transform_iwt
+  {
+  };
+
+  // The 5/3-style biorthogonal wavelet
+  struct transform_bior_2_2_iwt : transform_iwt
+  {
+  };
+
+  // The Daubechies 4 wavelet
+  struct transform_db4_iwt : transform_iwt
+  {
   };
 
   struct coding_lzw
   {
     coding::lzw::code_point_size_t code_size = coding::lzw::default_code_size;
     coding::lzw::options_t options = coding::lzw::default_options;
+    // Code each chunk of this many bytes independently (and in parallel)
+    std::optional<std::uint32_t> chunk_size = std::nullopt;
+    // Id of the preset dictionary to load, 0 = none
+    std::uint32_t dictionary_id = 0;
+  };
+
+  struct coding_rans
+  {
+    // Code each chunk of this many bytes independently (and in parallel)
+    std::optional<std::uint32_t> chunk_size = std::nullopt;
+  };
+
+  // rANS over interleaved states, decoded with SIMD where available
+  struct coding_rans_interleaved
+  {
+    // Code each chunk of this many bytes independently (and in parallel)
+    std::optional<std::uint32_t> chunk_size = std::nullopt;
+  };
+
+  // Canonical Huffman codes, for fast decoding
+  struct coding_huffman
+  {
+    // Code each chunk of this many bytes independently (and in parallel)
+    std::optional<std::uint32_t> chunk_size = std::nullopt;
+  };
+
+  // Context modelled arithmetic coding of the subbands of each region
+  struct coding_subband
+  {
+  };
+
+  // Blocks of each subband packed at their bit width, for speed over ratio
+  struct coding_bitpack
+  {
+  };
+
+  // Embedded bit plane coding of the subbands of each region: any prefix of
+  // the payload decodes to a coarser image
+  struct coding_bitplane
+  {
   };
 
   std::optional<std::uint32_t> region_size = std::nullopt;
-  std::variant<std::monostate, transform_haar_iwt> transform = {};
-  std::variant<coding_lzw> coding = coding_lzw{};
+  std::variant<std::monostate,
+               transform_haar_iwt,
+               transform_bior_2_2_iwt,
+               transform_db4_iwt>
+    transform = {};
+  // Code runs of zero bytes (mostly quantized details) by their length
+  // before the byte coding; not with coding_subband or coding_bitplane, which
+  // model them
+  bool zero_runs = false;
+  std::variant<coding_lzw,
+               coding_rans,
+               coding_rans_interleaved,
+               coding_subband,
+               coding_huffman,
+               coding_bitpack,
+               coding_bitplane>
+    coding = coding_lzw{};
+
+  // Throws std::invalid_argument for zero runs with a coding that models
+  // runs of zeros itself
+  static void check_zero_runs(bool zero_runs, bool coding_models_zeros);
+
+  // Throws std::invalid_argument for options that cannot be combined
+  void validate() const;
 };
 
+// Highest loss level accepted by loss_level_options
+inline constexpr auto max_loss_level = 64u;
+
+// Options used by the command line tools for a loss level, 0 = lossless
+[[nodiscard]] auto loss_level_options(unsigned loss_level)
+  -> compression_options;
+
+// The options shared by the wavelet transforms, whichever is set, or nullptr
+// for lossless options
+[[nodiscard]] auto iwt_options(compression_options& options)
+  -> compression_options::transform_iwt*;
+
+// The options with their wavelet switched to the named one ("haar", "bior"
+// or "db4"), keeping the rest of the transform options; lossless options
+// are returned unchanged
+[[nodiscard]] auto with_wavelet(compression_options options,
+                                std::string_view wavelet)
+  -> compression_options;
+
 template<typename Configurable>
 void
 apply_options(compression_options const& options, Configurable& configurable)
 {
+  options.validate();
+
   if (options.region_size)
   {
     configurable.set_region_size(*options.region_size);
@@ -47,15 +152,51 @@ apply_options(compression_options const& options, Configurable& configurable)
                  configurable.set_transform_haar_iwt(haar_iwt.num_iters,
                                                      haar_iwt.q_factor,
                                                      haar_iwt.q_alpha,
-                                                     haar_iwt.q_beta);
+                                                     haar_iwt.q_beta,
+                                                     haar_iwt.boundary);
+               },
+               [&](compression_options::transform_bior_2_2_iwt const& bior)
+               {
+                 configurable.set_transform_bior_2_2_iwt(bior.num_iters,
+                                                         bior.q_factor,
+                                                         bior.q_alpha,
+                                                         bior.q_beta,
+                                                         bior.boundary);
+               },
+               [&](compression_options::transform_db4_iwt const& db4)
+               {
+                 configurable.set_transform_db4_iwt(db4.num_iters,
+                                                    db4.q_factor,
+                                                    db4.q_alpha,
+                                                    db4.q_beta,
+                                                    db4.boundary);
                },
                [](std::monostate) {}),
              options.transform);
 
   std::visit(ranges::overload(
                [&](compression_options::coding_lzw const& lzw)
-               { configurable.set_coding_lzw(lzw.code_size, lzw.options); }),
+               {
+                 configurable.set_coding_lzw(lzw.code_size,
+                                             lzw.options,
+                                             lzw.chunk_size,
+                                             lzw.dictionary_id);
+               },
+               [&](compression_options::coding_rans const& rans)
+               { configurable.set_coding_rans(rans.chunk_size); },
+               [&](compression_options::coding_rans_interleaved const& rans)
+               { configurable.set_coding_rans_interleaved(rans.chunk_size); },
+               [&](compression_options::coding_subband const&)
+               { configurable.set_coding_subband(); },
+               [&](compression_options::coding_huffman const& huffman)
+               { configurable.set_coding_huffman(huffman.chunk_size); },
+               [&](compression_options::coding_bitpack const&)
+               { configurable.set_coding_bitpack(); },
+               [&](compression_options::coding_bitplane const&)
+               { configurable.set_coding_bitplane(); }),
              options.coding);
+
+  configurable.set_zero_runs(options.zero_runs);
 }
 
 } // namespace pa171
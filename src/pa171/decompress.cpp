@@ -2,6 +2,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <vector>
 
@@ -9,10 +11,12 @@
 #include <fmt/ostream.h>
 #include <lyra/lyra.hpp>
 
+#include <pa171/coding/lzw_preset.hpp>
 #include <pa171/compressed_image_io.hpp>
 #include <pa171/compression_options.hpp>
 #include <pa171/image_decoder.hpp>
 #include <pa171/image_io.hpp>
+#include <pa171/utils/parallel.hpp>
 
 auto
 main(int const argc, char const* const* const argv) -> int
@@ -21,12 +25,31 @@ main(int const argc, char const* const* const argv) -> int
   {
     // Parse arguments
     auto show_help = false;
+    auto num_threads = pa171::default_num_threads();
+    auto max_payload_kib = 0u;
+    auto dictionary_path = std::filesystem::path{};
     auto in_path = std::filesystem::path{};
     auto out_path = std::filesystem::path{};
 
     auto const parser =
       lyra::cli_parser{}
         .add_argument(lyra::help(show_help))
+        .add_argument(
+          lyra::opt(num_threads, "threads")
+            .name("-j")
+            .name("--threads")
+            .help(fmt::format("Number of worker threads; default = {}",
+                              num_threads)))
+        .add_argument(
+          lyra::opt(max_payload_kib, "KiB")
+            .name("-m")
+            .name("--max-payload")
+            .help("Read only this much of the payload, for a coarser image "
+                  "(bitplane coder only). 0 = all; default = 0"))
+        .add_argument(lyra::opt(dictionary_path, "path")
+                        .name("-d")
+                        .name("--dictionary")
+                        .help("Preset LZW dictionary used for compression"))
         .add_argument(
           lyra::arg(in_path, "in").help("Input compressed image path"))
         .add_argument(lyra::arg(out_path, "out").help("Output BMP image path"));
@@ -54,11 +77,25 @@ main(int const argc, char const* const* const argv) -> int
     auto height = std::size_t{};
     auto compressed_data = std::vector<std::byte>{};
     pa171::read_compressed_image(
-      in_path, options, width, height, compressed_data);
+      in_path,
+      options,
+      width,
+      height,
+      compressed_data,
+      max_payload_kib > 0u
+        ? std::optional{ std::size_t{ max_payload_kib } * 1024u }
+        : std::nullopt);
 
     // Decode the image
     auto decoder = pa171::image_decoder{};
+    if (not dictionary_path.empty())
+    {
+      decoder.add_lzw_dictionary(
+        std::make_shared<pa171::coding::lzw::preset_dictionary>(
+          pa171::coding::lzw::read_preset_dictionary(dictionary_path)));
+    }
     pa171::apply_options(options, decoder);
+    decoder.set_num_threads(num_threads);
 
     auto decoded_image = std::vector<std::uint8_t>(width * height);
     decoder(compressed_data,
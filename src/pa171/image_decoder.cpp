@@ -1,106 +1,397 @@
 #include <pa171/image_decoder.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 #include <range/v3/functional/arithmetic.hpp>
 #include <range/v3/view/join.hpp>
 #include <range/v3/view/zip.hpp>
 
+#include <pa171/coding/bitpack_decoder.hpp>
+#include <pa171/coding/bitplane_decoder.hpp>
+#include <pa171/coding/chunked.hpp>
+#include <pa171/coding/huffman_decoder.hpp>
 #include <pa171/coding/lzw_decoder.hpp>
+#include <pa171/coding/rans_decoder.hpp>
+#include <pa171/coding/rans_interleaved_decoder.hpp>
+#include <pa171/coding/subband_decoder.hpp>
+#include <pa171/coding/zero_run.hpp>
+#include <pa171/compression_options.hpp>
 #include <pa171/quantization/haar_iwt.hpp>
 #include <pa171/transform/wavelet.hpp>
+#include <pa171/utils/endian.hpp>
+#include <pa171/utils/saturate.hpp>
 
 namespace pa171
 {
 
+namespace
+{
+
+// Decodes the input with decode(coder, input, output), which returns the
+// decoded size; the subband layout is not used. With a chunk size, each
+// worker thread decodes chunks with its own copy of the coder.
+template<typename Function, typename Coder, typename Decode>
 void
-image_decoder::set_region_size(std::size_t const region_size)
+set_byte_decoding(Function& function,
+                  Coder const& coder,
+                  std::optional<std::size_t> const chunk_size,
+                  Decode const decode)
 {
-  region_size_ = region_size;
+  if (chunk_size and *chunk_size == 0u)
+  {
+    throw std::invalid_argument{ "Chunk size must be positive" };
+  }
+
+  if (not chunk_size)
+  {
+    function =
+      [=, coder = coder](std::span<std::byte const> const input,
+                         std::span<quantization::subband const> /*subbands*/,
+                         std::span<std::byte> const output,
+                         std::size_t /*num_threads*/) mutable
+    { return decode(coder, input, output); };
+
+    return;
+  }
+
+  function = [=, coders = std::vector<Coder>{}](
+               std::span<std::byte const> const input,
+               std::span<quantization::subband const> /*subbands*/,
+               std::span<std::byte> const output,
+               std::size_t const num_threads) mutable
+  {
+    // One coder (and its tables) per worker thread
+    coders.resize(std::max(coders.size(), num_threads), coder);
+
+    return coding::decode_chunked(
+      input,
+      *chunk_size,
+      output,
+      num_threads,
+      [&](std::size_t const worker_index,
+          std::span<std::byte const> const chunk_input,
+          std::span<std::byte> const chunk_output)
+      { return decode(coders[worker_index], chunk_input, chunk_output); });
+  };
 }
 
+// Dequantizes the subbands of each region, then inversely transforms it
+// with the wavelet. There is no streaming inverse, so unlike the encoder this
+// always goes through an int16 copy of the whole region.
+template<typename TransformFunction,
+         typename SubbandFunction,
+         typename InverseWavelet>
 void
-image_decoder::set_transform_haar_iwt(
-  std::optional<std::size_t> const num_iters,
-  int const q_factor,
-  int const q_alpha,
-  int const q_beta)
+set_wavelet_transform(TransformFunction& transform_function,
+                      SubbandFunction& subband_function,
+                      InverseWavelet const& inv_wavelet,
+                      std::optional<std::size_t> const num_iters,
+                      int const q_factor,
+                      int const q_alpha,
+                      int const q_beta,
+                      quantization::min_divisors const q_divisors = {})
 {
-  transform_function_ =
+  using inv_quantizer_type =
+    quantization::inv_haar_iwt<std::uint8_t, std::int16_t>;
+
+  transform_function =
     [=,
      inv_recursive_2d_wt =
        transform::inv_recursive_2d_wavelet_transform<std::int16_t>{},
-     inv_quantizer = quantization::inv_haar_iwt<std::uint8_t, std::int16_t>{},
-     hr_in_buffer = std::vector<std::int16_t>{},
-     hr_out_buffer =
+     dequantize_rows = std::optional<inv_quantizer_type::row_dequantizer>{},
+     dequantize_rows_size = std::pair<std::size_t, std::size_t>{},
+     hr_buffer =
        std::vector<std::int16_t>{}](std::span<std::byte const> const input,
-                                    view_2d<std::uint8_t*> const output) mutable
+                                    view_2d<std::uint8_t*> const output,
+                                    std::size_t const num_threads) mutable
   {
     auto const width = output.width();
     auto const height = output.height();
 
-    hr_in_buffer.resize(width * height);
-    hr_out_buffer.resize(width * height);
-
-    // De-quantize inputs
-    inv_quantizer(
-      std::span{
-        reinterpret_cast<std::int8_t const*>(input.data()),
-        input.size(),
-      },
-      hr_in_buffer.begin(),
-      width,
-      height,
-      q_factor,
-      q_alpha,
-      q_beta,
-      num_iters);
-
-    // Apply inverse transform
-    inv_recursive_2d_wt(hr_in_buffer,
-                        view_2d{ hr_out_buffer.begin(), width, height },
-                        transform::inv_haar_iwt<std::int16_t>,
-                        num_iters);
-
-    // Clamp-convert output region to uint8
-    std::ranges::transform(
-      hr_out_buffer,
-      (output.rows() | ranges::views::join).begin(),
-      [](std::int16_t const value)
+    // Regions are mostly of the same size, so keep the layout of the last
+    if (not dequantize_rows or
+        dequantize_rows_size != std::pair{ width, height })
+    {
+      dequantize_rows.emplace(
+        width, height, q_factor, q_alpha, q_beta, num_iters, q_divisors);
+      dequantize_rows_size = { width, height };
+    }
+
+    // Dequantize each subband straight into its place in the region, invert
+    // the transform there, then narrow the rows into the output
+    hr_buffer.resize(width * height);
+    auto const hr_image = view_2d{ hr_buffer.begin(), width, height };
+
+    transform::for_each_subband_run(
+      hr_image,
+      num_iters,
+      [&](std::size_t const level,
+          std::size_t const x,
+          std::size_t const y,
+          std::span<std::int16_t> const values)
       {
-        return std::clamp(
-          value,
-          static_cast<std::int16_t>(std::numeric_limits<std::uint8_t>::min()),
-          static_cast<std::int16_t>(std::numeric_limits<std::uint8_t>::max()));
+        (*dequantize_rows)(level,
+                           x,
+                           y,
+                           values,
+                           reinterpret_cast<std::int8_t const*>(input.data()));
       });
+
+    inv_recursive_2d_wt.transform_in_place(
+      hr_image, inv_wavelet, num_iters, num_threads);
+
+    for (auto i = std::size_t{ 0 }; i < height; ++i)
+    {
+      saturate_to_bytes(std::span{ hr_buffer }.subspan(i * width, width),
+                        std::to_address(output.base()) +
+                          i * output.row_stride());
+    }
+  };
+
+  subband_function = [=](std::size_t const width,
+                         std::size_t const height,
+                         std::vector<quantization::subband>& result)
+  {
+    quantization::haar_iwt<std::uint8_t, std::int16_t>::subbands(
+      width, height, num_iters, result);
   };
 }
 
+} // namespace
+
+void
+image_decoder::set_region_size(std::size_t const region_size)
+{
+  region_size_ = region_size;
+}
+
+void
+image_decoder::set_transform_haar_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::haar_iwt<std::int16_t>.with_boundary(boundary).inverse(),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta);
+}
+
+void
+image_decoder::set_transform_bior_2_2_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::scaled_bior_2_2_iwt<std::int16_t>
+      .with_boundary(boundary)
+      .inverse(),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta,
+    quantization::scaled_bior_2_2_iwt_divisors);
+}
+
+void
+image_decoder::set_transform_db4_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::scaled_db4_iwt<std::int16_t>.with_boundary(boundary).inverse(),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta,
+    quantization::scaled_db4_iwt_divisors);
+}
+
 void
 image_decoder::set_coding_lzw(coding::lzw::code_point_size_t const code_size,
-                              coding::lzw::options_t const options)
+                              coding::lzw::options_t const options,
+                              std::optional<std::size_t> const chunk_size,
+                              std::uint32_t const dictionary_id)
+{
+  if (code_size < coding::lzw::min_code_size or
+      code_size > coding::lzw::max_code_size)
+  {
+    throw std::invalid_argument{
+      "LZW code size must be between " +
+      std::to_string(coding::lzw::min_code_size) + " and " +
+      std::to_string(coding::lzw::max_code_size) + " bits"
+    };
+  }
+
+  auto dictionary = std::shared_ptr<coding::lzw::preset_dictionary const>{};
+
+  if (dictionary_id != 0u)
+  {
+    auto const found = lzw_dictionaries_.find(dictionary_id);
+
+    if (found == lzw_dictionaries_.end())
+    {
+      throw std::invalid_argument{ "Unknown LZW dictionary id " +
+                                   std::to_string(dictionary_id) };
+    }
+
+    dictionary = found->second;
+  }
+
+  set_byte_decoding(byte_decoding_function_,
+                    coding::lzw::decoder{ code_size, options, dictionary },
+                    chunk_size,
+                    [](coding::lzw::decoder& lzw_decoder,
+                       std::span<std::byte const> const input,
+                       std::span<std::byte> const output)
+                    {
+                      auto const output_end = lzw_decoder(input, output).second;
+                      return static_cast<std::size_t>(output_end -
+                                                      output.data());
+                    });
+
+  models_zeros_ = false;
+}
+
+void
+image_decoder::set_coding_rans(std::optional<std::size_t> const chunk_size)
+{
+  set_byte_decoding(byte_decoding_function_,
+                    coding::rans::decoder{},
+                    chunk_size,
+                    [](coding::rans::decoder& rans_decoder,
+                       std::span<std::byte const> const input,
+                       std::span<std::byte> const output)
+                    { return rans_decoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_decoder::set_coding_rans_interleaved(
+  std::optional<std::size_t> const chunk_size)
+{
+  set_byte_decoding(byte_decoding_function_,
+                    coding::rans::interleaved_decoder{},
+                    chunk_size,
+                    [](coding::rans::interleaved_decoder& rans_decoder,
+                       std::span<std::byte const> const input,
+                       std::span<std::byte> const output)
+                    { return rans_decoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_decoder::set_coding_subband()
 {
   byte_decoding_function_ =
-    [lzw_decoder = coding::lzw::decoder{ code_size, options }](
+    [subband_decoder = coding::subband::decoder{}](
       std::span<std::byte const> const input,
-      std::vector<std::byte>& output) mutable
-  { lzw_decoder(input, std::back_inserter(output)); };
+      std::span<quantization::subband const> const subbands,
+      std::span<std::byte> const output,
+      std::size_t /*num_threads*/) mutable
+  { return subband_decoder(input, subbands, output); };
+
+  models_zeros_ = true;
+}
+
+void
+image_decoder::set_coding_huffman(std::optional<std::size_t> const chunk_size)
+{
+  set_byte_decoding(byte_decoding_function_,
+                    coding::huffman::decoder{},
+                    chunk_size,
+                    [](coding::huffman::decoder& huffman_decoder,
+                       std::span<std::byte const> const input,
+                       std::span<std::byte> const output)
+                    { return huffman_decoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_decoder::set_coding_bitpack()
+{
+  byte_decoding_function_ =
+    [bitpack_decoder = coding::bitpack::decoder{}](
+      std::span<std::byte const> const input,
+      std::span<quantization::subband const> const subbands,
+      std::span<std::byte> const output,
+      std::size_t /*num_threads*/)
+  { return bitpack_decoder(input, subbands, output); };
+
+  models_zeros_ = false;
+}
+
+void
+image_decoder::set_coding_bitplane()
+{
+  byte_decoding_function_ =
+    [bitplane_decoder = coding::bitplane::decoder{}](
+      std::span<std::byte const> const input,
+      std::span<quantization::subband const> const subbands,
+      std::span<std::byte> const output,
+      std::size_t /*num_threads*/) mutable
+  { return bitplane_decoder(input, subbands, output); };
+
+  models_zeros_ = true;
+}
+
+void
+image_decoder::add_lzw_dictionary(
+  std::shared_ptr<coding::lzw::preset_dictionary const> dictionary)
+{
+  auto const id = dictionary->id();
+  lzw_dictionaries_.insert_or_assign(id, std::move(dictionary));
+}
+
+void
+image_decoder::set_zero_runs(bool const zero_runs)
+{
+  zero_runs_ = zero_runs;
+}
+
+void
+image_decoder::set_num_threads(std::size_t const num_threads)
+{
+  num_threads_ = std::max(num_threads, std::size_t{ 1 });
 }
 
 void
 image_decoder::operator()(std::span<std::byte const> const input,
                           view_2d<std::uint8_t*> const output)
 {
+  // The coding and the zero runs are set apart, so check them together here
+  compression_options::check_zero_runs(zero_runs_, models_zeros_);
+
   auto const width = output.width();
   auto const height = output.height();
 
-  decoded_.clear();
-  byte_decoding_function_(input, decoded_);
-
-  if (decoded_.size() != width * height)
-  {
-    throw std::runtime_error{ "Decoded output length does not match" };
-  }
+  decoded_.resize(width * height);
 
   transform_in_regions_.clear();
   transform_out_regions_.clear();
@@ -132,6 +423,59 @@ image_decoder::operator()(std::span<std::byte const> const input,
     transform_out_regions_.push_back(output);
   }
 
+  // Describe the subbands of each region, as the encoder did
+  subbands_.clear();
+
+  for (auto const out_region : transform_out_regions_)
+  {
+    if (subband_function_)
+    {
+      subband_function_(out_region.width(), out_region.height(), subbands_);
+    }
+    else
+    {
+      subbands_.push_back({ quantization::subband_kind::samples,
+                            0u,
+                            out_region.width(),
+                            out_region.height() });
+    }
+  }
+
+  if (not zero_runs_)
+  {
+    if (byte_decoding_function_(input, subbands_, decoded_, num_threads_) !=
+        decoded_.size())
+    {
+      throw std::runtime_error{ "Decoded output length does not match" };
+    }
+  }
+  else
+  {
+    if (input.size() < sizeof(std::uint64_t))
+    {
+      throw std::runtime_error{ "Unexpected end of input" };
+    }
+
+    auto const zero_run_coded_size = load_le<std::uint64_t>(input.data());
+    if (zero_run_coded_size >
+        coding::zero_run::max_encoded_size(decoded_.size()))
+    {
+      throw std::runtime_error{ "Invalid zero run coded length" };
+    }
+
+    zero_run_coded_.resize(static_cast<std::size_t>(zero_run_coded_size));
+
+    if (byte_decoding_function_(input.subspan(sizeof(std::uint64_t)),
+                                {},
+                                zero_run_coded_,
+                                num_threads_) != zero_run_coded_.size() or
+        coding::zero_run::decode(zero_run_coded_, decoded_) !=
+          decoded_.size())
+    {
+      throw std::runtime_error{ "Decoded output length does not match" };
+    }
+  }
+
   // For each region, apply the transform
   for (auto const [in_region, out_region] :
        ranges::views::zip(transform_in_regions_, transform_out_regions_))
@@ -139,7 +483,7 @@ image_decoder::operator()(std::span<std::byte const> const input,
 
     if (transform_function_)
     {
-      transform_function_(in_region, out_region);
+      transform_function_(in_region, out_region, num_threads_);
     }
     else
     {
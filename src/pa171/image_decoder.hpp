@@ -3,11 +3,18 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <span>
 #include <vector>
 #include <optional>
 
+#include <absl/container/flat_hash_map.h>
+
 #include <pa171/coding/lzw_base.hpp>
+#include <pa171/coding/lzw_preset.hpp>
+#include <pa171/quantization/subband.hpp>
+#include <pa171/transform/boundary.hpp>
+#include <pa171/utils/parallel.hpp>
 #include <pa171/utils/view_2d.hpp>
 
 namespace pa171
@@ -16,35 +23,110 @@ namespace pa171
 class image_decoder
 {
 public:
+  // Must match the region size of the encoder. Only the encoder streams
+  // large regions: the decoder inverts each one in place, in an int16 copy
+  // of the whole region, so a region size is what bounds its memory.
   void set_region_size(std::size_t region_size);
 
   void set_transform_haar_iwt(
     std::optional<std::size_t> num_iters = std::nullopt,
     int q_factor = 32,
     int q_alpha = 8,
-    int q_beta = 0);
+    int q_beta = 0,
+    transform::boundary_extension boundary =
+      transform::boundary_extension::periodic);
+
+  // The 5/3-style biorthogonal wavelet, scaled to keep the range of the
+  // approximation
+  void set_transform_bior_2_2_iwt(
+    std::optional<std::size_t> num_iters = std::nullopt,
+    int q_factor = 32,
+    int q_alpha = 8,
+    int q_beta = 0,
+    transform::boundary_extension boundary =
+      transform::boundary_extension::periodic);
+
+  // The Daubechies 4 wavelet, scaled to keep the range of the approximation
+  void set_transform_db4_iwt(
+    std::optional<std::size_t> num_iters = std::nullopt,
+    int q_factor = 32,
+    int q_alpha = 8,
+    int q_beta = 0,
+    transform::boundary_extension boundary =
+      transform::boundary_extension::periodic);
 
   void set_coding_lzw(
     coding::lzw::code_point_size_t code_size = coding::lzw::default_code_size,
-    coding::lzw::options_t options = coding::lzw::default_options);
+    coding::lzw::options_t options = coding::lzw::default_options,
+    std::optional<std::size_t> chunk_size = std::nullopt,
+    std::uint32_t dictionary_id = 0);
+
+  void set_coding_rans(std::optional<std::size_t> chunk_size = std::nullopt);
+
+  void set_coding_rans_interleaved(
+    std::optional<std::size_t> chunk_size = std::nullopt);
+
+  // Context modelled arithmetic coding of the subbands of each region
+  void set_coding_subband();
+
+  void set_coding_huffman(std::optional<std::size_t> chunk_size = std::nullopt);
+
+  // Bit packing of blocks of each subband, for speed over ratio
+  void set_coding_bitpack();
+
+  // Embedded bit plane coding of the subbands of each region; the decoder
+  // also accepts any prefix of the payload, see operator()
+  void set_coding_bitplane();
+
+  // Replaces runs of zero bytes by their length before the byte coding; the
+  // subband layout is then not available to it, so operator() rejects this
+  // with set_coding_subband or set_coding_bitplane
+  void set_zero_runs(bool zero_runs);
+
+  // Makes a preset dictionary available to set_coding_lzw, by its id
+  void add_lzw_dictionary(
+    std::shared_ptr<coding::lzw::preset_dictionary const> dictionary);
+
+  void set_num_threads(std::size_t num_threads);
 
+  // With set_coding_bitplane (and no zero runs), input may be any prefix of
+  // the encoded payload: the image is then decoded at the precision its
+  // bytes carry. Other codings need the whole payload.
   void operator()(std::span<std::byte const> input,
                   view_2d<std::uint8_t*> output);
 
 private:
   using transform_function_type = void(std::span<std::byte const> input,
-                                       view_2d<std::uint8_t*> output);
-  using byte_decoding_function_type = void(std::span<std::byte const> input,
-                                           std::vector<std::byte>& output);
+                                       view_2d<std::uint8_t*> output,
+                                       std::size_t num_threads);
+  using subband_function_type =
+    void(std::size_t width,
+         std::size_t height,
+         std::vector<quantization::subband>& result);
+  using byte_decoding_function_type =
+    auto(std::span<std::byte const> input,
+         std::span<quantization::subband const> subbands,
+         std::span<std::byte> output,
+         std::size_t num_threads) -> std::size_t;
 
   // Components
   std::function<transform_function_type> transform_function_;
+  std::function<subband_function_type> subband_function_;
   std::function<byte_decoding_function_type> byte_decoding_function_;
 
   // Settings
   std::optional<std::size_t> region_size_;
+  std::size_t num_threads_ = default_num_threads();
+  bool zero_runs_ = false;
+  // Set by the codings that model runs of zeros themselves
+  bool models_zeros_ = false;
+  absl::flat_hash_map<std::uint32_t,
+                      std::shared_ptr<coding::lzw::preset_dictionary const>>
+    lzw_dictionaries_;
 
   // Buffers
+  std::vector<quantization::subband> subbands_;
+  std::vector<std::byte> zero_run_coded_;
   std::vector<std::byte> decoded_;
   std::vector<std::span<std::byte const>> transform_in_regions_;
   std::vector<view_2d<std::uint8_t*>> transform_out_regions_;
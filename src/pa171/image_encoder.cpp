@@ -1,86 +1,441 @@
 #include <pa171/image_encoder.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 #include <range/v3/functional/arithmetic.hpp>
 #include <range/v3/view/join.hpp>
 #include <range/v3/view/zip.hpp>
 
+#include <pa171/coding/bitpack_encoder.hpp>
+#include <pa171/coding/bitplane_encoder.hpp>
+#include <pa171/coding/chunked.hpp>
+#include <pa171/coding/huffman_encoder.hpp>
 #include <pa171/coding/lzw_encoder.hpp>
+#include <pa171/coding/rans_encoder.hpp>
+#include <pa171/coding/rans_interleaved_encoder.hpp>
+#include <pa171/coding/subband_encoder.hpp>
+#include <pa171/coding/zero_run.hpp>
+#include <pa171/compression_options.hpp>
 #include <pa171/quantization/haar_iwt.hpp>
 #include <pa171/transform/wavelet.hpp>
+#include <pa171/utils/endian.hpp>
 
 namespace pa171
 {
 
+namespace
+{
+
+// Regions of at least this many pixels (64 Mpx) are transformed a row at a
+// time straight into the quantized output, rather than through int16 copies
+// of the whole region; smaller ones are transformed in place, on all threads
+constexpr auto streaming_min_pixels = std::size_t{ 1 } << 26u;
+
+// Codes the input with encode(coder, input, output), which appends to
+// output; the subband layout is not used. With a chunk size, each worker
+// thread codes chunks with its own copy of the coder.
+template<typename Function, typename Coder, typename Encode>
 void
-image_encoder::set_region_size(std::size_t const region_size)
+set_byte_encoding(Function& function,
+                  Coder const& coder,
+                  std::optional<std::size_t> const chunk_size,
+                  Encode const encode)
 {
-  region_size_ = region_size;
+  if (chunk_size and *chunk_size == 0u)
+  {
+    throw std::invalid_argument{ "Chunk size must be positive" };
+  }
+
+  if (not chunk_size)
+  {
+    function =
+      [=, coder = coder](std::span<std::byte const> const input,
+                         std::span<quantization::subband const> /*subbands*/,
+                         std::vector<std::byte>& output,
+                         std::size_t /*num_threads*/) mutable
+    { encode(coder, input, output); };
+
+    return;
+  }
+
+  function = [=,
+              coders = std::vector<Coder>{},
+              chunk_buffers = std::vector<std::vector<std::byte>>{}](
+               std::span<std::byte const> const input,
+               std::span<quantization::subband const> /*subbands*/,
+               std::vector<std::byte>& output,
+               std::size_t const num_threads) mutable
+  {
+    // One coder (and its tables) per worker thread
+    coders.resize(std::max(coders.size(), num_threads), coder);
+
+    coding::encode_chunked(
+      input,
+      *chunk_size,
+      output,
+      chunk_buffers,
+      num_threads,
+      [&](std::size_t const worker_index,
+          std::span<std::byte const> const chunk_input,
+          std::vector<std::byte>& chunk_output)
+      {
+        chunk_output.clear();
+        encode(coders[worker_index], chunk_input, chunk_output);
+      });
+  };
 }
 
+// Transforms each region with the wavelet, then quantizes its subbands
+template<typename TransformFunction,
+         typename SubbandFunction,
+         typename Wavelet>
 void
-image_encoder::set_transform_haar_iwt(
-  std::optional<std::size_t> const num_iters,
-  int const q_factor,
-  int const q_alpha,
-  int const q_beta)
+set_wavelet_transform(TransformFunction& transform_function,
+                      SubbandFunction& subband_function,
+                      Wavelet const& wavelet,
+                      std::optional<std::size_t> const num_iters,
+                      int const q_factor,
+                      int const q_alpha,
+                      int const q_beta,
+                      quantization::min_divisors const q_divisors = {})
 {
-  transform_function_ =
+  using quantizer_type = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+
+  transform_function =
     [=,
      recursive_2d_wt =
        transform::recursive_2d_wavelet_transform<std::int16_t>{},
-     quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>{},
-     hr_in_buffer = std::vector<std::int16_t>{},
-     hr_out_buffer = std::vector<std::int16_t>{}](
-      view_2d<std::uint8_t const*> const input, std::byte* const output) mutable
+     quantize_rows = std::optional<quantizer_type::row_quantizer>{},
+     quantize_rows_size = std::pair<std::size_t, std::size_t>{},
+     hr_buffer = std::vector<std::int16_t>{}](
+      view_2d<std::uint8_t const*> const input,
+      std::byte* const output,
+      std::size_t const num_threads) mutable
   {
     auto const width = input.width();
     auto const height = input.height();
 
-    hr_in_buffer.resize(width * height);
-    hr_out_buffer.resize(width * height);
-
-    // Convert input region to int16
-    std::ranges::copy(input.rows() | ranges::views::join, hr_in_buffer.begin());
-
-    // Apply transform
-    recursive_2d_wt(view_2d{ hr_in_buffer.begin(), width, height },
-                    hr_out_buffer.begin(),
-                    transform::haar_iwt<std::int16_t>,
-                    num_iters);
-
-    // Quantize results
-    quantizer(hr_out_buffer,
-              reinterpret_cast<std::int8_t*>(output),
-              width,
-              height,
-              q_factor,
-              q_alpha,
-              q_beta,
-              num_iters);
+    // Regions are mostly of the same size, so keep the layout of the last
+    if (not quantize_rows or quantize_rows_size != std::pair{ width, height })
+    {
+      quantize_rows.emplace(
+        width, height, q_factor, q_alpha, q_beta, num_iters, q_divisors);
+      quantize_rows_size = { width, height };
+    }
+
+    auto const sink = [&](std::size_t const level,
+                          std::size_t const x,
+                          std::size_t const y,
+                          std::span<std::int16_t const> const values)
+    {
+      (*quantize_rows)(
+        level, x, y, values, reinterpret_cast<std::int8_t*>(output));
+    };
+
+    if (width * height >= streaming_min_pixels)
+    {
+      auto streaming_2d_wt = transform::streaming_2d_wavelet_transform{
+        wavelet, width, height, num_iters, sink
+      };
+
+      for (auto const row : input.rows())
+      {
+        streaming_2d_wt.push_row(row);
+      }
+
+      return;
+    }
+
+    // Widen the region while loading it, transform it in place, then
+    // quantize each subband straight from there into the output
+    hr_buffer.resize(width * height);
+    auto hr_row = hr_buffer.begin();
+    for (auto const row : input.rows())
+    {
+      hr_row = std::ranges::copy(row, hr_row).out;
+    }
+
+    auto const hr_image = view_2d{ hr_buffer.begin(), width, height };
+    recursive_2d_wt.transform_in_place(
+      hr_image, wavelet, num_iters, num_threads);
+    transform::for_each_subband_run(hr_image, num_iters, sink);
   };
+
+  subband_function = [=](std::size_t const width,
+                         std::size_t const height,
+                         std::vector<quantization::subband>& result)
+  {
+    quantization::haar_iwt<std::uint8_t, std::int16_t>::subbands(
+      width, height, num_iters, result);
+  };
+}
+
+} // namespace
+
+void
+image_encoder::set_region_size(std::size_t const region_size)
+{
+  region_size_ = region_size;
+}
+
+void
+image_encoder::set_transform_haar_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::haar_iwt<std::int16_t>.with_boundary(boundary),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta);
+}
+
+void
+image_encoder::set_transform_bior_2_2_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::scaled_bior_2_2_iwt<std::int16_t>.with_boundary(boundary),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta,
+    quantization::scaled_bior_2_2_iwt_divisors);
+}
+
+void
+image_encoder::set_transform_db4_iwt(
+  std::optional<std::size_t> const num_iters,
+  int const q_factor,
+  int const q_alpha,
+  int const q_beta,
+  transform::boundary_extension const boundary)
+{
+  set_wavelet_transform(
+    transform_function_,
+    subband_function_,
+    transform::scaled_db4_iwt<std::int16_t>.with_boundary(boundary),
+    num_iters,
+    q_factor,
+    q_alpha,
+    q_beta,
+    quantization::scaled_db4_iwt_divisors);
 }
 
 void
 image_encoder::set_coding_lzw(coding::lzw::code_point_size_t const code_size,
-                              coding::lzw::options_t const options)
+                              coding::lzw::options_t const options,
+                              std::optional<std::size_t> const chunk_size,
+                              std::uint32_t const dictionary_id)
+{
+  if (code_size < coding::lzw::min_code_size or
+      code_size > coding::lzw::max_code_size)
+  {
+    throw std::invalid_argument{
+      "LZW code size must be between " +
+      std::to_string(coding::lzw::min_code_size) + " and " +
+      std::to_string(coding::lzw::max_code_size) + " bits"
+    };
+  }
+
+  auto dictionary = std::shared_ptr<coding::lzw::preset_dictionary const>{};
+
+  if (dictionary_id != 0u)
+  {
+    auto const found = lzw_dictionaries_.find(dictionary_id);
+
+    if (found == lzw_dictionaries_.end())
+    {
+      throw std::invalid_argument{ "Unknown LZW dictionary id " +
+                                   std::to_string(dictionary_id) };
+    }
+
+    dictionary = found->second;
+  }
+
+  set_byte_encoding(
+    byte_encoding_function_,
+    coding::lzw::encoder{ code_size, options, dictionary },
+    chunk_size,
+    [code_size](coding::lzw::encoder& lzw_encoder,
+                std::span<std::byte const> const input,
+                std::vector<std::byte>& output)
+    {
+      // Reserve the worst case, so that the encoder can write whole blocks
+      auto const output_offset = output.size();
+      output.resize(output_offset +
+                    coding::lzw::max_encoded_size(input.size(), code_size));
+
+      auto const output_end = lzw_encoder(input, output.data() + output_offset);
+      output.resize(static_cast<std::size_t>(output_end - output.data()));
+    });
+
+  models_zeros_ = false;
+}
+
+void
+image_encoder::set_coding_rans(std::optional<std::size_t> const chunk_size)
+{
+  set_byte_encoding(byte_encoding_function_,
+                    coding::rans::encoder{},
+                    chunk_size,
+                    [](coding::rans::encoder& rans_encoder,
+                       std::span<std::byte const> const input,
+                       std::vector<std::byte>& output)
+                    { rans_encoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_encoder::set_coding_rans_interleaved(
+  std::optional<std::size_t> const chunk_size)
+{
+  set_byte_encoding(byte_encoding_function_,
+                    coding::rans::interleaved_encoder{},
+                    chunk_size,
+                    [](coding::rans::interleaved_encoder& rans_encoder,
+                       std::span<std::byte const> const input,
+                       std::vector<std::byte>& output)
+                    { rans_encoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_encoder::set_coding_subband()
+{
+  byte_encoding_function_ =
+    [subband_encoder = coding::subband::encoder{}](
+      std::span<std::byte const> const input,
+      std::span<quantization::subband const> const subbands,
+      std::vector<std::byte>& output,
+      std::size_t /*num_threads*/) mutable
+  { subband_encoder(input, subbands, output); };
+
+  models_zeros_ = true;
+}
+
+void
+image_encoder::set_coding_huffman(std::optional<std::size_t> const chunk_size)
+{
+  set_byte_encoding(byte_encoding_function_,
+                    coding::huffman::encoder{},
+                    chunk_size,
+                    [](coding::huffman::encoder& huffman_encoder,
+                       std::span<std::byte const> const input,
+                       std::vector<std::byte>& output)
+                    { huffman_encoder(input, output); });
+
+  models_zeros_ = false;
+}
+
+void
+image_encoder::set_coding_bitpack()
+{
+  byte_encoding_function_ =
+    [bitpack_encoder = coding::bitpack::encoder{}](
+      std::span<std::byte const> const input,
+      std::span<quantization::subband const> const subbands,
+      std::vector<std::byte>& output,
+      std::size_t /*num_threads*/)
+  { bitpack_encoder(input, subbands, output); };
+
+  models_zeros_ = false;
+}
+
+void
+image_encoder::set_coding_bitplane()
 {
   byte_encoding_function_ =
-    [lzw_encoder = coding::lzw::encoder{ code_size, options }](
+    [bitplane_encoder = coding::bitplane::encoder{}](
       std::span<std::byte const> const input,
-      std::vector<std::byte>& output) mutable
-  { lzw_encoder(input, std::back_inserter(output)); };
+      std::span<quantization::subband const> const subbands,
+      std::vector<std::byte>& output,
+      std::size_t /*num_threads*/) mutable
+  { bitplane_encoder(input, subbands, output); };
+
+  models_zeros_ = true;
+}
+
+void
+image_encoder::add_lzw_dictionary(
+  std::shared_ptr<coding::lzw::preset_dictionary const> dictionary)
+{
+  auto const id = dictionary->id();
+  lzw_dictionaries_.insert_or_assign(id, std::move(dictionary));
+}
+
+void
+image_encoder::set_zero_runs(bool const zero_runs)
+{
+  zero_runs_ = zero_runs;
+}
+
+void
+image_encoder::set_num_threads(std::size_t const num_threads)
+{
+  num_threads_ = std::max(num_threads, std::size_t{ 1 });
 }
 
 void
 image_encoder::operator()(view_2d<std::uint8_t const*> const input,
                           std::vector<std::byte>& output)
+{
+  // The coding and the zero runs are set apart, so check them together here
+  compression_options::check_zero_runs(zero_runs_, models_zeros_);
+
+  transform(input, transform_out_);
+
+  if (not zero_runs_)
+  {
+    byte_encoding_function_(std::as_bytes(std::span{ transform_out_ }),
+                            subbands_,
+                            output,
+                            num_threads_);
+    return;
+  }
+
+  zero_run_coded_.clear();
+  coding::zero_run::encode(std::as_bytes(std::span{ transform_out_ }),
+                           zero_run_coded_);
+
+  // The decoder needs the length to decode the byte coding (into a buffer)
+  auto const offset = output.size();
+  output.resize(offset + sizeof(std::uint64_t));
+  store_le(output.data() + offset,
+           static_cast<std::uint64_t>(zero_run_coded_.size()));
+
+  byte_encoding_function_(zero_run_coded_, {}, output, num_threads_);
+}
+
+void
+image_encoder::transform(view_2d<std::uint8_t const*> const input,
+                         std::vector<std::byte>& output)
 {
   auto const width = input.width();
   auto const height = input.height();
 
-  transform_out_.resize(width * height);
+  output.resize(width * height);
 
   transform_in_regions_.clear();
   transform_out_regions_.clear();
@@ -99,7 +454,7 @@ image_encoder::operator()(view_2d<std::uint8_t const*> const input,
 
         transform_in_regions_.emplace_back(
           input.block(j, i, region_width, region_height));
-        transform_out_regions_.emplace_back(std::span{ transform_out_ }.subspan(
+        transform_out_regions_.emplace_back(std::span{ output }.subspan(
           buffer_offset, region_width * region_height));
 
         buffer_offset += region_width * region_height;
@@ -109,26 +464,31 @@ image_encoder::operator()(view_2d<std::uint8_t const*> const input,
   else
   {
     transform_in_regions_.push_back(input);
-    transform_out_regions_.emplace_back(transform_out_);
+    transform_out_regions_.emplace_back(output);
   }
 
-  // For each region, apply the transform
+  // For each region, apply the transform and describe its subbands
+  subbands_.clear();
+
   for (auto const [in_region, out_region] :
        ranges::views::zip(transform_in_regions_, transform_out_regions_))
   {
     if (transform_function_)
     {
-      transform_function_(in_region, out_region.data());
+      transform_function_(in_region, out_region.data(), num_threads_);
+      subband_function_(in_region.width(), in_region.height(), subbands_);
     }
     else
     {
       // No transform - input will be encoded as is
       std::ranges::copy(in_region.rows() | ranges::views::join,
                         reinterpret_cast<std::uint8_t*>(out_region.data()));
+      subbands_.push_back({ quantization::subband_kind::samples,
+                            0u,
+                            in_region.width(),
+                            in_region.height() });
     }
   }
-
-  byte_encoding_function_(std::as_bytes(std::span{ transform_out_ }), output);
 }
 
 } // namespace pa171
@@ -5,14 +5,39 @@
 #include <cstdint>
 #include <limits>
 #include <optional>
+#include <span>
+#include <vector>
 
 #include <algorithm>
+#include <pa171/quantization/subband.hpp>
 #include <pa171/utils/numeric.hpp>
 #include <pa171/utils/view_2d.hpp>
 
 namespace pa171::quantization
 {
 
+// The smallest divisors of the subbands of a wavelet that keep its
+// coefficients of 8-bit samples in range of the quantized values, whatever
+// the factor. The defaults are those of transform::haar_iwt, whose details
+// are within +-255 (+-510 in the diagonal).
+struct min_divisors
+{
+  int detail = 2;
+  int diagonal = 4;
+  int approx = 1;
+};
+
+// The details of transform::scaled_bior_2_2_iwt reach +-447, and a diagonal
+// at a mirrored corner +-1558
+inline constexpr auto scaled_bior_2_2_iwt_divisors =
+  min_divisors{ .detail = 4, .diagonal = 16, .approx = 1 };
+
+// The details of transform::scaled_db4_iwt reach +-405 (+-717 in the
+// diagonal), and its approximation overshoots to -111..364 when it is not
+// transformed down to a single value
+inline constexpr auto scaled_db4_iwt_divisors =
+  min_divisors{ .detail = 4, .diagonal = 8, .approx = 2 };
+
 template<std::integral SrcType, std::signed_integral HRType>
 class haar_iwt
 {
@@ -32,7 +57,8 @@ public:
                   int const factor = 2u,
                   int const alpha = 2u,
                   int const beta = 0u,
-                  std::optional<std::size_t> const levels = std::nullopt)
+                  std::optional<std::size_t> const levels = std::nullopt,
+                  min_divisors const divisors = {})
     -> std::pair<std::ranges::iterator_t<R>, O>
   {
     return (*this)(std::ranges::begin(range),
@@ -43,7 +69,8 @@ public:
                    factor,
                    alpha,
                    beta,
-                   levels);
+                   levels,
+                   divisors);
   }
 
   template<std::input_iterator I,
@@ -58,14 +85,288 @@ public:
                   int const factor = 2u,
                   int const alpha = 2u,
                   int const beta = 0u,
-                  std::optional<std::size_t> const levels = std::nullopt)
+                  std::optional<std::size_t> const levels = std::nullopt,
+                  min_divisors const divisors = {})
     -> std::pair<I, O>
   {
-    return backtrack(
-      first, last, result, width, height, factor, alpha, beta, levels);
+    return backtrack(first,
+                     last,
+                     result,
+                     width,
+                     height,
+                     factor,
+                     alpha,
+                     beta,
+                     levels,
+                     divisors);
+  }
+
+  // Appends the subbands in the order they are written for a width x height
+  // region. Each level holds the diagonal, horizontal and vertical details
+  // (any of them can be empty), the approximation comes last.
+  static void subbands(std::size_t width,
+                       std::size_t height,
+                       std::optional<std::size_t> levels,
+                       std::vector<subband>& result)
+  {
+    auto level = std::size_t{ 0 };
+
+    while (not(width == 1u and height == 1u) and
+           not(levels and *levels == 0u))
+    {
+      auto const prev_width = ceil_div(width, std::size_t{ 2 });
+      auto const prev_height = ceil_div(height, std::size_t{ 2 });
+
+      result.push_back(
+        { subband_kind::diagonal, level, width / 2u, height / 2u });
+      result.push_back(
+        { subband_kind::horizontal, level, width / 2u, prev_height });
+      result.push_back(
+        { subband_kind::vertical, level, prev_width, height / 2u });
+
+      width = prev_width;
+      height = prev_height;
+      ++level;
+
+      if (levels)
+      {
+        --*levels;
+      }
+    }
+
+    result.push_back({ subband_kind::approximation, level, width, height });
   }
 
+  // Where the runs of a row of a width x height region transformed in place,
+  // given by level, column and row in the layout of the whole region (as
+  // from transform::streaming_2d_wavelet_transform), lie in the layout of
+  // operator(), and their divisors
+  class row_layout
+  {
+  public:
+    row_layout(std::size_t const width,
+               std::size_t const height,
+               int const factor = 2u,
+               int const alpha = 2u,
+               int const beta = 0u,
+               std::optional<std::size_t> const levels = std::nullopt,
+               min_divisors const divisors = {})
+      : divisors_{ divisors }
+    {
+      auto bands = std::vector<subband>{};
+      subbands(width, height, levels, bands);
+
+      auto offset = std::size_t{ 0 };
+      auto level_factor = factor;
+
+      for (auto const& band : bands)
+      {
+        switch (band.kind)
+        {
+          case subband_kind::diagonal:
+            level_factor = std::max(level_factor, 2);
+            levels_.push_back({ level_factor, offset });
+            level_factor = next_factor(level_factor, alpha, beta);
+            break;
+          case subband_kind::horizontal:
+            levels_.back().horizontal = offset;
+            levels_.back().detail_width = band.width;
+            levels_.back().approx_height = band.height;
+            break;
+          case subband_kind::vertical:
+            levels_.back().vertical = offset;
+            levels_.back().approx_width = band.width;
+            break;
+          default:
+            approx_offset_ = offset;
+            approx_width_ = band.width;
+            break;
+        }
+
+        offset += band.size();
+      }
+    }
+
+    // Calls function(first, count, offset, divisor, is_approx) for the parts
+    // of a run of size values, at most two as rows of details may hold both
+    // vertical and diagonal ones: the part holds count values from first in
+    // the run, which go from offset in the layout of operator(), and divisor
+    // is that of its values
+    template<typename Function>
+    void split(std::size_t const level,
+               std::size_t const x,
+               std::size_t const y,
+               std::size_t const size,
+               Function&& function) const
+    {
+      if (level == levels_.size())
+      {
+        function(0u,
+                 size,
+                 approx_offset_ + y * approx_width_ + x,
+                 divisors_.approx,
+                 true);
+        return;
+      }
+
+      auto const& layout = levels_[level];
+
+      if (y < layout.approx_height)
+      {
+        function(0u,
+                 size,
+                 layout.horizontal + y * layout.detail_width +
+                   (x - layout.approx_width),
+                 std::max(layout.factor, divisors_.detail),
+                 false);
+        return;
+      }
+
+      auto const row = y - layout.approx_height;
+      auto const n_vertical = std::min(
+        size,
+        x < layout.approx_width ? layout.approx_width - x : std::size_t{ 0 });
+
+      if (n_vertical > 0u)
+      {
+        function(0u,
+                 n_vertical,
+                 layout.vertical + row * layout.approx_width + x,
+                 std::max(layout.factor, divisors_.detail),
+                 false);
+      }
+
+      if (n_vertical < size)
+      {
+        function(n_vertical,
+                 size - n_vertical,
+                 layout.diagonal + row * layout.detail_width +
+                   (x + n_vertical - layout.approx_width),
+                 std::max(2 * layout.factor, divisors_.diagonal),
+                 false);
+      }
+    }
+
+  private:
+    // Where the subbands of a level start in the output, and their sizes
+    struct level_layout
+    {
+      int factor;
+      std::size_t diagonal;
+      std::size_t horizontal = 0;
+      std::size_t vertical = 0;
+      std::size_t approx_width = 0;
+      std::size_t approx_height = 0;
+      std::size_t detail_width = 0;
+    };
+
+    min_divisors divisors_;
+    std::vector<level_layout> levels_;
+    std::size_t approx_offset_ = 0;
+    std::size_t approx_width_ = 0;
+  };
+
+  // Quantizes a width x height region transformed in place as its results
+  // come, in runs of a row given by level, column and row in the layout of
+  // the whole region (as from transform::streaming_2d_wavelet_transform),
+  // writing each value where operator() would
+  class row_quantizer
+  {
+  public:
+    row_quantizer(std::size_t const width,
+                  std::size_t const height,
+                  int const factor = 2u,
+                  int const alpha = 2u,
+                  int const beta = 0u,
+                  std::optional<std::size_t> const levels = std::nullopt,
+                  min_divisors const divisors = {})
+      : layout_{ width, height, factor, alpha, beta, levels, divisors }
+    {
+    }
+
+    template<std::random_access_iterator O>
+    requires std::output_iterator<O, lr_type>
+    void operator()(std::size_t const level,
+                    std::size_t const x,
+                    std::size_t const y,
+                    std::span<hr_type const> const values,
+                    O const result) const
+    {
+      layout_.split(level,
+                    x,
+                    y,
+                    values.size(),
+                    [&](std::size_t const first,
+                        std::size_t const count,
+                        std::size_t const offset,
+                        int const divisor,
+                        bool const is_approx)
+                    {
+                      auto const part = values.subspan(first, count);
+                      auto const part_result =
+                        result + static_cast<std::ptrdiff_t>(offset);
+
+                      if (is_approx)
+                      {
+                        std::ranges::transform(
+                          part,
+                          part_result,
+                          [=](hr_type const value)
+                          { return quantize_approx(value, divisor); });
+                      }
+                      else
+                      {
+                        std::ranges::transform(
+                          part,
+                          part_result,
+                          [=](hr_type const value)
+                          { return quantize_detail(value, divisor); });
+                      }
+                    });
+    }
+
+  private:
+    row_layout layout_;
+  };
+
 private:
+  static constexpr auto shift =
+    std::numeric_limits<lr_type>::min() -
+    static_cast<lr_type>(std::numeric_limits<src_type>::min());
+
+  // Saturates, as the divisors keep the coefficients of even lengths in
+  // range, but the last sample of an odd length is updated from the other
+  // end, past the range of the input
+  template<std::integral V>
+  static auto saturate(V const value) -> lr_type
+  {
+    return static_cast<lr_type>(
+      std::clamp<V>(value,
+                    std::numeric_limits<lr_type>::min(),
+                    std::numeric_limits<lr_type>::max()));
+  }
+
+  static auto quantize_approx(hr_type const value, int const divisor)
+    -> lr_type
+  {
+    return saturate((value + shift) / divisor);
+  }
+
+  static auto quantize_detail(hr_type const value, int const divisor)
+    -> lr_type
+  {
+    return saturate(value / divisor);
+  }
+
+  // The factor of the next level
+  static auto next_factor(int const factor, int const alpha, int const beta)
+    -> int
+  {
+    return static_cast<int>(ceil_div(static_cast<unsigned>(factor),
+                                     static_cast<unsigned>(alpha))) -
+           beta;
+  }
+
   template<std::input_iterator I,
            std::sentinel_for<I> S,
            std::output_iterator<lr_type> O>
@@ -78,7 +379,8 @@ private:
                  int factor = 2u,
                  int const alpha = 2u,
                  int const beta = 0u,
-                 std::optional<std::size_t> levels = std::nullopt)
+                 std::optional<std::size_t> levels = std::nullopt,
+                 min_divisors const divisors = {})
     -> std::pair<I, O>
   {
     // Factor must be at least 2 to keep the scale of data before transform
@@ -86,16 +388,14 @@ private:
 
     if ((width == 1u and height == 1u) or (levels and *levels == 0u))
     {
-      constexpr auto shift =
-        std::numeric_limits<lr_type>::min() -
-        static_cast<lr_type>(std::numeric_limits<src_type>::min());
-
       auto const transform_result =
         std::ranges::transform(first,
                                last,
                                result,
-                               [](hr_type const value)
-                               { return static_cast<lr_type>(value + shift); });
+                               [=](hr_type const value) {
+                                 return quantize_approx(value,
+                                                        divisors.approx);
+                               });
       first = transform_result.in;
       result = transform_result.out;
 
@@ -111,7 +411,8 @@ private:
       assert(first != last);
 
       // Quantize diagonal (second derivative - needs double factor)
-      *result++ = static_cast<lr_type>(*first++ / (2 * factor));
+      *result++ = quantize_detail(*first++,
+                                  std::max(2 * factor, divisors.diagonal));
     }
 
     for ([[maybe_unused]] auto const i : std::views::iota(
@@ -121,7 +422,8 @@ private:
       assert(first != last);
 
       // Quantize vertical / horizontal
-      *result++ = static_cast<lr_type>(*first++ / factor);
+      *result++ =
+        quantize_detail(*first++, std::max(factor, divisors.detail));
     }
 
     if (levels)
@@ -134,12 +436,11 @@ private:
                      result,
                      prev_width,
                      prev_height,
-                     static_cast<int>(ceil_div(static_cast<unsigned>(factor),
-                                               static_cast<unsigned>(alpha))) -
-                       beta,
+                     next_factor(factor, alpha, beta),
                      alpha,
                      beta,
-                     levels);
+                     levels,
+                     divisors);
   }
 };
 
@@ -162,7 +463,8 @@ public:
                   int const factor = 2u,
                   int const alpha = 2u,
                   int const beta = 0u,
-                  std::optional<std::size_t> const levels = std::nullopt)
+                  std::optional<std::size_t> const levels = std::nullopt,
+                  min_divisors const divisors = {})
     -> std::pair<std::ranges::iterator_t<R>, O>
   {
     return (*this)(std::ranges::begin(range),
@@ -173,7 +475,8 @@ public:
                    factor,
                    alpha,
                    beta,
-                   levels);
+                   levels,
+                   divisors);
   }
 
   template<std::input_iterator I,
@@ -188,14 +491,102 @@ public:
                   int const factor = 2u,
                   int const alpha = 2u,
                   int const beta = 0u,
-                  std::optional<std::size_t> const levels = std::nullopt)
+                  std::optional<std::size_t> const levels = std::nullopt,
+                  min_divisors const divisors = {})
     -> std::pair<I, O>
   {
-    return backtrack(
-      first, last, result, width, height, factor, alpha, beta, levels);
+    return backtrack(first,
+                     last,
+                     result,
+                     width,
+                     height,
+                     factor,
+                     alpha,
+                     beta,
+                     levels,
+                     divisors);
   }
 
+  // Dequantizes the subbands of a width x height region into runs of a row
+  // of the region to be inverted in place, given by level, column and row as
+  // for haar_iwt::row_quantizer, reading each value where operator() would
+  class row_dequantizer
+  {
+  public:
+    row_dequantizer(std::size_t const width,
+                    std::size_t const height,
+                    int const factor = 2u,
+                    int const alpha = 2u,
+                    int const beta = 0u,
+                    std::optional<std::size_t> const levels = std::nullopt,
+                    min_divisors const divisors = {})
+      : layout_{ width, height, factor, alpha, beta, levels, divisors }
+    {
+    }
+
+    template<std::random_access_iterator I>
+    requires std::same_as<std::iter_value_t<I>, lr_type>
+    void operator()(std::size_t const level,
+                    std::size_t const x,
+                    std::size_t const y,
+                    std::span<hr_type> const values,
+                    I const input) const
+    {
+      layout_.split(
+        level,
+        x,
+        y,
+        values.size(),
+        [&](std::size_t const first,
+            std::size_t const count,
+            std::size_t const offset,
+            int const divisor,
+            bool const is_approx)
+        {
+          auto const part_input = input + static_cast<std::ptrdiff_t>(offset);
+          auto const part_end =
+            part_input + static_cast<std::ptrdiff_t>(count);
+          auto const part = values.subspan(first, count);
+
+          if (is_approx)
+          {
+            std::ranges::transform(part_input,
+                                   part_end,
+                                   part.begin(),
+                                   [=](lr_type const value) {
+                                     return dequantize_approx(value, divisor);
+                                   });
+          }
+          else
+          {
+            std::ranges::transform(part_input,
+                                   part_end,
+                                   part.begin(),
+                                   [=](lr_type const value)
+                                   {
+                                     return static_cast<hr_type>(
+                                       static_cast<hr_type>(value) * divisor);
+                                   });
+          }
+        });
+    }
+
+  private:
+    typename haar_iwt<src_type, hr_type>::row_layout layout_;
+  };
+
 private:
+  static constexpr auto inv_shift =
+    static_cast<lr_type>(std::numeric_limits<src_type>::min()) -
+    std::numeric_limits<lr_type>::min();
+
+  static auto dequantize_approx(lr_type const value, int const divisor)
+    -> hr_type
+  {
+    return static_cast<hr_type>(static_cast<hr_type>(value) * divisor +
+                                inv_shift);
+  }
+
   template<std::input_iterator I,
            std::sentinel_for<I> S,
            std::output_iterator<hr_type> O>
@@ -208,23 +599,21 @@ private:
                  int factor = 2u,
                  int const alpha = 2u,
                  int const beta = 0u,
-                 std::optional<std::size_t> levels = std::nullopt)
+                 std::optional<std::size_t> levels = std::nullopt,
+                 min_divisors const divisors = {})
     -> std::pair<I, O>
   {
     factor = std::max(factor, 2);
 
     if ((width == 1u and height == 1u) or (levels and *levels == 0u))
     {
-      constexpr auto inv_shift =
-        static_cast<lr_type>(std::numeric_limits<src_type>::min()) -
-        std::numeric_limits<lr_type>::min();
-
       auto const transform_result =
         std::ranges::transform(first,
                                last,
                                result,
-                               [](lr_type const value) {
-                                 return static_cast<hr_type>(value) + inv_shift;
+                               [=](lr_type const value) {
+                                 return dequantize_approx(value,
+                                                          divisors.approx);
                                });
       first = transform_result.in;
       result = transform_result.out;
@@ -240,7 +629,8 @@ private:
     {
       assert(first != last);
 
-      *result++ = static_cast<hr_type>(*first++) * 2 * factor;
+      *result++ = static_cast<hr_type>(*first++) *
+                  std::max(2 * factor, divisors.diagonal);
     }
 
     for ([[maybe_unused]] auto const i : std::views::iota(
@@ -249,7 +639,8 @@ private:
     {
       assert(first != last);
 
-      *result++ = static_cast<hr_type>(*first++) * factor;
+      *result++ =
+        static_cast<hr_type>(*first++) * std::max(factor, divisors.detail);
     }
 
     if (levels)
@@ -267,7 +658,8 @@ private:
                        beta,
                      alpha,
                      beta,
-                     levels);
+                     levels,
+                     divisors);
   }
 };
 
@@ -0,0 +1 @@
+#include <pa171/quantization/subband.hpp>
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pa171::quantization
+{
+
+enum class subband_kind : std::uint8_t
+{
+  diagonal,
+  horizontal,
+  vertical,
+  // Remaining approximation, as signed values
+  approximation,
+  // Untransformed input, as unsigned values
+  samples,
+};
+
+// A block of quantized values, stored row by row right after the previous
+// subband of the same region
+struct subband
+{
+  subband_kind kind;
+  // Decomposition level; 0 is the finest
+  std::size_t level;
+  std::size_t width;
+  std::size_t height;
+
+  [[nodiscard]] auto size() const noexcept -> std::size_t
+  {
+    return width * height;
+  }
+};
+
+} // namespace pa171::quantization
@@ -0,0 +1,109 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <lyra/lyra.hpp>
+
+#include <pa171/coding/lzw_preset.hpp>
+#include <pa171/compression_options.hpp>
+#include <pa171/image_encoder.hpp>
+#include <pa171/image_io.hpp>
+
+auto
+main(int const argc, char const* const* const argv) -> int
+{
+  try
+  {
+    // Parse arguments
+    auto show_help = false;
+    auto loss_level = 8u;
+    auto max_entries = std::size_t{ 8192 };
+    auto out_path = std::filesystem::path{};
+    auto in_paths = std::vector<std::string>{};
+
+    auto const parser =
+      lyra::cli_parser{}
+        .add_argument(lyra::help(show_help))
+        .add_argument(
+          lyra::opt(loss_level, "level")
+            .name("-l")
+            .name("--loss-level")
+            .help(fmt::format("Compression level the dictionary is used "
+                              "with. 0 = lossless; default = {}; max = {}",
+                              loss_level,
+                              pa171::max_loss_level)))
+        .add_argument(
+          lyra::opt(max_entries, "entries")
+            .name("-n")
+            .name("--entries")
+            .help(fmt::format("Maximum number of dictionary entries; "
+                              "default = {}",
+                              max_entries)))
+        .add_argument(
+          lyra::arg(out_path, "out").required().help("Output dictionary path"))
+        .add_argument(lyra::arg(in_paths, "in")
+                        .cardinality(1, 0)
+                        .help("Sample image paths"));
+
+    if (auto const parse_result = parser.parse(lyra::args(argc, argv));
+        not parse_result)
+    {
+      fmt::print(stderr, "{}\n", parse_result.errorMessage());
+      fmt::print("See --help for correct usage");
+
+      return EXIT_FAILURE;
+    }
+
+    if (show_help)
+    {
+      // Display usage and exit
+      fmt::print("{}", parser);
+
+      return EXIT_SUCCESS;
+    }
+
+    // Transform the samples the same way the compressor does
+    auto encoder = pa171::image_encoder{};
+    pa171::apply_options(pa171::loss_level_options(loss_level), encoder);
+
+    auto sample_data = std::vector<std::vector<std::byte>>(in_paths.size());
+
+    for (auto i = std::size_t{ 0 }; i < in_paths.size(); ++i)
+    {
+      auto width = std::size_t{};
+      auto height = std::size_t{};
+      auto const image_data =
+        pa171::read_grayscale_image(in_paths[i], width, height);
+
+      encoder.transform(pa171::view_2d{ image_data.get(), width, height },
+                        sample_data[i]);
+    }
+
+    // Train and write the dictionary
+    auto const samples = std::vector<std::span<std::byte const>>(
+      sample_data.begin(), sample_data.end());
+    auto const dictionary =
+      pa171::coding::lzw::train_preset_dictionary(samples, max_entries);
+
+    pa171::coding::lzw::write_preset_dictionary(out_path, dictionary);
+
+    fmt::print("Dictionary {:08x}: {} entries\n",
+               dictionary.id(),
+               dictionary.entries().size());
+  }
+  catch (std::exception const& error)
+  {
+    fmt::print(stderr, "{}\n", error.what());
+
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
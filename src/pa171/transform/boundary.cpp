@@ -0,0 +1 @@
+#include <pa171/transform/boundary.hpp>
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <pa171/utils/numeric.hpp>
+
+namespace pa171::transform
+{
+
+// How the lifting steps extend a signal past its ends
+enum class boundary_extension : std::uint8_t
+{
+  // The signal repeats, so the samples at one end are predicted from those
+  // at the other
+  periodic,
+  // The signal is mirrored about its first and last samples, which are not
+  // repeated (whole-sample symmetric extension), so smooth signals stay
+  // smooth across the ends
+  symmetric,
+};
+
+// Maps the index of a source sample read by a lifting step, which may lie
+// past either end, to the sample that the extension puts there. The steps
+// read the even samples (the approximation) behind their target, direction
+// < 0, and the odd ones (the detail) ahead of it; n_source and n_target are
+// the sample counts of both halves of the signal. Indices within the source
+// map to themselves.
+template<int direction>
+[[nodiscard]] constexpr auto
+boundary_index(boundary_extension const extension,
+               std::ptrdiff_t const index,
+               std::ptrdiff_t const n_source,
+               std::ptrdiff_t const n_target) noexcept -> std::ptrdiff_t
+{
+  if (extension == boundary_extension::periodic)
+  {
+    return wrap_mod(index, n_source);
+  }
+
+  // Mirror the position in the whole signal, which keeps its parity
+  constexpr auto parity = direction < 0 ? 0 : 1;
+  auto const n_signal = n_source + n_target;
+  auto const period = 2 * (n_signal - 1);
+  if (period == 0)
+  {
+    return 0;
+  }
+
+  auto position = wrap_mod(2 * index + parity, period);
+  if (position >= n_signal)
+  {
+    position = period - position;
+  }
+
+  return (position - parity) / 2;
+}
+
+} // namespace pa171::transform
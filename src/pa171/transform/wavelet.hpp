@@ -1,14 +1,23 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <concepts>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
 #include <numbers>
 #include <optional>
 #include <ranges>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 #include <range/v3/view/concat.hpp>
 #include <range/v3/view/counted.hpp>
@@ -19,7 +28,10 @@
 #include <range/v3/view/take.hpp>
 #include <range/v3/view/unbounded.hpp>
 
+#include <pa171/transform/boundary.hpp>
 #include <pa171/utils/numeric.hpp>
+#include <pa171/utils/parallel.hpp>
+#include <pa171/utils/simd.hpp>
 #include <pa171/utils/view_2d.hpp>
 
 namespace pa171::transform
@@ -39,6 +51,310 @@ concept lifting_step = std::is_arithmetic_v<T> and
    } {}(step, value, std::make_index_sequence<order>{}));
 };
 
+#ifdef PA171_X86_SIMD
+template<typename Step, typename Indices>
+inline constexpr auto has_avx2_step = false;
+
+template<typename Step, std::size_t... indices>
+inline constexpr auto has_avx2_step<Step, std::index_sequence<indices...>> =
+  requires(Step const& step, __m256i const value)
+{
+  step.avx2((indices, value)...);
+};
+#endif
+
+// A lifting step that can also be applied to 16 int16 lanes at once with
+// AVX2; its avx2 function must give the same results as the scalar step
+template<typename Step, typename T, std::size_t order>
+concept avx2_lifting_step =
+#ifdef PA171_X86_SIMD
+  std::same_as<T, std::int16_t> and lifting_step<Step, T, order> and
+  has_avx2_step<Step, std::make_index_sequence<order>>;
+#else
+  false;
+#endif
+
+// The step inserted between two predict or two update steps
+template<typename T>
+struct zero_lifting_step
+{
+  constexpr auto operator()(auto const&... /*values*/) const -> T
+  {
+    return T{ 0 };
+  }
+
+#ifdef PA171_X86_SIMD
+  template<typename... V>
+  PA171_TARGET_AVX2 static auto avx2(V const&... /*values*/) -> __m256i
+  {
+    return _mm256_setzero_si256();
+  }
+#endif
+};
+
+// Adds sign * step(source[i + direction * offset]...) to each target[i], the
+// offsets running from 0 to order - 1 and the source indices extended past
+// the ends by boundary. Only the first and last few indices can lie past
+// them, so the interior is a plain loop without the index mapping, which the
+// compiler can vectorise.
+template<int sign,
+         int direction,
+         std::size_t order,
+         typename Step,
+         std::random_access_iterator OT,
+         std::random_access_iterator IS>
+void
+apply_lifting_step(Step const& step,
+                   OT const target,
+                   std::ptrdiff_t const n_target,
+                   IS const source,
+                   std::ptrdiff_t const n_source,
+                   boundary_extension const boundary)
+{
+  constexpr auto reach = static_cast<std::ptrdiff_t>(order) - 1;
+
+  auto const interior_first = std::min(direction < 0 ? reach : 0, n_target);
+  auto const interior_last = std::clamp(
+    direction < 0 ? n_source : n_source - reach, interior_first, n_target);
+
+  auto const apply = [&](std::ptrdiff_t const i, auto const index)
+  {
+    [&]<std::size_t... offsets>(std::index_sequence<offsets...>)
+    {
+      auto const value = step(
+        source[index(i + direction * static_cast<std::ptrdiff_t>(offsets))]...);
+      if constexpr (sign > 0)
+      {
+        target[i] += value;
+      }
+      else
+      {
+        target[i] -= value;
+      }
+    }
+    (std::make_index_sequence<order>{});
+  };
+
+  auto const extended = [&](std::ptrdiff_t const index)
+  {
+    return boundary_index<direction>(boundary, index, n_source, n_target);
+  };
+  auto const unwrapped = [](std::ptrdiff_t const index)
+  {
+    return index;
+  };
+
+  auto i = std::ptrdiff_t{ 0 };
+  for (; i < interior_first; ++i)
+  {
+    apply(i, extended);
+  }
+
+  for (; i < interior_last; ++i)
+  {
+    apply(i, unwrapped);
+  }
+
+  for (; i < n_target; ++i)
+  {
+    apply(i, extended);
+  }
+}
+
+#ifdef PA171_X86_SIMD
+// Returns step(source[direction * offset]...) for 16 lanes
+template<int direction, typename Step, std::size_t... offsets>
+PA171_TARGET_AVX2 auto
+lifting_step_avx2(Step const& step,
+                  std::int16_t const* const source,
+                  std::index_sequence<offsets...>) -> __m256i
+{
+  return step.avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(
+    source + direction * static_cast<std::ptrdiff_t>(offsets)))...);
+}
+
+// Adds sign * step(source[i + direction * offset]...) to each target[i], the
+// offsets running from 0 to order - 1 and the source indices extended past
+// the ends as in the generic lifting loops. Only the interior, where no index
+// lies past them, is vectorised.
+template<int sign, int direction, std::size_t order, typename Step>
+requires avx2_lifting_step<Step, std::int16_t, order>
+PA171_TARGET_AVX2 void
+apply_lifting_step_avx2(Step const& step,
+                        std::int16_t* const target,
+                        std::ptrdiff_t const n_target,
+                        std::int16_t const* const source,
+                        std::ptrdiff_t const n_source,
+                        boundary_extension const boundary)
+{
+  constexpr auto lanes = std::ptrdiff_t{ 16 };
+  constexpr auto reach = static_cast<std::ptrdiff_t>(order) - 1;
+
+  auto const interior_first = std::min(direction < 0 ? reach : 0, n_target);
+  auto const interior_last = std::clamp(
+    direction < 0 ? n_source : n_source - reach, interior_first, n_target);
+
+  auto const apply_scalar = [&](std::ptrdiff_t const i)
+  {
+    [&]<std::size_t... offsets>(std::index_sequence<offsets...>)
+    {
+      auto const value = step(source[boundary_index<direction>(
+        boundary,
+        i + direction * static_cast<std::ptrdiff_t>(offsets),
+        n_source,
+        n_target)]...);
+      target[i] = static_cast<std::int16_t>(
+        sign > 0 ? target[i] + value : target[i] - value);
+    }
+    (std::make_index_sequence<order>{});
+  };
+
+  auto i = std::ptrdiff_t{ 0 };
+  for (; i < interior_first; ++i)
+  {
+    apply_scalar(i);
+  }
+
+  for (; i + lanes <= interior_last; i += lanes)
+  {
+    auto const value = lifting_step_avx2<direction>(
+      step, source + i, std::make_index_sequence<order>{});
+    auto const result = reinterpret_cast<__m256i*>(target + i);
+    auto const previous = _mm256_loadu_si256(result);
+    _mm256_storeu_si256(result,
+                        sign > 0 ? _mm256_add_epi16(previous, value)
+                                 : _mm256_sub_epi16(previous, value));
+  }
+
+  for (; i < n_target; ++i)
+  {
+    apply_scalar(i);
+  }
+}
+#endif
+
+// Adds step(rows[c]...) to target[c] (sign > 0) or subtracts it, for each
+// of the width elements, like the generic lifting loops do per element
+template<int sign, typename T, typename Step, typename... Rows>
+void
+apply_lifting_step_row(Step const& step,
+                       T* const target,
+                       std::size_t const width,
+                       Rows const* const... rows)
+{
+  for (auto const c : std::views::iota(std::size_t{ 0 }, width))
+  {
+    if constexpr (sign > 0)
+    {
+      target[c] += step(rows[c]...);
+    }
+    else
+    {
+      target[c] -= step(rows[c]...);
+    }
+  }
+}
+
+#ifdef PA171_X86_SIMD
+template<int sign, typename Step, typename... Rows>
+PA171_TARGET_AVX2 void
+apply_lifting_step_row_avx2(Step const& step,
+                            std::int16_t* const target,
+                            std::size_t const width,
+                            Rows const* const... rows)
+{
+  constexpr auto lanes = std::size_t{ 16 };
+
+  auto c = std::size_t{ 0 };
+  for (; c + lanes <= width; c += lanes)
+  {
+    auto const value = step.avx2(
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rows + c))...);
+    auto const result = reinterpret_cast<__m256i*>(target + c);
+    auto const previous = _mm256_loadu_si256(result);
+    _mm256_storeu_si256(result,
+                        sign > 0 ? _mm256_add_epi16(previous, value)
+                                 : _mm256_sub_epi16(previous, value));
+  }
+
+  apply_lifting_step_row<sign>(step, target + c, width - c, (rows + c)...);
+}
+#endif
+
+// Applies a lifting step to the row of width elements at target, reading
+// the given source rows, with AVX2 where the step has it and use_avx2 is set
+template<int sign, std::size_t order, typename T, typename Step>
+void
+apply_lifting_step_to_row(Step const& step,
+                          T* const target,
+                          std::size_t const width,
+                          std::array<T const*, order> const& sources,
+                          [[maybe_unused]] bool const use_avx2)
+{
+  // Checked here rather than in the lambda, which trips up GCC 12
+  [[maybe_unused]] constexpr auto is_avx2_step =
+    avx2_lifting_step<Step, T, order>;
+
+  [&]<std::size_t... offsets>(std::index_sequence<offsets...>)
+  {
+#ifdef PA171_X86_SIMD
+    if constexpr (is_avx2_step)
+    {
+      if (use_avx2)
+      {
+        apply_lifting_step_row_avx2<sign>(
+          step, target, width, sources[offsets]...);
+        return;
+      }
+    }
+#endif
+
+    apply_lifting_step_row<sign>(step, target, width, sources[offsets]...);
+  }
+  (std::make_index_sequence<order>{});
+}
+
+// Applies a lifting step to the n_target rows of width elements at target,
+// row i using the source rows i + direction * offset for the offsets 0 to
+// order - 1, extended past the ends by boundary. Rows of both are row_stride
+// elements apart.
+// This lifts many signals laid out as columns at once, running over memory
+// along rows.
+template<int sign, int direction, std::size_t order, typename T, typename Step>
+void
+apply_lifting_step_rows(Step const& step,
+                        T* const target,
+                        std::ptrdiff_t const n_target,
+                        T const* const source,
+                        std::ptrdiff_t const n_source,
+                        std::size_t const width,
+                        std::size_t const row_stride,
+                        boundary_extension const boundary,
+                        bool const use_avx2)
+{
+  for (auto const i : std::views::iota(std::ptrdiff_t{ 0 }, n_target))
+  {
+    auto sources = std::array<T const*, order>{};
+    for (auto const offset : std::views::iota(std::size_t{ 0 }, order))
+    {
+      sources[offset] =
+        source + static_cast<std::size_t>(boundary_index<direction>(
+                   boundary,
+                   i + direction * static_cast<std::ptrdiff_t>(offset),
+                   n_source,
+                   n_target)) *
+                   row_stride;
+    }
+
+    apply_lifting_step_to_row<sign>(
+      step,
+      target + static_cast<std::size_t>(i) * row_stride,
+      width,
+      sources,
+      use_avx2);
+  }
+}
+
 template<typename T, std::size_t order, lifting_step<T, order>... Steps>
 class inverse_lifting_wavelet_transform
 {
@@ -46,10 +362,14 @@ public:
   constexpr inverse_lifting_wavelet_transform(
     std::optional<T> const approx_norm,
     std::optional<T> const detail_norm,
+    bool const allow_simd,
+    boundary_extension const boundary,
     Steps const&... steps)
     : steps_{ steps... }
     , approx_norm_{ approx_norm }
     , detail_norm_{ detail_norm }
+    , allow_simd_{ allow_simd }
+    , boundary_{ boundary }
   {
   }
 
@@ -136,6 +456,21 @@ public:
       std::distance(odd_result, odd_last),
     };
 
+    lift(even_result, n_even, odd_result, n_odd);
+
+    return { even_last, odd_last };
+  }
+
+  // Undoes the normalization and lifting steps in place, turning the
+  // approximation into the even samples of a signal and the detail into the
+  // odd ones
+  template<std::random_access_iterator O1, std::random_access_iterator O2>
+  requires std::output_iterator<O1, T> and std::output_iterator<O2, T>
+  void lift(O1 const even_result,
+            std::ptrdiff_t const n_even,
+            O2 const odd_result,
+            std::ptrdiff_t const n_odd) const
+  {
     if (approx_norm_)
     {
       for (auto const i : std::views::iota(std::ptrdiff_t{ 0 }, n_even))
@@ -152,6 +487,11 @@ public:
       }
     }
 
+    if (lift_avx2(even_result, n_even, odd_result, n_odd))
+    {
+      return;
+    }
+
     ([&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
      {
        (
@@ -162,39 +502,204 @@ public:
              sizeof...(Steps) - step_index - 1u;
            if constexpr (reversed_step_index % 2 == 0)
            {
-             auto const& predict = std::get<reversed_step_index>(steps_);
-
-             for (auto const i : std::views::iota(std::ptrdiff_t{ 0 }, n_odd))
-             {
-               ([&]<std::size_t... offsets>(std::index_sequence<offsets...>) {
-                 odd_result[i] += predict(even_result[wrap_mod(
-                   i - static_cast<std::ptrdiff_t>(offsets), n_even)]...);
-               }(std::make_index_sequence<order>{}));
-             }
+             apply_lifting_step<1, -1, order>(
+               std::get<reversed_step_index>(steps_),
+               odd_result,
+               n_odd,
+               even_result,
+               n_even,
+               boundary_);
            }
            else
            {
-             auto const& update = std::get<reversed_step_index>(steps_);
-
-             for (auto const i : std::views::iota(std::ptrdiff_t{ 0 }, n_even))
-             {
-               ([&]<std::size_t... offsets>(std::index_sequence<offsets...>) {
-                 even_result[i] -= update(odd_result[wrap_mod(
-                   i + static_cast<std::ptrdiff_t>(offsets), n_odd)]...);
-               }(std::make_index_sequence<order>{}));
-             }
+             apply_lifting_step<-1, 1, order>(
+               std::get<reversed_step_index>(steps_),
+               even_result,
+               n_even,
+               odd_result,
+               n_odd,
+               boundary_);
            }
          }(std::integral_constant<std::size_t, step_indices>{}),
          ...);
      }(std::make_index_sequence<sizeof...(Steps)>{}));
+  }
 
-    return { even_last, odd_last };
+  // Inversely transforms each column of the image in place, its first half
+  // of rows holding the approximation and the rest the detail. The columns
+  // are lifted together a row at a time in buffer, so that memory is only
+  // accessed along rows; the results equal those of the 1D transform.
+  template<std::random_access_iterator O>
+  requires std::output_iterator<O, T>
+  void transform_columns(view_2d<O> const image, std::vector<T>& buffer) const
+  {
+    auto const width = image.width();
+    auto const height = image.height();
+    auto const n_even = ceil_div(height, std::size_t{ 2 });
+    auto const n_odd = height / 2u;
+
+    buffer.resize(width * height);
+    auto const even = buffer.data();
+    auto const odd = even + n_even * width;
+
+    for (auto const i : std::views::iota(std::size_t{ 0 }, height))
+    {
+      std::ranges::copy(image.row(i), even + i * width);
+    }
+
+    lift_columns(even, n_even, odd, n_odd, width, width);
+
+    // Interleave the rows
+    for (auto const i : std::views::iota(std::size_t{ 0 }, height))
+    {
+      auto const row = (i % 2u == 0u ? even : odd) + i / 2u * width;
+      std::ranges::copy(row, row + width, image.row(i).begin());
+    }
+  }
+
+  // Undoes lift_columns of the forward transform in place, for n_even
+  // approximation rows and n_odd detail rows of width elements, row_stride
+  // apart
+  void lift_columns(T* const even,
+                    std::size_t const n_even,
+                    T* const odd,
+                    std::size_t const n_odd,
+                    std::size_t const width,
+                    std::size_t const row_stride) const
+  {
+    if (approx_norm_)
+    {
+      for (auto const i : std::views::iota(std::size_t{ 0 }, n_even))
+      {
+        for (auto& value : std::span{ even + i * row_stride, width })
+        {
+          value *= *approx_norm_;
+        }
+      }
+    }
+
+    if (detail_norm_)
+    {
+      for (auto const i : std::views::iota(std::size_t{ 0 }, n_odd))
+      {
+        for (auto& value : std::span{ odd + i * row_stride, width })
+        {
+          value *= *detail_norm_;
+        }
+      }
+    }
+
+    auto const use_avx2 = allow_simd_ and has_avx2();
+
+    [&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
+    {
+      (
+        [&]
+        {
+          constexpr auto reversed_step_index =
+            sizeof...(Steps) - step_indices - 1u;
+          auto const& step = std::get<reversed_step_index>(steps_);
+
+          if constexpr (std::same_as<std::remove_cvref_t<decltype(step)>,
+                                     zero_lifting_step<T>>)
+          {
+            // Nothing to undo
+          }
+          else if constexpr (reversed_step_index % 2 == 0)
+          {
+            apply_lifting_step_rows<1, -1, order>(
+              step,
+              odd,
+              static_cast<std::ptrdiff_t>(n_odd),
+              even,
+              static_cast<std::ptrdiff_t>(n_even),
+              width,
+              row_stride,
+              boundary_,
+              use_avx2);
+          }
+          else
+          {
+            apply_lifting_step_rows<-1, 1, order>(
+              step,
+              even,
+              static_cast<std::ptrdiff_t>(n_even),
+              odd,
+              static_cast<std::ptrdiff_t>(n_odd),
+              width,
+              row_stride,
+              boundary_,
+              use_avx2);
+          }
+        }(),
+        ...);
+    }
+    (std::make_index_sequence<sizeof...(Steps)>{});
   }
 
 private:
   std::tuple<Steps...> steps_;
   std::optional<T> approx_norm_ = std::nullopt;
   std::optional<T> detail_norm_ = std::nullopt;
+  bool allow_simd_ = true;
+  boundary_extension boundary_ = boundary_extension::periodic;
+
+  // Runs the steps with their AVX2 versions if all have one, the results are
+  // contiguous and the CPU supports it; returns whether it did
+  template<typename O1, typename O2>
+  auto lift_avx2([[maybe_unused]] O1 const even_result,
+                 [[maybe_unused]] std::ptrdiff_t const n_even,
+                 [[maybe_unused]] O2 const odd_result,
+                 [[maybe_unused]] std::ptrdiff_t const n_odd) const -> bool
+  {
+#ifdef PA171_X86_SIMD
+    if constexpr (std::contiguous_iterator<O1> and
+                  std::contiguous_iterator<O2> and
+                  (avx2_lifting_step<Steps, T, order> and ...))
+    {
+      if (not allow_simd_ or not has_avx2())
+      {
+        return false;
+      }
+
+      auto const even = std::to_address(even_result);
+      auto const odd = std::to_address(odd_result);
+
+      [&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
+      {
+        (
+          [&]
+          {
+            constexpr auto reversed_step_index =
+              sizeof...(Steps) - step_indices - 1u;
+            auto const& step = std::get<reversed_step_index>(steps_);
+
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(step)>,
+                                       zero_lifting_step<T>>)
+            {
+              // Nothing to undo
+            }
+            else if constexpr (reversed_step_index % 2 == 0)
+            {
+              apply_lifting_step_avx2<1, -1, order>(
+                step, odd, n_odd, even, n_even, boundary_);
+            }
+            else
+            {
+              apply_lifting_step_avx2<-1, 1, order>(
+                step, even, n_even, odd, n_odd, boundary_);
+            }
+          }(),
+          ...);
+      }
+      (std::make_index_sequence<sizeof...(Steps)>{});
+
+      return true;
+    }
+#endif
+
+    return false;
+  }
 };
 
 template<typename T, std::size_t order, lifting_step<T, order>... Steps>
@@ -229,7 +734,7 @@ public:
   [[nodiscard]] constexpr auto predict_step(P const& predict) const
     requires(sizeof...(Steps) % 2 == 1)
   {
-    return update_step([](auto const&...) { return T{ 0 }; })
+    return update_step(zero_lifting_step<T>{})
       .predict_step(predict);
   }
 
@@ -253,7 +758,7 @@ public:
   [[nodiscard]] constexpr auto update_step(U const& update) const
     requires(sizeof...(Steps) % 2 == 0)
   {
-    return predict_step([](auto const&...) { return T{ 0 }; })
+    return predict_step(zero_lifting_step<T>{})
       .update_step(update);
   }
 
@@ -271,6 +776,31 @@ public:
     return *this;
   }
 
+  // Returns a copy that always runs the generic per-element steps, the
+  // reference for the AVX2 kernels; its inverse does the same
+  [[nodiscard]] constexpr auto without_simd() const
+    -> lifting_wavelet_transform
+  {
+    auto result = *this;
+    result.allow_simd_ = false;
+    return result;
+  }
+
+  // Returns a copy that extends signals past their ends as given, periodic
+  // by default; its inverse does the same
+  [[nodiscard]] constexpr auto with_boundary(
+    boundary_extension const boundary) const -> lifting_wavelet_transform
+  {
+    auto result = *this;
+    result.boundary_ = boundary;
+    return result;
+  }
+
+  [[nodiscard]] constexpr auto boundary() const noexcept -> boundary_extension
+  {
+    return boundary_;
+  }
+
   [[nodiscard]] constexpr auto inverse() const
     -> inverse_lifting_wavelet_transform<T, order, Steps...>
   {
@@ -280,6 +810,8 @@ public:
         return inverse_lifting_wavelet_transform<T, order, Steps...>{
           approx_norm_,
           detail_norm_,
+          allow_simd_,
+          boundary_,
           steps...,
         };
       },
@@ -361,41 +893,52 @@ public:
       std::distance(detail_result, detail_last),
     };
 
-    ([&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
-     {
-       (
-         [&]<std::size_t step_index>(
-           std::integral_constant<std::size_t, step_index>)
-         {
-           if constexpr (step_index % 2 == 0)
-           {
-             auto const& predict = std::get<step_index>(steps_);
+    lift(approximation_result, n_approx, detail_result, n_detail);
+
+    return { approximation_last, detail_last };
+  }
 
-             for (auto const i :
-                  std::views::iota(std::ptrdiff_t{ 0 }, n_detail))
+  // Applies the lifting steps and normalization in place to the even samples
+  // of a signal, given as the approximation, and to the odd ones, given as
+  // the detail
+  template<std::random_access_iterator OA, std::random_access_iterator OD>
+  requires std::output_iterator<OA, T> and std::output_iterator<OD, T>
+  void lift(OA const approximation_result,
+            std::ptrdiff_t const n_approx,
+            OD const detail_result,
+            std::ptrdiff_t const n_detail) const
+  {
+    if (not lift_avx2(
+          approximation_result, n_approx, detail_result, n_detail))
+    {
+      ([&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
+       {
+         (
+           [&]<std::size_t step_index>(
+             std::integral_constant<std::size_t, step_index>)
+           {
+             if constexpr (step_index % 2 == 0)
              {
-               ([&]<std::size_t... offsets>(std::index_sequence<offsets...>) {
-                 detail_result[i] -= predict(approximation_result[wrap_mod(
-                   i - static_cast<std::ptrdiff_t>(offsets), n_approx)]...);
-               }(std::make_index_sequence<order>{}));
+               apply_lifting_step<-1, -1, order>(std::get<step_index>(steps_),
+                                                 detail_result,
+                                                 n_detail,
+                                                 approximation_result,
+                                                 n_approx,
+                                                 boundary_);
              }
-           }
-           else
-           {
-             auto const& update = std::get<step_index>(steps_);
-
-             for (auto const i :
-                  std::views::iota(std::ptrdiff_t{ 0 }, n_approx))
+             else
              {
-               ([&]<std::size_t... offsets>(std::index_sequence<offsets...>) {
-                 approximation_result[i] += update(detail_result[wrap_mod(
-                   i + static_cast<std::ptrdiff_t>(offsets), n_detail)]...);
-               }(std::make_index_sequence<order>{}));
+               apply_lifting_step<1, 1, order>(std::get<step_index>(steps_),
+                                               approximation_result,
+                                               n_approx,
+                                               detail_result,
+                                               n_detail,
+                                               boundary_);
              }
-           }
-         }(std::integral_constant<std::size_t, step_indices>{}),
-         ...);
-     }(std::make_index_sequence<sizeof...(Steps)>{}));
+           }(std::integral_constant<std::size_t, step_indices>{}),
+           ...);
+       }(std::make_index_sequence<sizeof...(Steps)>{}));
+    }
 
     if (approx_norm_)
     {
@@ -412,59 +955,497 @@ public:
         detail_result[i] /= *detail_norm_;
       }
     }
+  }
 
-    return { approximation_last, detail_last };
+  // Transforms each column of the image in place, the approximation going
+  // to the first half of its rows and the detail to the rest. The columns
+  // are lifted together a row at a time in buffer, so that memory is only
+  // accessed along rows; the results equal those of the 1D transform.
+  template<std::random_access_iterator I>
+  requires std::output_iterator<I, T>
+  void transform_columns(view_2d<I> const image, std::vector<T>& buffer) const
+  {
+    auto const width = image.width();
+    auto const height = image.height();
+    auto const n_approx = ceil_div(height, std::size_t{ 2 });
+    auto const n_detail = height / 2u;
+
+    buffer.resize(width * height);
+    auto const approx = buffer.data();
+    auto const detail = approx + n_approx * width;
+
+    // Deinterleave the rows
+    for (auto const i : std::views::iota(std::size_t{ 0 }, height))
+    {
+      std::ranges::copy(image.row(i),
+                        (i % 2u == 0u ? approx : detail) + i / 2u * width);
+    }
+
+    lift_columns(approx, n_approx, detail, n_detail, width, width);
+
+    for (auto const i : std::views::iota(std::size_t{ 0 }, height))
+    {
+      auto const row = approx + i * width;
+      std::ranges::copy(row, row + width, image.row(i).begin());
+    }
+  }
+
+  // Lifts many signals laid out as the columns of n_approx approximation
+  // rows and n_detail detail rows in place, like lift does for one. The
+  // rows hold width elements each, row_stride apart.
+  void lift_columns(T* const approx,
+                    std::size_t const n_approx,
+                    T* const detail,
+                    std::size_t const n_detail,
+                    std::size_t const width,
+                    std::size_t const row_stride) const
+  {
+    auto const use_avx2 = allow_simd_ and has_avx2();
+
+    [&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
+    {
+      (
+        [&]
+        {
+          auto const& step = std::get<step_indices>(steps_);
+
+          if constexpr (std::same_as<std::remove_cvref_t<decltype(step)>,
+                                     zero_lifting_step<T>>)
+          {
+            // Nothing to apply
+          }
+          else if constexpr (step_indices % 2 == 0)
+          {
+            apply_lifting_step_rows<-1, -1, order>(
+              step,
+              detail,
+              static_cast<std::ptrdiff_t>(n_detail),
+              approx,
+              static_cast<std::ptrdiff_t>(n_approx),
+              width,
+              row_stride,
+              boundary_,
+              use_avx2);
+          }
+          else
+          {
+            apply_lifting_step_rows<1, 1, order>(
+              step,
+              approx,
+              static_cast<std::ptrdiff_t>(n_approx),
+              detail,
+              static_cast<std::ptrdiff_t>(n_detail),
+              width,
+              row_stride,
+              boundary_,
+              use_avx2);
+          }
+        }(),
+        ...);
+    }
+    (std::make_index_sequence<sizeof...(Steps)>{});
+
+    for (auto const i : std::views::iota(std::size_t{ 0 }, n_approx))
+    {
+      normalize_row(approx + i * row_stride, width, false);
+    }
+
+    for (auto const i : std::views::iota(std::size_t{ 0 }, n_detail))
+    {
+      normalize_row(detail + i * row_stride, width, true);
+    }
+  }
+
+  static constexpr auto num_steps = sizeof...(Steps);
+
+  // Applies step step_index to one row of the signals laid out as columns
+  // by lift_columns, given the rows of the other half it reads by offset:
+  // the approximation rows 0 to order - 1 behind the detail row for predict
+  // steps (even indices), the detail rows ahead of the approximation row for
+  // update steps, both extended past the ends as boundary() says
+  void lift_row(std::size_t const step_index,
+                T* const target,
+                std::array<T const*, order> const& sources,
+                std::size_t const width) const
+  {
+    auto const use_avx2 = allow_simd_ and has_avx2();
+
+    [&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
+    {
+      (
+        [&]
+        {
+          auto const& step = std::get<step_indices>(steps_);
+
+          if constexpr (std::same_as<std::remove_cvref_t<decltype(step)>,
+                                     zero_lifting_step<T>>)
+          {
+            // Nothing to apply
+          }
+          else if (step_index == step_indices)
+          {
+            apply_lifting_step_to_row<step_indices % 2 == 0 ? -1 : 1>(
+              step, target, width, sources, use_avx2);
+          }
+        }(),
+        ...);
+    }
+    (std::make_index_sequence<sizeof...(Steps)>{});
+  }
+
+  // Normalizes a row of approximations or of details after the steps
+  void normalize_row(T* const row,
+                     std::size_t const width,
+                     bool const is_detail) const
+  {
+    if (auto const& norm = is_detail ? detail_norm_ : approx_norm_; norm)
+    {
+      for (auto& value : std::span{ row, width })
+      {
+        value /= *norm;
+      }
+    }
+  }
+
+  // Transforms a row in place, the approximation going to its first half
+  // and the detail to the rest; buffer holds the odd elements meanwhile
+  void transform_row(T* const row,
+                     std::size_t const width,
+                     std::vector<T>& buffer) const
+  {
+    auto const n_approx = ceil_div(width, std::size_t{ 2 });
+
+    buffer.resize(width / 2u);
+    for (auto const k : std::views::iota(std::size_t{ 0 }, width / 2u))
+    {
+      buffer[k] = row[2u * k + 1u];
+    }
+
+    for (auto const k : std::views::iota(std::size_t{ 0 }, n_approx))
+    {
+      row[k] = row[2u * k];
+    }
+
+    std::ranges::copy(buffer, row + n_approx);
+
+    lift(row,
+         static_cast<std::ptrdiff_t>(n_approx),
+         row + n_approx,
+         static_cast<std::ptrdiff_t>(width / 2u));
   }
 
 private:
   std::tuple<Steps...> steps_;
   std::optional<T> approx_norm_ = std::nullopt;
   std::optional<T> detail_norm_ = std::nullopt;
-};
-
-template<std::integral I>
-constexpr auto haar_iwt = lifting_wavelet_transform<I, 1u>{}
-                            .predict_step([](I const a) { return a; })
-                            .update_step([](I const d)
-                                         { return static_cast<I>(d / 2); });
+  bool allow_simd_ = true;
+  boundary_extension boundary_ = boundary_extension::periodic;
+
+  // Runs the steps with their AVX2 versions if all have one, the results are
+  // contiguous and the CPU supports it; returns whether it did
+  template<typename OA, typename OD>
+  auto lift_avx2([[maybe_unused]] OA const approximation_result,
+                 [[maybe_unused]] std::ptrdiff_t const n_approx,
+                 [[maybe_unused]] OD const detail_result,
+                 [[maybe_unused]] std::ptrdiff_t const n_detail) const -> bool
+  {
+#ifdef PA171_X86_SIMD
+    if constexpr (std::contiguous_iterator<OA> and
+                  std::contiguous_iterator<OD> and
+                  (avx2_lifting_step<Steps, T, order> and ...))
+    {
+      if (not allow_simd_ or not has_avx2())
+      {
+        return false;
+      }
 
-template<std::integral I>
-constexpr auto db4_iwt = []
-{
-  using std::numbers::sqrt3;
+      auto const approx = std::to_address(approximation_result);
+      auto const detail = std::to_address(detail_result);
 
-  return lifting_wavelet_transform<I, 2u>{}
-    .update_step([](I const d0, auto...) { return static_cast<I>(d0 * sqrt3); })
-    .predict_step(
-      [](I const a0, I const a1)
+      [&]<std::size_t... step_indices>(std::index_sequence<step_indices...>)
       {
-        constexpr auto c0 = sqrt3 / 4;
-        constexpr auto c1 = (sqrt3 - 2) / 4;
+        (
+          [&]
+          {
+            auto const& step = std::get<step_indices>(steps_);
+
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(step)>,
+                                       zero_lifting_step<T>>)
+            {
+              // Nothing to apply
+            }
+            else if constexpr (step_indices % 2 == 0)
+            {
+              apply_lifting_step_avx2<-1, -1, order>(
+                step, detail, n_detail, approx, n_approx, boundary_);
+            }
+            else
+            {
+              apply_lifting_step_avx2<1, 1, order>(
+                step, approx, n_approx, detail, n_detail, boundary_);
+            }
+          }(),
+          ...);
+      }
+      (std::make_index_sequence<sizeof...(Steps)>{});
 
-        return static_cast<I>(a0 * c0 + a1 * c1);
-      })
-    .update_step([](I const /*d0*/, I const d1)
-                 { return static_cast<I>(-d1); });
-}();
+      return true;
+    }
+#endif
+
+    return false;
+  }
+};
 
+// Truncates the value towards zero like static_cast, but clamps it to the
+// range of I first, since static_cast is undefined outside of it; the scaled
+// db4 steps get there on extreme samples
 template<std::integral I>
-constexpr auto bior_2_2_iwt = []
+constexpr auto
+truncate_saturate(double const value) -> I
 {
-  return lifting_wavelet_transform<I, 2u>{}
-    .update_step([](I const d0, I const d1)
-                 { return static_cast<I>(d0 / I{ 2 } + d1 / I{ 2 }); })
-    .predict_step([](I const a0, I const a1)
-                  { return static_cast<I>(a0 / I{ 4 } + a1 / I{ 4 }); });
-}();
+  using limits = std::numeric_limits<I>;
+  static_assert(limits::digits < std::numeric_limits<double>::digits,
+                "The limits of I must be exact doubles");
+
+  return static_cast<I>(std::clamp(value,
+                                   static_cast<double>(limits::min()),
+                                   static_cast<double>(limits::max())));
+}
+
+#ifdef PA171_X86_SIMD
+// Divides the 16 lanes by 2^shift, rounding towards zero like integer division
+template<int shift>
+PA171_TARGET_AVX2 auto
+div_pow2_avx2(__m256i const value) -> __m256i
+{
+  auto const bias =
+    _mm256_srli_epi16(_mm256_srai_epi16(value, 15), 16 - shift);
+  return _mm256_srai_epi16(_mm256_add_epi16(value, bias), shift);
+}
+
+// Widens the 16 lanes to doubles, four per vector
+PA171_TARGET_AVX2 inline void
+to_pd_avx2(__m256i const value, __m256d (&result)[4])
+{
+  auto const low = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(value));
+  auto const high = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(value, 1));
+
+  result[0] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(low));
+  result[1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(low, 1));
+  result[2] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(high));
+  result[3] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(high, 1));
+}
+
+// Truncates the doubles to 8 lanes like truncate_saturate<std::int16_t>
+PA171_TARGET_AVX2 inline auto
+from_pd_avx2(__m256d const low, __m256d const high) -> __m128i
+{
+  auto const min = _mm256_set1_pd(-32768.0);
+  auto const max = _mm256_set1_pd(32767.0);
 
-template<std::floating_point F>
-constexpr auto haar_wt = []
+  return _mm_packs_epi32(
+    _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(low, min), max)),
+    _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(high, min), max)));
+}
+
+PA171_TARGET_AVX2 inline auto
+from_pd_avx2(__m256d const (&value)[4]) -> __m256i
 {
-  using std::numbers::sqrt2_v;
+  return _mm256_set_m128i(from_pd_avx2(value[2], value[3]),
+                          from_pd_avx2(value[0], value[1]));
+}
+#endif
 
-  return lifting_wavelet_transform<F, 1u>{}
-    .predict_step([](F const a) { return a; })
-    .update_step([](F const d) { return static_cast<F>(d / 2); })
+// The steps of the integer wavelets; the AVX2 versions are only used for
+// int16_t
+
+template<std::integral I>
+struct haar_iwt_predict
+{
+  constexpr auto operator()(I const a) const -> I { return a; }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const a) -> __m256i { return a; }
+#endif
+};
+
+template<std::integral I>
+struct haar_iwt_update
+{
+  constexpr auto operator()(I const d) const -> I
+  {
+    return static_cast<I>(d / 2);
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const d) -> __m256i
+  {
+    return div_pow2_avx2<1>(d);
+  }
+#endif
+};
+
+template<std::integral I>
+struct db4_iwt_update_1
+{
+  constexpr auto operator()(I const d0, I const /*d1*/) const -> I
+  {
+    return truncate_saturate<I>(d0 * std::numbers::sqrt3);
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const d0, __m256i const /*d1*/)
+    -> __m256i
+  {
+    __m256d values[4];
+    to_pd_avx2(d0, values);
+    for (auto& value : values)
+    {
+      value = _mm256_mul_pd(value, _mm256_set1_pd(std::numbers::sqrt3));
+    }
+
+    return from_pd_avx2(values);
+  }
+#endif
+};
+
+template<std::integral I>
+struct db4_iwt_predict
+{
+  static constexpr auto c0 = std::numbers::sqrt3 / 4;
+  static constexpr auto c1 = (std::numbers::sqrt3 - 2) / 4;
+
+  constexpr auto operator()(I const a0, I const a1) const -> I
+  {
+    return truncate_saturate<I>(a0 * c0 + a1 * c1);
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const a0, __m256i const a1)
+    -> __m256i
+  {
+    __m256d values_0[4];
+    __m256d values_1[4];
+    to_pd_avx2(a0, values_0);
+    to_pd_avx2(a1, values_1);
+    for (auto k = 0; k < 4; ++k)
+    {
+      values_0[k] =
+        _mm256_add_pd(_mm256_mul_pd(values_0[k], _mm256_set1_pd(c0)),
+                      _mm256_mul_pd(values_1[k], _mm256_set1_pd(c1)));
+    }
+
+    return from_pd_avx2(values_0);
+  }
+#endif
+};
+
+template<std::integral I>
+struct db4_iwt_update_2
+{
+  constexpr auto operator()(I const /*d0*/, I const d1) const -> I
+  {
+    return static_cast<I>(-d1);
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const /*d0*/, __m256i const d1)
+    -> __m256i
+  {
+    return _mm256_sub_epi16(_mm256_setzero_si256(), d1);
+  }
+#endif
+};
+
+template<std::integral I>
+struct bior_2_2_iwt_update
+{
+  constexpr auto operator()(I const d0, I const d1) const -> I
+  {
+    return static_cast<I>(d0 / I{ 2 } + d1 / I{ 2 });
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const d0, __m256i const d1)
+    -> __m256i
+  {
+    return _mm256_add_epi16(div_pow2_avx2<1>(d0), div_pow2_avx2<1>(d1));
+  }
+#endif
+};
+
+template<std::integral I>
+struct bior_2_2_iwt_predict
+{
+  constexpr auto operator()(I const a0, I const a1) const -> I
+  {
+    return static_cast<I>(a0 / I{ 4 } + a1 / I{ 4 });
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 static auto avx2(__m256i const a0, __m256i const a1)
+    -> __m256i
+  {
+    return _mm256_add_epi16(div_pow2_avx2<2>(a0), div_pow2_avx2<2>(a1));
+  }
+#endif
+};
+
+// Adds the nearest sample of the other half times a coefficient, truncated
+// and saturated, for scale_iwt
+template<std::integral I>
+struct scaling_iwt_step
+{
+  double coefficient;
+
+  constexpr auto operator()(I const value, std::same_as<I> auto const...) const
+    -> I
+  {
+    return truncate_saturate<I>(value * coefficient);
+  }
+
+#ifdef PA171_X86_SIMD
+  PA171_TARGET_AVX2 auto avx2(__m256i const value,
+                              auto const... /*others*/) const
+    -> __m256i
+  {
+    __m256d values[4];
+    to_pd_avx2(value, values);
+    for (auto& v : values)
+    {
+      v = _mm256_mul_pd(v, _mm256_set1_pd(coefficient));
+    }
+
+    return from_pd_avx2(values);
+  }
+#endif
+};
+
+template<std::integral I>
+constexpr auto haar_iwt = lifting_wavelet_transform<I, 1u>{}
+                            .predict_step(haar_iwt_predict<I>{})
+                            .update_step(haar_iwt_update<I>{});
+
+template<std::integral I>
+constexpr auto db4_iwt = lifting_wavelet_transform<I, 2u>{}
+                           .update_step(db4_iwt_update_1<I>{})
+                           .predict_step(db4_iwt_predict<I>{})
+                           .update_step(db4_iwt_update_2<I>{});
+
+template<std::integral I>
+constexpr auto bior_2_2_iwt = lifting_wavelet_transform<I, 2u>{}
+                                .update_step(bior_2_2_iwt_update<I>{})
+                                .predict_step(bior_2_2_iwt_predict<I>{});
+
+template<std::floating_point F>
+constexpr auto haar_wt = []
+{
+  using std::numbers::sqrt2_v;
+
+  return lifting_wavelet_transform<F, 1u>{}
+    .predict_step([](F const a) { return a; })
+    .update_step([](F const d) { return static_cast<F>(d / 2); })
     .normalize_approx(sqrt2_v<F>)
     .normalize_detail(sqrt2_v<F> / 2);
 }();
@@ -505,6 +1486,52 @@ constexpr auto inv_haar_wt = haar_wt<F>.inverse();
 template<std::floating_point F>
 constexpr auto inv_db4_wt = db4_wt<F>.inverse();
 
+// Scales the approximation of an integer wavelet by scale and its detail by
+// its reciprocal, so that the approximation keeps the range of the input, as
+// the quantizers expect; without it, it grows with each level until it
+// overflows. Normalizing would truncate, which the inverse amplifies at each
+// level, so the scaling is four more lifting steps instead, which keep the
+// transform exactly invertible. They start with the kind of step that comes
+// next, so that no zero step is needed.
+template<std::integral I, std::size_t order, typename... Steps>
+constexpr auto
+scale_iwt(lifting_wavelet_transform<I, order, Steps...> const& wavelet,
+          double const scale)
+{
+  auto const step = [](double const coefficient)
+  { return scaling_iwt_step<I>{ coefficient }; };
+
+  if constexpr (sizeof...(Steps) % 2u == 0u)
+  {
+    return wavelet.predict_step(step(-1.0))
+      .update_step(step(scale - 1.0))
+      .predict_step(step(1.0 / scale))
+      .update_step(step(scale - scale * scale));
+  }
+  else
+  {
+    return wavelet.update_step(step(1.0))
+      .predict_step(step(1.0 - 1.0 / scale))
+      .update_step(step(-scale))
+      .predict_step(step((1.0 - scale) / (scale * scale)));
+  }
+}
+
+// The approximation of bior_2_2_iwt doubles with each 1D transform
+template<std::integral I>
+constexpr auto scaled_bior_2_2_iwt = scale_iwt(bior_2_2_iwt<I>, 0.5);
+
+// The approximation of db4_iwt grows by 1 + sqrt(3) with each 1D transform
+template<std::integral I>
+constexpr auto scaled_db4_iwt =
+  scale_iwt(db4_iwt<I>, (std::numbers::sqrt3 - 1.0) / 2.0);
+
+template<std::integral I>
+constexpr auto inv_scaled_bior_2_2_iwt = scaled_bior_2_2_iwt<I>.inverse();
+
+template<std::integral I>
+constexpr auto inv_scaled_db4_iwt = scaled_db4_iwt<I>.inverse();
+
 template<typename T>
 class recursive_2d_wavelet_transform
 {
@@ -513,64 +1540,120 @@ public:
            std::output_iterator<T> O,
            std::size_t order,
            lifting_step<T, order>... Steps>
-  auto operator()(view_2d<I> input,
-                  O result,
+  auto operator()(view_2d<I> const input,
+                  O const result,
                   lifting_wavelet_transform<T, order, Steps...> const& wavelet,
-                  std::optional<std::size_t> num_iters = std::nullopt) -> O
+                  std::optional<std::size_t> const num_iters = std::nullopt,
+                  std::size_t const num_threads = 1u) -> O
   {
-    auto width = input.width();
-    auto height = input.height();
+    auto const width = input.width();
+    auto const height = input.height();
 
     image_.resize(width * height);
     auto const matrix = view_2d{ image_.begin(), width, height };
 
     std::ranges::copy(input.rows() | ranges::views::join, image_.begin());
 
-    approx_1d_.resize(ceil_div(std::max(width, height), std::size_t{ 2 }));
-    detail_1d_.resize(std::max(width, height) / 2u);
+    transform_in_place(matrix, wavelet, num_iters, num_threads);
+    return write_subbands(matrix, result, num_iters);
+  }
+
+  // Transforms the image in place, without copying it. Each level lifts the
+  // columns with the approximation in the even rows and the detail in the
+  // odd ones, then deinterleaves and lifts each row, and finally moves the
+  // even rows to the top. The approximation thus ends up in the top left
+  // corner, with the horizontal details to its right, the vertical ones
+  // below it and the diagonal ones in the bottom right corner.
+  //
+  // With more threads, each pass over a large enough level is split across
+  // them, by strips of columns or by rows; a pass only starts once the
+  // previous one has finished, so the results do not change.
+  template<std::contiguous_iterator I,
+           std::size_t order,
+           lifting_step<T, order>... Steps>
+  requires std::same_as<std::iter_value_t<I>, T>
+  void transform_in_place(
+    view_2d<I> const image,
+    lifting_wavelet_transform<T, order, Steps...> const& wavelet,
+    std::optional<std::size_t> num_iters = std::nullopt,
+    std::size_t const num_threads = 1u)
+  {
+    auto const data = std::to_address(image.base());
+    auto const row_stride = image.row_stride();
+
+    auto width = image.width();
+    auto height = image.height();
 
-    auto const row_stride = width;
+    row_buffers_.resize(std::max(row_buffers_.size(), num_threads));
 
     while ((width > 1u or height > 1u) and (not num_iters or *num_iters > 0u))
     {
-      auto const prev_approx = matrix.block(0u, 0u, width, height);
+      auto const approx_width = ceil_div(width, std::size_t{ 2 });
+      auto const approx_height = ceil_div(height, std::size_t{ 2 });
+      auto const level_threads =
+        width * height >= parallel_min_pixels ? num_threads : 1u;
 
       if (height > 1u)
       {
-        // Compute the wavelet transform vertically (for each column)
-        for (auto const j : std::views::iota(std::size_t{ 0 }, width))
-        {
-          auto const [approx_end, detail_end] =
-            wavelet(prev_approx.col(j), approx_1d_.begin(), detail_1d_.begin());
-
-          std::ranges::copy(
-            ranges::views::concat(
-              ranges::subrange{ approx_1d_.begin(), approx_end },
-              ranges::subrange{ detail_1d_.begin(), detail_end }),
-            prev_approx.col(j).begin());
-        }
+        // Compute the wavelet transform vertically (for strips of columns)
+        parallel_for(
+          level_threads,
+          ceil_div(width, column_strip_width),
+          [&](std::size_t /*worker_index*/, std::size_t const strip)
+          {
+            auto const j = strip * column_strip_width;
+            wavelet.lift_columns(data + j,
+                                 approx_height,
+                                 data + row_stride + j,
+                                 height / 2u,
+                                 std::min(column_strip_width, width - j),
+                                 2u * row_stride);
+          });
       }
 
       if (width > 1u)
       {
-        approx_1d_.resize(ceil_div(width, std::size_t{ 2 }));
-        detail_1d_.resize(width / 2u);
-
         // Compute the wavelet transform horizontally (for each row)
-        for (auto const i : std::views::iota(std::size_t{ 0 }, height))
-        {
-          auto const [approx_end, detail_end] =
-            wavelet(prev_approx.row(i), approx_1d_.begin(), detail_1d_.begin());
-
-          std::ranges::copy(
-            ranges::views::concat(
-              ranges::subrange{ approx_1d_.begin(), approx_end },
-              ranges::subrange{ detail_1d_.begin(), detail_end }),
-            prev_approx.row(i).begin());
-        }
+        parallel_for(level_threads,
+                     height,
+                     [&](std::size_t const worker_index, std::size_t const i)
+                     {
+                       wavelet.transform_row(data + i * row_stride,
+                                             width,
+                                             row_buffers_[worker_index]);
+                     });
+      }
+
+      if (height > 1u)
+      {
+        deinterleave_rows(data, width, height, row_stride, level_threads);
       }
 
-      // Copy the detail components to output
+      width = approx_width;
+      height = approx_height;
+      if (num_iters)
+      {
+        --*num_iters;
+      }
+    }
+  }
+
+  // Writes the subbands of an image transformed in place in the order of
+  // operator(): the diagonal, horizontal and vertical details of each level,
+  // then the remaining approximation
+  template<std::random_access_iterator I, std::output_iterator<T> O>
+  static auto write_subbands(view_2d<I> const image,
+                             O result,
+                             std::optional<std::size_t> num_iters =
+                               std::nullopt) -> O
+  {
+    auto width = image.width();
+    auto height = image.height();
+
+    while ((width > 1u or height > 1u) and (not num_iters or *num_iters > 0u))
+    {
+      auto const prev_approx = image.block(0u, 0u, width, height);
+
       auto const detail_diag =
         prev_approx.block(ceil_div(width, std::size_t{ 2 }),
                           ceil_div(height, std::size_t{ 2 }),
@@ -603,7 +1686,7 @@ public:
     }
 
     // Copy the remaining approximation to output
-    auto const final_approx = matrix.block(0u, 0u, width, height);
+    auto const final_approx = image.block(0u, 0u, width, height);
     result =
       std::ranges::copy(final_approx.rows() | ranges::views::join, result).out;
 
@@ -611,11 +1694,569 @@ public:
   }
 
 private:
+  // Columns transformed together, so that each row access covers a few
+  // cache lines while the strip stays in cache for moderate heights
+  static constexpr auto column_strip_width = std::size_t{ 64 };
+
+  // Smaller levels are transformed on one thread, as starting the others
+  // would take longer
+  static constexpr auto parallel_min_pixels = std::size_t{ 1 } << 16u;
+
   std::vector<T> image_;
-  std::vector<T> approx_1d_;
-  std::vector<T> detail_1d_;
+  // A row buffer per worker thread
+  std::vector<std::vector<T>> row_buffers_;
+  std::vector<bool> moved_rows_;
+  std::vector<std::size_t> cycle_firsts_;
+
+  // Moves the even rows of the block to its top and the odd ones below
+  // them, following the cycles of the permutation with a row of buffer.
+  // With more threads, each moves its own part of the rows.
+  void deinterleave_rows(T* const data,
+                         std::size_t const width,
+                         std::size_t const height,
+                         std::size_t const row_stride,
+                         std::size_t const num_threads)
+  {
+    auto const n_even = ceil_div(height, std::size_t{ 2 });
+
+    // The row that ends up at position i
+    auto const source = [&](std::size_t const i)
+    { return i < n_even ? 2u * i : 2u * (i - n_even) + 1u; };
+
+    auto const row = [&](std::size_t const i) { return data + i * row_stride; };
+
+    moved_rows_.assign(height, false);
+    cycle_firsts_.clear();
+
+    for (auto const first : std::views::iota(std::size_t{ 0 }, height))
+    {
+      if (moved_rows_[first] or source(first) == first)
+      {
+        continue;
+      }
+
+      cycle_firsts_.push_back(first);
+      for (auto i = first; not moved_rows_[i]; i = source(i))
+      {
+        moved_rows_[i] = true;
+      }
+    }
+
+    auto const part_width =
+      std::max(ceil_div(width, num_threads), std::size_t{ 1 });
+
+    parallel_for(
+      num_threads,
+      ceil_div(width, part_width),
+      [&](std::size_t const worker_index, std::size_t const part)
+      {
+        auto const j = part * part_width;
+        auto const size = std::min(part_width, width - j);
+        auto& buffer = row_buffers_[worker_index];
+        buffer.resize(size);
+
+        for (auto const first : cycle_firsts_)
+        {
+          std::copy_n(row(first) + j, size, buffer.begin());
+
+          for (auto i = first;;)
+          {
+            auto const next = source(i);
+            if (next == first)
+            {
+              std::ranges::copy(buffer, row(i) + j);
+              break;
+            }
+
+            std::copy_n(row(next) + j, size, row(i) + j);
+            i = next;
+          }
+        }
+      });
+  }
 };
 
+// Passes each row of the subbands of an image in the layout of
+// transform_in_place of recursive_2d_wavelet_transform (or about to be
+// inverted by that of inv_recursive_2d_wavelet_transform) to function as a
+// run given by level, column and row, like the sink of
+// streaming_2d_wavelet_transform, so that they can be quantized straight
+// from the image, or dequantized straight into it, rather than copied
+// through the order of write_subbands. The runs are mutable for mutable
+// images.
+template<std::contiguous_iterator I, typename Function>
+void
+for_each_subband_run(view_2d<I> const image,
+                     std::optional<std::size_t> num_iters,
+                     Function&& function)
+{
+  using value_type = std::remove_reference_t<std::iter_reference_t<I>>;
+
+  auto const data = std::to_address(image.base());
+  auto const row_stride = image.row_stride();
+
+  auto const run = [&](std::size_t const level,
+                       std::size_t const x,
+                       std::size_t const y,
+                       std::size_t const size)
+  {
+    if (size > 0u)
+    {
+      function(level,
+               x,
+               y,
+               std::span<value_type>{ data + y * row_stride + x, size });
+    }
+  };
+
+  auto width = image.width();
+  auto height = image.height();
+  auto level = std::size_t{ 0 };
+
+  while ((width > 1u or height > 1u) and (not num_iters or *num_iters > 0u))
+  {
+    auto const approx_width = ceil_div(width, std::size_t{ 2 });
+    auto const approx_height = ceil_div(height, std::size_t{ 2 });
+
+    // The horizontal details right of the approximation, then the rows of
+    // vertical and diagonal details below it
+    for (auto y = std::size_t{ 0 }; y < approx_height; ++y)
+    {
+      run(level, approx_width, y, width - approx_width);
+    }
+
+    for (auto y = approx_height; y < height; ++y)
+    {
+      run(level, 0u, y, width);
+    }
+
+    width = approx_width;
+    height = approx_height;
+    ++level;
+    if (num_iters)
+    {
+      --*num_iters;
+    }
+  }
+
+  for (auto y = std::size_t{ 0 }; y < height; ++y)
+  {
+    run(level, 0u, y, width);
+  }
+}
+
+// Transforms an image given a row at a time into the layout of
+// transform_in_place of recursive_2d_wavelet_transform, passing each run of
+// results to the sink as soon as it is final. The columns of a level are
+// lifted a pair of rows at a time, each pair taking a step once its
+// neighbours have taken the previous ones. As the columns wrap around, the
+// first pairs of a level wait for its last ones, so the rows kept grow with
+// the width, the support of the wavelet and the number of levels, but not
+// with the height.
+template<typename T, std::size_t order, lifting_step<T, order>... Steps>
+class streaming_2d_wavelet_transform
+{
+public:
+  using wavelet_type = lifting_wavelet_transform<T, order, Steps...>;
+
+  // Called with the level, the column and row of the first value in the
+  // layout of the whole image, and the values. The remaining approximation
+  // comes with the number of levels as its level.
+  using sink_type = std::function<
+    void(std::size_t, std::size_t, std::size_t, std::span<T const>)>;
+
+  streaming_2d_wavelet_transform(wavelet_type const& wavelet,
+                                 std::size_t width,
+                                 std::size_t height,
+                                 std::optional<std::size_t> num_iters,
+                                 sink_type sink)
+    : wavelet_{ wavelet }
+    , sink_{ std::move(sink) }
+    , width_{ width }
+    , height_{ height }
+  {
+    while ((width > 1u or height > 1u) and (not num_iters or *num_iters > 0u))
+    {
+      auto& added = levels_.emplace_back();
+      added.width = width;
+      added.height = height;
+      added.n_approx = ceil_div(height, std::size_t{ 2 });
+      added.n_detail = height / 2u;
+      added.finished.assign(added.n_approx, false);
+
+      width = ceil_div(width, std::size_t{ 2 });
+      height = ceil_div(height, std::size_t{ 2 });
+      if (num_iters)
+      {
+        --*num_iters;
+      }
+    }
+  }
+
+  [[nodiscard]] auto num_levels() const noexcept -> std::size_t
+  {
+    return levels_.size();
+  }
+
+  // Transforms the next row of the image, converting its values to T
+  template<std::ranges::input_range R>
+  void push_row(R&& row)
+  {
+    assert(next_row_ < height_);
+
+    auto values = take_row(width_);
+    std::ranges::transform(row,
+                           values.begin(),
+                           [](auto const value)
+                           { return static_cast<T>(value); });
+
+    add_row(0u, next_row_++, std::move(values));
+  }
+
+private:
+  static constexpr auto zero_steps = std::array<bool, sizeof...(Steps)>{
+    std::same_as<Steps, zero_lifting_step<T>>...,
+  };
+
+  struct row_pair
+  {
+    std::vector<T> approx;
+    std::vector<T> detail;
+    std::size_t num_rows = 0;
+    std::size_t num_steps = 0;
+  };
+
+  struct level
+  {
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t n_approx = 0;
+    std::size_t n_detail = 0;
+    // The pairs received and still read by some pair, by index
+    std::map<std::size_t, row_pair> pairs;
+    std::vector<bool> finished;
+    // Pairs that may be able to take a step
+    std::vector<std::size_t> pending;
+  };
+
+  wavelet_type wavelet_;
+  sink_type sink_;
+  std::size_t width_;
+  std::size_t height_;
+  std::size_t next_row_ = 0;
+  std::vector<level> levels_;
+  std::vector<T> output_row_;
+  std::vector<T> row_buffer_;
+  std::vector<std::vector<T>> free_rows_;
+
+  auto take_row(std::size_t const width) -> std::vector<T>
+  {
+    auto result = std::vector<T>{};
+    if (not free_rows_.empty())
+    {
+      result = std::move(free_rows_.back());
+      free_rows_.pop_back();
+    }
+
+    result.resize(width);
+    return result;
+  }
+
+  // Adds row y of the input of a level
+  void add_row(std::size_t const level_index,
+               std::size_t const y,
+               std::vector<T> values)
+  {
+    if (level_index == levels_.size())
+    {
+      sink_(level_index, 0u, y, values);
+      free_rows_.push_back(std::move(values));
+      return;
+    }
+
+    auto& current = levels_[level_index];
+
+    if (current.height == 1u)
+    {
+      output_row_.assign(values.begin(), values.end());
+      free_rows_.push_back(std::move(values));
+      output(level_index, y);
+      return;
+    }
+
+    auto const i = y / 2u;
+    auto& pair = current.pairs[i];
+    (y % 2u == 0u ? pair.approx : pair.detail) = std::move(values);
+    ++pair.num_rows;
+
+    if (is_complete(current, i, pair))
+    {
+      // Rows of the next levels come out of order, so pairs before this
+      // one may be waiting for it too
+      current.pending.push_back(i);
+      for_each_neighbour(current,
+                         i,
+                         [&](std::size_t const j)
+                         { current.pending.push_back(j); });
+      run(level_index);
+    }
+  }
+
+  static auto is_complete(level const& current,
+                          std::size_t const i,
+                          row_pair const& pair) -> bool
+  {
+    return pair.num_rows == (i < current.n_detail ? 2u : 1u);
+  }
+
+  // Calls f for each pair that pair i reads or that reads it, in any step
+  void for_each_neighbour(level const& current,
+                          std::size_t const i,
+                          std::invocable<std::size_t> auto&& f) const
+  {
+    auto const boundary = wavelet_.boundary();
+    auto const index = static_cast<std::ptrdiff_t>(i);
+    auto const n_approx = static_cast<std::ptrdiff_t>(current.n_approx);
+    auto const n_detail = static_cast<std::ptrdiff_t>(current.n_detail);
+
+    // With an odd height, the details are mirrored about a point past their
+    // last row, so that pairs up to order rows away read each other
+    auto const reach = static_cast<std::ptrdiff_t>(
+      boundary == boundary_extension::periodic ? order - 1u : order);
+
+    for (auto const k : std::views::iota(std::ptrdiff_t{ 0 }, reach + 1))
+    {
+      for (auto const j : { index - k, index + k })
+      {
+        f(static_cast<std::size_t>(
+          boundary_index<-1>(boundary, j, n_approx, n_detail)));
+        f(static_cast<std::size_t>(
+          boundary_index<1>(boundary, j, n_detail, n_approx)));
+      }
+    }
+
+    // With an odd height, the last approximation reads the first details
+    // around the periodic boundary
+    if (boundary == boundary_extension::periodic and
+        current.n_approx != current.n_detail and i < order)
+    {
+      f(current.n_approx - 1u);
+    }
+  }
+
+  // Whether pair j has taken the steps before step_index
+  static auto is_ready(level const& current,
+                       std::size_t const j,
+                       std::size_t const step_index) -> bool
+  {
+    if (current.finished[j])
+    {
+      return true;
+    }
+
+    auto const found = current.pairs.find(j);
+    return found != current.pairs.end() and
+           is_complete(current, j, found->second) and
+           found->second.num_steps >= step_index;
+  }
+
+  // Whether pair i can take step step_index: all pairs it reads, and all
+  // that read it, must have taken the previous steps. Checking the pairs
+  // that read it matters with an odd height, where the last approximation
+  // reads the first details but is not read by them.
+  auto can_step(level const& current,
+                std::size_t const i,
+                std::size_t const step_index) const -> bool
+  {
+    auto result = true;
+    for_each_neighbour(current,
+                       i,
+                       [&](std::size_t const j)
+                       {
+                         result = result and
+                                  (j == i or is_ready(current, j, step_index));
+                       });
+
+    return result;
+  }
+
+  // Returns the rows that step step_index of pair i reads
+  auto sources(level const& current,
+               std::size_t const i,
+               std::size_t const step_index) const
+    -> std::array<T const*, order>
+  {
+    auto const boundary = wavelet_.boundary();
+    auto const index = static_cast<std::ptrdiff_t>(i);
+    auto const n_approx = static_cast<std::ptrdiff_t>(current.n_approx);
+    auto const n_detail = static_cast<std::ptrdiff_t>(current.n_detail);
+    auto const is_predict = step_index % 2u == 0u;
+    auto result = std::array<T const*, order>{};
+
+    for (auto const k : std::views::iota(std::size_t{ 0 }, order))
+    {
+      auto const offset = static_cast<std::ptrdiff_t>(k);
+      auto const j = static_cast<std::size_t>(
+        is_predict
+          ? boundary_index<-1>(boundary, index - offset, n_approx, n_detail)
+          : boundary_index<1>(boundary, index + offset, n_detail, n_approx));
+
+      auto const& pair = current.pairs.at(j);
+      result[k] = (is_predict ? pair.approx : pair.detail).data();
+    }
+
+    return result;
+  }
+
+  // Lets the pending pairs of a level take the steps they can
+  void run(std::size_t const level_index)
+  {
+    auto& current = levels_[level_index];
+
+    while (not current.pending.empty())
+    {
+      auto const i = current.pending.back();
+      current.pending.pop_back();
+
+      auto const found = current.pairs.find(i);
+      if (current.finished[i] or found == current.pairs.end() or
+          not is_complete(current, i, found->second))
+      {
+        continue;
+      }
+
+      auto& pair = found->second;
+      auto const first_step = pair.num_steps;
+
+      for (; pair.num_steps < sizeof...(Steps); ++pair.num_steps)
+      {
+        auto const step_index = pair.num_steps;
+        auto const is_predict = step_index % 2u == 0u;
+
+        // The last approximation of an odd height has no detail to predict
+        if (zero_steps[step_index] or (is_predict and i >= current.n_detail))
+        {
+          continue;
+        }
+
+        if (not can_step(current, i, step_index))
+        {
+          break;
+        }
+
+        wavelet_.lift_row(step_index,
+                          (is_predict ? pair.detail : pair.approx).data(),
+                          sources(current, i, step_index),
+                          current.width);
+      }
+
+      if (pair.num_steps == first_step)
+      {
+        continue;
+      }
+
+      for_each_neighbour(current,
+                         i,
+                         [&](std::size_t const j)
+                         { current.pending.push_back(j); });
+
+      if (pair.num_steps == sizeof...(Steps))
+      {
+        finish(level_index, i);
+      }
+    }
+  }
+
+  // Outputs a pair that took all steps, then drops the pairs no longer read
+  void finish(std::size_t const level_index, std::size_t const i)
+  {
+    auto& current = levels_[level_index];
+    current.finished[i] = true;
+
+    // Pairs that have not finished may still read the rows, so they are
+    // normalized and transformed horizontally as a copy
+    auto const& pair = current.pairs.at(i);
+    auto const has_detail = i < current.n_detail;
+
+    output_row_.assign(pair.approx.begin(), pair.approx.end());
+    wavelet_.normalize_row(output_row_.data(), current.width, false);
+    output(level_index, i);
+
+    if (has_detail)
+    {
+      auto const& detail = current.pairs.at(i).detail;
+      output_row_.assign(detail.begin(), detail.end());
+      wavelet_.normalize_row(output_row_.data(), current.width, true);
+      output(level_index, current.n_approx + i);
+    }
+
+    auto const drop_if_unread = [&](std::size_t const j)
+    {
+      auto const found = current.pairs.find(j);
+      if (not current.finished[j] or found == current.pairs.end())
+      {
+        return;
+      }
+
+      auto is_read = false;
+      for_each_neighbour(current,
+                         j,
+                         [&](std::size_t const k)
+                         { is_read = is_read or not current.finished[k]; });
+
+      if (not is_read)
+      {
+        free_rows_.push_back(std::move(found->second.approx));
+        free_rows_.push_back(std::move(found->second.detail));
+        current.pairs.erase(found);
+      }
+    };
+
+    drop_if_unread(i);
+    for_each_neighbour(current, i, drop_if_unread);
+  }
+
+  // Transforms output_row_, row y of a level after its columns were lifted,
+  // horizontally; passes the details to the sink and the approximation on
+  // to the next level
+  void output(std::size_t const level_index, std::size_t const y)
+  {
+    auto const& current = levels_[level_index];
+    auto const width = current.width;
+    auto const approx_width = ceil_div(width, std::size_t{ 2 });
+    auto const row = std::span<T const>{ output_row_ }.first(width);
+
+    if (width > 1u)
+    {
+      wavelet_.transform_row(output_row_.data(), width, row_buffer_);
+    }
+
+    if (y >= ceil_div(current.height, std::size_t{ 2 }))
+    {
+      sink_(level_index, 0u, y, row);
+      return;
+    }
+
+    if (approx_width < width)
+    {
+      sink_(level_index, approx_width, y, row.subspan(approx_width));
+    }
+
+    // The next level may output rows of its own into output_row_
+    auto approx = take_row(approx_width);
+    std::ranges::copy(row.first(approx_width), approx.begin());
+    add_row(level_index + 1u, y, std::move(approx));
+  }
+};
+
+template<typename T, std::size_t order, typename... Steps, typename Sink>
+streaming_2d_wavelet_transform(
+  lifting_wavelet_transform<T, order, Steps...> const&,
+  std::size_t,
+  std::size_t,
+  std::optional<std::size_t>,
+  Sink) -> streaming_2d_wavelet_transform<T, order, Steps...>;
+
 template<typename T>
 class inv_recursive_2d_wavelet_transform
 {
@@ -629,14 +2270,16 @@ public:
                   view_2d<O> const result,
                   inverse_lifting_wavelet_transform<T, order, Steps...> const&
                     inverse_wavelet,
-                  std::optional<std::size_t> const num_iters = std::nullopt)
+                  std::optional<std::size_t> const num_iters = std::nullopt,
+                  std::size_t const num_threads = 1u)
     -> std::ranges::iterator_t<R>
   {
     return (*this)(std::ranges::begin(range),
                    std::ranges::end(range),
                    result,
                    inverse_wavelet,
-                   num_iters);
+                   num_iters,
+                   num_threads);
   }
 
   template<std::input_iterator I,
@@ -650,15 +2293,76 @@ public:
                   view_2d<O> const result,
                   inverse_lifting_wavelet_transform<T, order, Steps...> const&
                     inverse_wavelet,
-                  std::optional<std::size_t> const num_iters = std::nullopt)
-    -> I
+                  std::optional<std::size_t> const num_iters = std::nullopt,
+                  std::size_t const num_threads = 1u) -> I
   {
-    buffer_1d_.resize(std::max(result.width(), result.height()));
-    return backtrack(first, last, result, inverse_wavelet, num_iters);
+    workers_.resize(std::max(workers_.size(), num_threads));
+    for (auto& worker : workers_)
+    {
+      worker.buffer_1d.resize(std::max(result.width(), result.height()));
+    }
+
+    return backtrack(
+      first, last, result, inverse_wavelet, num_iters, num_threads);
+  }
+
+  // Inverts an image holding its subbands in the layout of
+  // transform_in_place of recursive_2d_wavelet_transform, without copying
+  // them in from the order of operator()
+  template<std::contiguous_iterator I,
+           std::size_t order,
+           lifting_step<T, order>... Steps>
+  requires std::same_as<std::iter_value_t<I>, T>
+  void transform_in_place(
+    view_2d<I> const image,
+    inverse_lifting_wavelet_transform<T, order, Steps...> const&
+      inverse_wavelet,
+    std::optional<std::size_t> const num_iters = std::nullopt,
+    std::size_t const num_threads = 1u)
+  {
+    workers_.resize(std::max(workers_.size(), num_threads));
+    for (auto& worker : workers_)
+    {
+      worker.buffer_1d.resize(std::max(image.width(), image.height()));
+    }
+
+    lift_in_place(image, inverse_wavelet, num_iters, num_threads);
   }
 
 private:
-  std::vector<T> buffer_1d_;
+  // Columns transformed together, as in recursive_2d_wavelet_transform
+  static constexpr auto column_strip_width = std::size_t{ 64 };
+
+  // Smaller levels are transformed on one thread, as in
+  // recursive_2d_wavelet_transform
+  static constexpr auto parallel_min_pixels = std::size_t{ 1 } << 16u;
+
+  // The buffers of a worker thread
+  struct worker_buffers
+  {
+    // Holds the even samples of a 1D inverse transform, then the odd ones,
+    // so that the lifting steps run on contiguous data
+    std::vector<T> buffer_1d;
+    std::vector<T> strip_buffer;
+  };
+
+  std::vector<worker_buffers> workers_;
+
+  // Interleaves the n_even even samples in buffer_1d and the odd ones after
+  // them into output
+  template<std::ranges::random_access_range R>
+  static void interleave(std::vector<T> const& buffer_1d,
+                         std::size_t const n_even,
+                         R&& output)
+  {
+    auto const result = std::ranges::begin(output);
+    auto const n = std::ranges::distance(output);
+
+    for (auto const k : std::views::iota(decltype(n){ 0 }, n))
+    {
+      result[k] = buffer_1d[k % 2 == 0 ? k / 2 : n_even + k / 2];
+    }
+  }
 
   template<std::input_iterator I,
            std::sentinel_for<I> S,
@@ -671,7 +2375,8 @@ private:
                  view_2d<O> const image,
                  inverse_lifting_wavelet_transform<T, order, Steps...> const&
                    inverse_wavelet,
-                 std::optional<std::size_t> num_iters) -> I
+                 std::optional<std::size_t> num_iters,
+                 std::size_t const num_threads) -> I
   {
     auto const width = image.width();
     auto const height = image.height();
@@ -721,33 +2426,97 @@ private:
                       last,
                       image.block(0u, 0u, prev_width, prev_height),
                       inverse_wavelet,
-                      num_iters);
+                      num_iters,
+                      num_threads);
+
+    lift_level(image, inverse_wavelet, num_threads);
+
+    return first;
+  }
+
+  template<std::random_access_iterator O,
+           std::size_t order,
+           lifting_step<T, order>... Steps>
+  void lift_in_place(
+    view_2d<O> const image,
+    inverse_lifting_wavelet_transform<T, order, Steps...> const&
+      inverse_wavelet,
+    std::optional<std::size_t> num_iters,
+    std::size_t const num_threads)
+  {
+    auto const width = image.width();
+    auto const height = image.height();
+
+    if ((width <= 1u and height <= 1u) or (num_iters and *num_iters == 0u))
+    {
+      return;
+    }
+
+    if (num_iters)
+    {
+      --*num_iters;
+    }
+    lift_in_place(image.block(0u,
+                              0u,
+                              ceil_div(width, std::size_t{ 2 }),
+                              ceil_div(height, std::size_t{ 2 })),
+                  inverse_wavelet,
+                  num_iters,
+                  num_threads);
+
+    lift_level(image, inverse_wavelet, num_threads);
+  }
+
+  // Inverts one level, whose approximation has been restored in its top
+  // left corner
+  template<std::random_access_iterator O,
+           std::size_t order,
+           lifting_step<T, order>... Steps>
+  void lift_level(view_2d<O> const image,
+                  inverse_lifting_wavelet_transform<T, order, Steps...> const&
+                    inverse_wavelet,
+                  std::size_t const num_threads)
+  {
+    auto const width = image.width();
+    auto const height = image.height();
+    auto const prev_width = ceil_div(width, std::size_t{ 2 });
+
+    auto const level_threads =
+      width * height >= parallel_min_pixels ? num_threads : 1u;
 
     if (width > 1u)
     {
       // Compute the inverse wavelet transform horizontally
-      for (auto const i : std::views::iota(std::size_t{ 0 }, height))
-      {
-        inverse_wavelet(image.row(i) | ranges::views::take(prev_width),
-                        image.row(i) | ranges::views::drop(prev_width),
-                        buffer_1d_.begin());
-        std::ranges::copy_n(buffer_1d_.begin(), width, image.row(i).begin());
-      }
+      parallel_for(level_threads,
+                   height,
+                   [&](std::size_t const worker_index, std::size_t const i)
+                   {
+                     auto& buffer_1d = workers_[worker_index].buffer_1d;
+                     inverse_wavelet(
+                       image.row(i) | ranges::views::take(prev_width),
+                       image.row(i) | ranges::views::drop(prev_width),
+                       buffer_1d.begin(),
+                       buffer_1d.begin() + prev_width);
+                     interleave(buffer_1d, prev_width, image.row(i));
+                   });
     }
 
     if (height > 1u)
     {
-      // Compute the inverse wavelet transform vertically
-      for (auto const j : std::views::iota(std::size_t{ 0 }, width))
-      {
-        inverse_wavelet(image.col(j) | ranges::views::take(prev_height),
-                        image.col(j) | ranges::views::drop(prev_height),
-                        buffer_1d_.begin());
-        std::ranges::copy_n(buffer_1d_.begin(), height, image.col(j).begin());
-      }
+      // Compute the inverse wavelet transform vertically (for strips of
+      // columns)
+      parallel_for(
+        level_threads,
+        ceil_div(width, column_strip_width),
+        [&](std::size_t const worker_index, std::size_t const strip)
+        {
+          auto const j = strip * column_strip_width;
+          inverse_wavelet.transform_columns(
+            image.block(
+              j, 0u, std::min(column_strip_width, width - j), height),
+            workers_[worker_index].strip_buffer);
+        });
     }
-
-    return first;
   }
 };
 
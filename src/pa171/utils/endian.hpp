@@ -0,0 +1,50 @@
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+
+namespace pa171
+{
+
+template<std::unsigned_integral T>
+[[nodiscard]] inline auto
+load_le(std::byte const* const source) noexcept -> T
+{
+  if constexpr (std::endian::native == std::endian::little)
+  {
+    auto value = T{};
+    std::memcpy(&value, source, sizeof(T));
+    return value;
+  }
+  else
+  {
+    auto value = T{};
+    for (auto i = sizeof(T); i > 0u; --i)
+    {
+      value =
+        static_cast<T>((value << 8u) | std::to_integer<T>(source[i - 1u]));
+    }
+    return value;
+  }
+}
+
+template<std::unsigned_integral T>
+inline void
+store_le(std::byte* const destination, T const value) noexcept
+{
+  if constexpr (std::endian::native == std::endian::little)
+  {
+    std::memcpy(destination, &value, sizeof(T));
+  }
+  else
+  {
+    for (auto i = std::size_t{ 0 }; i < sizeof(T); ++i)
+    {
+      destination[i] = static_cast<std::byte>(value >> (8u * i));
+    }
+  }
+}
+
+} // namespace pa171
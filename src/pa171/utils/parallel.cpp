@@ -0,0 +1 @@
+#include <pa171/utils/parallel.hpp>
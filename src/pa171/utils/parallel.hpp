@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pa171
+{
+
+[[nodiscard]] inline auto
+default_num_threads() noexcept -> std::size_t
+{
+  return std::max(std::size_t{ 1 },
+                  static_cast<std::size_t>(std::thread::hardware_concurrency()));
+}
+
+// Calls function(worker_index, index) for each index in [0, count), spread
+// over at most num_threads threads (including the calling one). The first
+// exception thrown by any call is rethrown once all workers have finished.
+template<std::invocable<std::size_t, std::size_t> F>
+void
+parallel_for(std::size_t const num_threads,
+             std::size_t const count,
+             F&& function)
+{
+  auto const num_workers = std::min(num_threads, count);
+
+  if (num_workers <= 1u)
+  {
+    for (auto i = std::size_t{ 0 }; i < count; ++i)
+    {
+      function(std::size_t{ 0 }, i);
+    }
+
+    return;
+  }
+
+  auto next_index = std::atomic<std::size_t>{ 0 };
+  auto error = std::exception_ptr{};
+  auto error_mutex = std::mutex{};
+
+  auto const work = [&](std::size_t const worker_index)
+  {
+    try
+    {
+      for (auto i = next_index++; i < count; i = next_index++)
+      {
+        function(worker_index, i);
+      }
+    }
+    catch (...)
+    {
+      auto const lock = std::scoped_lock{ error_mutex };
+      if (not error)
+      {
+        error = std::current_exception();
+      }
+      next_index = count;
+    }
+  };
+
+  {
+    auto workers = std::vector<std::jthread>{};
+    workers.reserve(num_workers - 1u);
+
+    for (auto worker_index = std::size_t{ 1 }; worker_index < num_workers;
+         ++worker_index)
+    {
+      workers.emplace_back(work, worker_index);
+    }
+
+    work(std::size_t{ 0 });
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace pa171
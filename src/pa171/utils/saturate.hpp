@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include <pa171/utils/simd.hpp>
+
+namespace pa171
+{
+
+#ifdef PA171_X86_SIMD
+// The AVX2 kernel of saturate_to_bytes: narrows the longest prefix of whole
+// vectors, returning its length
+PA171_TARGET_AVX2 inline auto
+saturate_to_bytes_avx2(std::span<std::int16_t const> const input,
+                       std::uint8_t* const output) -> std::size_t
+{
+  constexpr auto vector_size = std::size_t{ 32 };
+
+  auto i = std::size_t{ 0 };
+  for (; i + vector_size <= input.size(); i += vector_size)
+  {
+    auto const low =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(input.data() + i));
+    auto const high = _mm256_loadu_si256(
+      reinterpret_cast<__m256i const*>(input.data() + i + vector_size / 2u));
+
+    // The pack works within 128-bit lanes, leaving the quadwords in the
+    // order low 0, high 0, low 1, high 1
+    auto const packed = _mm256_permute4x64_epi64(
+      _mm256_packus_epi16(low, high), 0b11'01'10'00);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+  }
+
+  return i;
+}
+
+// The SSE2 kernel of saturate_to_bytes, for what is left to the AVX2 one
+PA171_TARGET_SSE2 inline auto
+saturate_to_bytes_sse2(std::span<std::int16_t const> const input,
+                       std::uint8_t* const output) -> std::size_t
+{
+  constexpr auto vector_size = std::size_t{ 16 };
+
+  auto i = std::size_t{ 0 };
+  for (; i + vector_size <= input.size(); i += vector_size)
+  {
+    auto const low =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(input.data() + i));
+    auto const high = _mm_loadu_si128(
+      reinterpret_cast<__m128i const*>(input.data() + i + vector_size / 2u));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                     _mm_packus_epi16(low, high));
+  }
+
+  return i;
+}
+#endif
+
+// Converts the values to bytes, clamping them to 0..255
+inline void
+saturate_to_bytes(std::span<std::int16_t const> const input,
+                  std::uint8_t* const output,
+                  bool const allow_simd = true)
+{
+  auto i = std::size_t{ 0 };
+
+#ifdef PA171_X86_SIMD
+  if (allow_simd and has_avx2())
+  {
+    i = saturate_to_bytes_avx2(input, output);
+  }
+
+  if (allow_simd and has_sse2())
+  {
+    i += saturate_to_bytes_sse2(input.subspan(i), output + i);
+  }
+#endif
+
+  for (; i < input.size(); ++i)
+  {
+    output[i] = static_cast<std::uint8_t>(
+      std::clamp(input[i],
+                 std::int16_t{ std::numeric_limits<std::uint8_t>::min() },
+                 std::int16_t{ std::numeric_limits<std::uint8_t>::max() }));
+  }
+}
+
+} // namespace pa171
@@ -0,0 +1,39 @@
+#pragma once
+
+// SIMD kernels are compiled for their instruction set with function target
+// attributes and selected at run time, so the library itself needs no
+// special compiler flags. Only x86 with GCC or Clang is covered for now;
+// elsewhere the scalar paths are used.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PA171_X86_SIMD 1
+#include <immintrin.h>
+#define PA171_TARGET_SSE2 [[gnu::target("sse2")]]
+#define PA171_TARGET_AVX2 [[gnu::target("avx2")]]
+#endif
+
+namespace pa171
+{
+
+[[nodiscard]] inline auto
+has_sse2() noexcept -> bool
+{
+#ifdef PA171_X86_SIMD
+  static auto const supported = __builtin_cpu_supports("sse2") != 0;
+  return supported;
+#else
+  return false;
+#endif
+}
+
+[[nodiscard]] inline auto
+has_avx2() noexcept -> bool
+{
+#ifdef PA171_X86_SIMD
+  static auto const supported = __builtin_cpu_supports("avx2") != 0;
+  return supported;
+#else
+  return false;
+#endif
+}
+
+} // namespace pa171
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/bitpack_decoder.hpp>
+#include <pa171/coding/bitpack_encoder.hpp>
+#include <pa171/quantization/subband.hpp>
+
+namespace bitpack = pa171::coding::bitpack;
+
+using pa171::quantization::subband;
+using pa171::quantization::subband_kind;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("Bit packing encode / decode")
+{
+    // Odd sizes leave partial blocks at the end of the signed subbands and of
+    // the samples
+    auto const subbands = std::vector<subband>{
+        { subband_kind::diagonal, 0u, 17u, 11u },
+        { subband_kind::horizontal, 0u, 17u, 12u },
+        { subband_kind::vertical, 0u, 18u, 11u },
+        { subband_kind::approximation, 0u, 18u, 12u },
+        { subband_kind::samples, 0u, 33u, 7u },
+    };
+
+    auto size = std::size_t{ 0 };
+    for (auto const& band : subbands)
+    {
+        size += band.size();
+    }
+
+    for (auto const magnitude : { 0u, 1u, 3u, 40u, 256u })
+    {
+        auto input = std::vector<std::byte>{};
+        for (auto const r : random_samples(size, std::max(magnitude, 1u)))
+        {
+            input.push_back(
+                static_cast<std::byte>(r % 2u == 0u ? r / 2u : 0u - r / 2u));
+        }
+
+        for (auto const layout :
+             { std::span<subband const>{}, std::span{ subbands } })
+        {
+            auto encoded = std::vector<std::byte>{};
+            bitpack::encoder{}(input, layout, encoded);
+
+            auto scalar_encoded = std::vector<std::byte>{};
+            bitpack::encoder{ false }(input, layout, scalar_encoded);
+            REQUIRE(scalar_encoded == encoded);
+
+            for (auto const allow_simd : { true, false })
+            {
+                auto decoded = std::vector<std::byte>(size);
+                REQUIRE(bitpack::decoder{ allow_simd }(
+                            encoded, layout, decoded) == size);
+                REQUIRE(decoded == input);
+            }
+
+            auto decoded = std::vector<std::byte>(size);
+            encoded.pop_back();
+            REQUIRE_THROWS_AS(bitpack::decoder{}(encoded, layout, decoded),
+                              bitpack::decode_error);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/bitplane_decoder.hpp>
+#include <pa171/coding/bitplane_encoder.hpp>
+#include <pa171/quantization/haar_iwt.hpp>
+
+namespace bitplane = pa171::coding::bitplane;
+namespace quantization = pa171::quantization;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+// Mostly small values, with a few large ones
+auto
+make_values(std::size_t const size) -> std::vector<std::byte>
+{
+    auto values = std::vector<std::byte>{};
+    for (auto const r : random_samples(size, 256u))
+    {
+        values.push_back(static_cast<std::byte>(r < 224u ? r % 7u - 3u : r));
+    }
+
+    return values;
+}
+
+auto
+sum_of_errors(std::span<std::byte const> const a,
+              std::span<std::byte const> const b) -> long
+{
+    auto sum = 0l;
+    for (auto i = std::size_t{ 0 }; i < a.size(); ++i)
+    {
+        sum += std::abs(static_cast<std::int8_t>(a[i]) -
+                        static_cast<std::int8_t>(b[i]));
+    }
+
+    return sum;
+}
+
+} // namespace
+
+TEST_CASE("Bit plane encode / decode")
+{
+    using quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+
+    for (auto const& [width, height, levels] :
+         { std::tuple{ 1u, 1u, std::optional<std::size_t>{} },
+           std::tuple{ 32u, 32u, std::optional<std::size_t>{} },
+           std::tuple{ 37u, 5u, std::optional<std::size_t>{} },
+           std::tuple{ 19u, 1u, std::optional<std::size_t>{ 0u } } })
+    {
+        // Two regions with the same layout
+        auto subbands = std::vector<quantization::subband>{};
+        quantizer::subbands(width, height, levels, subbands);
+        quantizer::subbands(width, height, levels, subbands);
+
+        auto const input = make_values(2u * width * height);
+
+        auto encoded = std::vector<std::byte>{};
+        bitplane::encoder{}(input, subbands, encoded);
+
+        auto decoded = std::vector<std::byte>(input.size());
+        REQUIRE(bitplane::decoder{}(encoded, subbands, decoded) ==
+                input.size());
+        REQUIRE(decoded == input);
+
+        // Longer prefixes decode closer to the input
+        auto previous_errors = sum_of_errors(
+            input, std::vector<std::byte>(input.size()));
+
+        for (auto const fraction : { 0.25, 0.5, 0.75 })
+        {
+            auto const prefix = std::span{ encoded }.first(
+                static_cast<std::size_t>(fraction * encoded.size()));
+            REQUIRE(bitplane::decoder{}(prefix, subbands, decoded) ==
+                    input.size());
+
+            auto const errors = sum_of_errors(input, decoded);
+            REQUIRE(errors <= previous_errors);
+            previous_errors = errors;
+        }
+
+        auto const other_subbands = std::span{ subbands }.first(1u);
+        REQUIRE_THROWS_AS(
+            bitplane::decoder{}(encoded, other_subbands, decoded),
+            bitplane::decode_error);
+    }
+}
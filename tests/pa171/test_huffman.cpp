@@ -0,0 +1,91 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/huffman_decoder.hpp>
+#include <pa171/coding/huffman_encoder.hpp>
+
+namespace huffman = pa171::coding::huffman;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("Huffman code lengths are limited")
+{
+    // Fibonacci counts make a maximally deep tree
+    auto counts = std::array<std::size_t, huffman::num_symbols>{};
+    counts[0] = 1u;
+    counts[1] = 1u;
+    for (auto i = std::size_t{ 2 }; i < 40u; ++i)
+    {
+        counts[i] = counts[i - 1u] + counts[i - 2u];
+    }
+
+    auto const lengths = huffman::make_code_lengths(counts);
+    auto codes = std::array<huffman::code_t, huffman::num_symbols>{};
+    REQUIRE(huffman::make_codes(lengths, codes));
+
+    for (auto i = std::size_t{ 0 }; i < huffman::num_symbols; ++i)
+    {
+        REQUIRE(lengths[i] <= huffman::max_code_length);
+        REQUIRE((lengths[i] != 0u) == (counts[i] != 0u));
+    }
+}
+
+TEST_CASE("Huffman encode / decode")
+{
+    for (auto const size : { std::size_t{ 0 },
+                             std::size_t{ 1 },
+                             std::size_t{ 15 },
+                             std::size_t{ 100'000 } })
+    {
+        for (auto const num_values : { 1u, 2u, 5u, 256u })
+        {
+            auto input = std::vector<std::byte>{};
+            for (auto const r : random_samples(size, 64u))
+            {
+                input.push_back(
+                    static_cast<std::byte>(r < 48u ? 0u : r % num_values));
+            }
+
+            auto encoded = std::vector<std::byte>{};
+            huffman::encoder{}(input, encoded);
+
+            auto decoded = std::vector<std::byte>(size);
+            REQUIRE(huffman::decoder{}(encoded, decoded) == size);
+            REQUIRE(decoded == input);
+
+            if (size != 0u)
+            {
+                auto too_small = std::vector<std::byte>(size - 1u);
+                REQUIRE_THROWS_AS(huffman::decoder{}(encoded, too_small),
+                                  huffman::decode_error);
+
+                encoded.push_back(std::byte{ 0 });
+                REQUIRE_THROWS_AS(huffman::decoder{}(encoded, decoded),
+                                  huffman::decode_error);
+            }
+        }
+    }
+}
@@ -1,12 +1,18 @@
+#include <algorithm>
 #include <cstddef>
+#include <initializer_list>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <catch2/catch.hpp>
 
+#include <pa171/coding/chunked.hpp>
 #include <pa171/coding/lzw_decoder.hpp>
 #include <pa171/coding/lzw_encoder.hpp>
+#include <pa171/coding/lzw_preset.hpp>
 
 using namespace std::literals;
 
@@ -34,3 +40,281 @@ TEST_CASE("LZW encode / decode")
     decoder(encoded, std::back_inserter(decoded));
 
 }
+
+TEST_CASE("LZW encode / decode long matches with dictionary flushes")
+{
+    auto input = std::vector<std::byte>(1u << 18u);
+    for (auto i = std::size_t{ 0 }; i < input.size(); ++i)
+    {
+        input[i] = static_cast<std::byte>((i / 1000u) % 5u + (i % 7u == 0u));
+    }
+
+    auto encoder = lzw::encoder{
+        10u,
+        lzw::dynamic_code_size | lzw::flush_full_dict,
+    };
+
+    auto encoded = std::vector<std::byte>{};
+    encoder(input, std::back_inserter(encoded));
+
+    auto decoder = lzw::decoder{
+        10u,
+        lzw::dynamic_code_size | lzw::flush_full_dict,
+    };
+
+    auto decoded = std::vector<std::byte>{};
+    decoder(encoded, std::back_inserter(decoded));
+
+    REQUIRE(decoded == input);
+}
+
+TEST_CASE("LZW encode / decode into contiguous buffers")
+{
+    constexpr auto input = "TOBEORNOTTOBEORTOBEORNOT"sv;
+    auto const input_bytes = std::as_bytes(std::span{ input });
+
+    auto encoder = lzw::encoder{};
+
+    auto encoded_iterator = std::vector<std::byte>{};
+    encoder(input_bytes, std::back_inserter(encoded_iterator));
+
+    auto encoded = std::vector<std::byte>(
+      lzw::max_encoded_size(input_bytes.size(), lzw::default_code_size));
+    auto const encoded_end = encoder(input_bytes, encoded.data());
+    encoded.resize(static_cast<std::size_t>(encoded_end - encoded.data()));
+
+    REQUIRE(encoded == encoded_iterator);
+
+    auto decoder = lzw::decoder{};
+
+    auto decoded = std::vector<std::byte>(input_bytes.size());
+    auto const [_, decoded_end] = decoder(encoded, std::span{ decoded });
+
+    REQUIRE(decoded_end == decoded.data() + decoded.size());
+    REQUIRE(std::ranges::equal(decoded, input_bytes));
+
+    auto too_small = std::vector<std::byte>(input_bytes.size() - 1u);
+    REQUIRE_THROWS_AS(decoder(encoded, std::span{ too_small }),
+                      lzw::decode_error);
+}
+
+TEST_CASE("Chunked LZW coding does not depend on the thread count")
+{
+    constexpr auto chunk_size = std::size_t{ 1000 };
+
+    auto input = std::vector<std::byte>(10'500u);
+    for (auto i = std::size_t{ 0 }; i < input.size(); ++i)
+    {
+        input[i] = static_cast<std::byte>(i * i / 7u);
+    }
+
+    auto const encode = [&](std::size_t const num_threads)
+    {
+        auto encoders = std::vector<lzw::encoder>(num_threads);
+        auto chunk_buffers = std::vector<std::vector<std::byte>>{};
+        auto encoded = std::vector<std::byte>{};
+
+        pa171::coding::encode_chunked(
+            input,
+            chunk_size,
+            encoded,
+            chunk_buffers,
+            num_threads,
+            [&](std::size_t const worker_index,
+                std::span<std::byte const> const chunk,
+                std::vector<std::byte>& chunk_output)
+            {
+                chunk_output.clear();
+                encoders[worker_index](chunk, std::back_inserter(chunk_output));
+            });
+
+        return encoded;
+    };
+
+    auto const encoded = encode(1u);
+    REQUIRE(encode(4u) == encoded);
+
+    auto decoders = std::vector<lzw::decoder>(4u);
+    auto decoded = std::vector<std::byte>(input.size());
+
+    auto const decoded_size = pa171::coding::decode_chunked(
+        encoded,
+        chunk_size,
+        decoded,
+        4u,
+        [&](std::size_t const worker_index,
+            std::span<std::byte const> const chunk,
+            std::span<std::byte> const chunk_output)
+        {
+            auto const chunk_end = decoders[worker_index](chunk, chunk_output);
+            return static_cast<std::size_t>(chunk_end.second -
+                                            chunk_output.data());
+        });
+
+    REQUIRE(decoded_size == input.size());
+    REQUIRE(decoded == input);
+}
+
+TEST_CASE("LZW streaming encode / decode matches whole stream coding")
+{
+    auto input = std::vector<std::byte>(50'000u);
+    for (auto i = std::size_t{ 0 }; i < input.size(); ++i)
+    {
+        input[i] = static_cast<std::byte>((i / 300u) % 11u + (i % 13u == 0u));
+    }
+
+    auto encoder = lzw::encoder{ 12u };
+
+    auto encoded = std::vector<std::byte>{};
+    encoder(input, std::back_inserter(encoded));
+
+    // Feed the input in pieces of varying size
+    auto streamed = std::vector<std::byte>{};
+    for (auto offset = std::size_t{ 0 }, piece = std::size_t{ 1 };
+         offset < input.size();
+         offset += piece, piece = piece * 3u % 1021u)
+    {
+        encoder.feed(std::span{ input }.subspan(
+                       offset, std::min(piece, input.size() - offset)),
+                     std::back_inserter(streamed));
+    }
+    encoder.finish(std::back_inserter(streamed));
+
+    REQUIRE(streamed == encoded);
+
+    auto decoder = lzw::decoder{ 12u };
+
+    auto decoded = std::vector<std::byte>{};
+    for (auto offset = std::size_t{ 0 }, piece = std::size_t{ 1 };
+         offset < encoded.size();
+         offset += piece, piece = piece * 5u % 509u)
+    {
+        REQUIRE_FALSE(decoder.finished());
+        decoder.feed(std::span{ encoded }.subspan(
+                       offset, std::min(piece, encoded.size() - offset)),
+                     std::back_inserter(decoded));
+    }
+
+    REQUIRE(decoder.finished());
+    decoder.finish();
+
+    REQUIRE(decoded == input);
+}
+
+TEST_CASE("LZW adaptive reset recovers from a stale dictionary")
+{
+    // Two halves with unrelated content
+    auto input = std::vector<std::byte>(400'000u);
+    for (auto i = std::size_t{ 0 }; i < input.size(); ++i)
+    {
+        input[i] = i < input.size() / 2u
+                     ? static_cast<std::byte>(i * 7u % 13u)
+                     : static_cast<std::byte>(100u + (i / 5u) % 29u);
+    }
+
+    auto const encode = [&](lzw::options_t const options)
+    {
+        auto encoded = std::vector<std::byte>{};
+        lzw::encoder{ 12u, options }(input, std::back_inserter(encoded));
+
+        auto decoded = std::vector<std::byte>{};
+        lzw::decoder{ 12u, options }(encoded, std::back_inserter(decoded));
+        REQUIRE(decoded == input);
+
+        return encoded.size();
+    };
+
+    REQUIRE(encode(lzw::dynamic_code_size | lzw::adaptive_reset) <
+            encode(lzw::dynamic_code_size));
+
+    SECTION("Adaptive reset takes precedence over flushing a full dictionary")
+    {
+        auto const options = lzw::default_options | lzw::adaptive_reset;
+
+        auto encoder = lzw::encoder{ 12u, options };
+        auto encoded = std::vector<std::byte>{};
+        encoder(input, std::back_inserter(encoded));
+        REQUIRE(encoder.num_clears() > 0u);
+
+        auto decoded = std::vector<std::byte>{};
+        lzw::decoder{ 12u, options }(encoded, std::back_inserter(decoded));
+        REQUIRE(decoded == input);
+    }
+}
+
+TEST_CASE("LZW encode / decode with a preset dictionary")
+{
+    // Samples and input share most of their content
+    auto const make_image = [](std::size_t const seed)
+    {
+        auto image = std::vector<std::byte>(20'000u);
+        for (auto i = std::size_t{ 0 }; i < image.size(); ++i)
+        {
+            image[i] = static_cast<std::byte>(
+                (i % 61u) * 3u + (i * seed % 997u == 0u ? seed : 0u));
+        }
+        return image;
+    };
+
+    auto const sample_data = std::vector{ make_image(3u), make_image(5u) };
+    auto const samples = std::vector<std::span<std::byte const>>(
+        sample_data.begin(), sample_data.end());
+    auto const preset = std::make_shared<lzw::preset_dictionary>(
+        lzw::train_preset_dictionary(samples, 1000u));
+
+    REQUIRE(preset->entries().size() <= 1000u);
+    REQUIRE(preset->id() != 0u);
+
+    auto const input = make_image(7u);
+    auto const options = lzw::dynamic_code_size | lzw::flush_full_dict;
+
+    auto encoded = std::vector<std::byte>{};
+    lzw::encoder{ 12u, options, preset }(input, std::back_inserter(encoded));
+
+    auto decoded = std::vector<std::byte>{};
+    lzw::decoder{ 12u, options, preset }(encoded, std::back_inserter(decoded));
+    REQUIRE(decoded == input);
+
+    auto encoded_without_preset = std::vector<std::byte>{};
+    lzw::encoder{ 12u, options }(input,
+                                 std::back_inserter(encoded_without_preset));
+    REQUIRE(encoded.size() < encoded_without_preset.size());
+}
+
+TEST_CASE("LZW encode / decode with code point reuse")
+{
+    // Runs of a single byte (a chain of prefixes) between changing content
+    auto input = std::vector<std::byte>(300'000u);
+    for (auto i = std::size_t{ 0 }; i < input.size(); ++i)
+    {
+        input[i] = (i / 4096u) % 3u == 0u
+                     ? std::byte{ 42 }
+                     : static_cast<std::byte>((i * (i / 8192u + 3u)) % 37u);
+    }
+
+    auto const encode = [&](lzw::code_point_size_t const code_size,
+                            lzw::options_t const options)
+    {
+        auto encoded = std::vector<std::byte>{};
+        lzw::encoder{ code_size, options }(input, std::back_inserter(encoded));
+
+        auto decoded = std::vector<std::byte>{};
+        lzw::decoder{ code_size, options }(encoded,
+                                           std::back_inserter(decoded));
+        REQUIRE(decoded == input);
+
+        return encoded.size();
+    };
+
+    for (auto const options : std::initializer_list<lzw::options_t>{
+             lzw::reuse_code_points,
+             lzw::default_options | lzw::reuse_code_points,
+             lzw::default_options | lzw::reuse_code_points |
+                 lzw::adaptive_reset,
+         })
+    {
+        REQUIRE(encode(10u, options) < encode(10u, lzw::dynamic_code_size));
+    }
+
+    REQUIRE(encode(lzw::max_code_size, lzw::default_options) > 0u);
+}
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/quantization/haar_iwt.hpp>
+#include <pa171/transform/wavelet.hpp>
+#include <pa171/utils/view_2d.hpp>
+
+namespace quantization = pa171::quantization;
+namespace transform = pa171::transform;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::int16_t>
+{
+    auto samples = std::vector<std::int16_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = static_cast<std::int16_t>((seed >> 16u) % max);
+    }
+
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("Quantizing the subband runs matches quantizing the subbands")
+{
+    using quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+
+    // The longest wavelet, which raises the divisors of every subband
+    auto const wavelet = transform::scaled_db4_iwt<std::int16_t>;
+    auto const divisors = quantization::scaled_db4_iwt_divisors;
+
+    for (auto const& [width, height] :
+         { std::pair{ 17u, 5u }, std::pair{ 1u, 9u }, std::pair{ 9u, 1u } })
+    {
+        for (auto const num_iters :
+             { std::optional<std::size_t>{}, std::optional<std::size_t>{ 2u } })
+        {
+            for (auto const& [factor, alpha, beta] :
+                 { std::tuple{ 2, 2, 0 },
+                   std::tuple{ 32, 8, 0 },
+                   std::tuple{ 100, 3, 1 } })
+            {
+                auto image = random_samples(width * height, 256u);
+                auto const image_2d = pa171::view_2d{ image.begin(),
+                                                      width,
+                                                      height };
+                transform::recursive_2d_wavelet_transform<std::int16_t>{}
+                    .transform_in_place(image_2d, wavelet, num_iters);
+
+                auto subbands = std::vector<std::int16_t>{};
+                transform::recursive_2d_wavelet_transform<
+                    std::int16_t>::write_subbands(image_2d,
+                                                  std::back_inserter(subbands),
+                                                  num_iters);
+                auto expected = std::vector<std::int8_t>{};
+                quantizer{}(subbands,
+                            std::back_inserter(expected),
+                            width,
+                            height,
+                            factor,
+                            alpha,
+                            beta,
+                            num_iters,
+                            divisors);
+
+                auto const quantize_rows = quantizer::row_quantizer{
+                    width, height, factor, alpha, beta, num_iters, divisors
+                };
+                auto quantized = std::vector<std::int8_t>(expected.size());
+                transform::for_each_subband_run(
+                    image_2d,
+                    num_iters,
+                    [&](std::size_t const level,
+                        std::size_t const x,
+                        std::size_t const y,
+                        std::span<std::int16_t const> const values)
+                    {
+                        quantize_rows(level, x, y, values, quantized.begin());
+                    });
+                REQUIRE(quantized == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Dequantizing into the in-place inverse matches the subband order")
+{
+    using quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+    using inv_quantizer =
+        quantization::inv_haar_iwt<std::uint8_t, std::int16_t>;
+
+    auto const wavelet = transform::scaled_db4_iwt<std::int16_t>;
+    auto const divisors = quantization::scaled_db4_iwt_divisors;
+
+    for (auto const& [width, height] :
+         { std::pair{ 17u, 5u }, std::pair{ 1u, 9u }, std::pair{ 9u, 1u } })
+    {
+        for (auto const num_iters :
+             { std::optional<std::size_t>{}, std::optional<std::size_t>{ 2u } })
+        {
+            for (auto const& [factor, alpha, beta] :
+                 { std::tuple{ 2, 2, 0 },
+                   std::tuple{ 32, 8, 0 },
+                   std::tuple{ 100, 3, 1 } })
+            {
+                auto const image = random_samples(width * height, 256u);
+                auto subbands = std::vector<std::int16_t>{};
+                transform::recursive_2d_wavelet_transform<std::int16_t>{}(
+                    pa171::view_2d{ image.begin(), width, height },
+                    std::back_inserter(subbands),
+                    wavelet,
+                    num_iters);
+                auto quantized = std::vector<std::int8_t>{};
+                quantizer{}(subbands,
+                            std::back_inserter(quantized),
+                            width,
+                            height,
+                            factor,
+                            alpha,
+                            beta,
+                            num_iters,
+                            divisors);
+
+                auto dequantized = std::vector<std::int16_t>{};
+                inv_quantizer{}(quantized,
+                                std::back_inserter(dequantized),
+                                width,
+                                height,
+                                factor,
+                                alpha,
+                                beta,
+                                num_iters,
+                                divisors);
+                auto expected = std::vector<std::int16_t>(image.size());
+                transform::inv_recursive_2d_wavelet_transform<std::int16_t>{}(
+                    dequantized,
+                    pa171::view_2d{ expected.begin(), width, height },
+                    wavelet.inverse(),
+                    num_iters);
+
+                auto const dequantize_rows = inv_quantizer::row_dequantizer{
+                    width, height, factor, alpha, beta, num_iters, divisors
+                };
+                auto restored = std::vector<std::int16_t>(image.size());
+                auto const restored_2d = pa171::view_2d{ restored.begin(),
+                                                         width,
+                                                         height };
+                transform::for_each_subband_run(
+                    restored_2d,
+                    num_iters,
+                    [&](std::size_t const level,
+                        std::size_t const x,
+                        std::size_t const y,
+                        std::span<std::int16_t> const values)
+                    {
+                        dequantize_rows(
+                            level, x, y, values, quantized.cbegin());
+                    });
+                transform::inv_recursive_2d_wavelet_transform<std::int16_t>{}
+                    .transform_in_place(
+                        restored_2d, wavelet.inverse(), num_iters);
+                REQUIRE(restored == expected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Quantized wavelet coefficients round trip within a bound")
+{
+    using quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+    using inv_quantizer =
+        quantization::inv_haar_iwt<std::uint8_t, std::int16_t>;
+
+    constexpr auto width = std::size_t{ 32 };
+    constexpr auto height = std::size_t{ 16 };
+
+    // Noise, and extremes, which give the largest coefficients
+    auto images = std::vector{ random_samples(width * height, 256u),
+                               random_samples(width * height, 2u),
+                               std::vector<std::int16_t>(width * height) };
+    for (auto& sample : images[1])
+    {
+        sample = static_cast<std::int16_t>(sample * 255);
+    }
+    for (auto i = std::size_t{ 0 }; i < width * height; ++i)
+    {
+        images[2][i] = (i % width + i / width) % 2u == 0u ? 0 : 255;
+    }
+
+    // The smallest factor gives the largest quantized values
+    constexpr auto factor = 2;
+    constexpr auto alpha = 2;
+    constexpr auto beta = 0;
+
+    auto const max_error = [&](auto const& wavelet,
+                               quantization::min_divisors const divisors,
+                               std::vector<std::int16_t> const& image,
+                               std::optional<std::size_t> const num_iters)
+    {
+        auto subbands = std::vector<std::int16_t>{};
+        transform::recursive_2d_wavelet_transform<std::int16_t>{}(
+            pa171::view_2d{ image.begin(), width, height },
+            std::back_inserter(subbands),
+            wavelet,
+            num_iters);
+        auto quantized = std::vector<std::int8_t>{};
+        quantizer{}(subbands,
+                    std::back_inserter(quantized),
+                    width,
+                    height,
+                    factor,
+                    alpha,
+                    beta,
+                    num_iters,
+                    divisors);
+
+        auto dequantized = std::vector<std::int16_t>{};
+        inv_quantizer{}(quantized,
+                        std::back_inserter(dequantized),
+                        width,
+                        height,
+                        factor,
+                        alpha,
+                        beta,
+                        num_iters,
+                        divisors);
+        auto restored = std::vector<std::int16_t>(image.size());
+        transform::inv_recursive_2d_wavelet_transform<std::int16_t>{}(
+            dequantized,
+            pa171::view_2d{ restored.begin(), width, height },
+            wavelet.inverse(),
+            num_iters);
+
+        auto error = 0;
+        for (auto i = std::size_t{ 0 }; i < image.size(); ++i)
+        {
+            auto const value = std::clamp<int>(restored[i], 0, 255);
+            error = std::max(error, std::abs(value - image[i]));
+        }
+
+        return error;
+    };
+
+    // Bounds for these images; without their divisors, the coefficients of
+    // the scaled wavelets are clipped, and off by up to 128 (bior) and 53
+    // (db4)
+    auto const check = [&](auto const& wavelet,
+                           quantization::min_divisors const divisors,
+                           int const bound)
+    {
+        for (auto const boundary : { transform::boundary_extension::periodic,
+                                     transform::boundary_extension::symmetric })
+        {
+            for (auto const num_iters : { std::size_t{ 1 }, std::size_t{ 2 } })
+            {
+                for (auto const& image : images)
+                {
+                    REQUIRE(max_error(wavelet.with_boundary(boundary),
+                                      divisors,
+                                      image,
+                                      num_iters) <= bound);
+                }
+            }
+        }
+    };
+
+    check(transform::haar_iwt<std::int16_t>, {}, 4);
+    check(transform::scaled_bior_2_2_iwt<std::int16_t>,
+          quantization::scaled_bior_2_2_iwt_divisors,
+          24);
+    check(transform::scaled_db4_iwt<std::int16_t>,
+          quantization::scaled_db4_iwt_divisors,
+          16);
+}
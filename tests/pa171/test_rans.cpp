@@ -0,0 +1,117 @@
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/rans_decoder.hpp>
+#include <pa171/coding/rans_encoder.hpp>
+#include <pa171/coding/rans_interleaved_decoder.hpp>
+#include <pa171/coding/rans_interleaved_encoder.hpp>
+
+namespace rans = pa171::coding::rans;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("rANS encode / decode")
+{
+    // Sharply peaked around zero, like quantized detail coefficients
+    auto input = std::vector<std::byte>{};
+    for (auto const r : random_samples(100'000u, 64u))
+    {
+        input.push_back(
+            static_cast<std::byte>(r < 48u ? 0u : r < 60u ? r % 3u : r));
+    }
+
+    auto encoded = std::vector<std::byte>{};
+    rans::encoder{}(input, encoded);
+
+    REQUIRE(encoded.size() < input.size() / 2u);
+
+    auto decoded = std::vector<std::byte>(input.size());
+    REQUIRE(rans::decoder{}(encoded, decoded) == input.size());
+    REQUIRE(decoded == input);
+
+    auto too_small = std::vector<std::byte>(input.size() - 1u);
+    REQUIRE_THROWS_AS(rans::decoder{}(encoded, too_small), rans::decode_error);
+
+    encoded.pop_back();
+    REQUIRE_THROWS_AS(rans::decoder{}(encoded, decoded), rans::decode_error);
+}
+
+TEST_CASE("rANS encode / decode single symbol and empty inputs")
+{
+    for (auto const size :
+         { std::size_t{ 0 }, std::size_t{ 1 }, std::size_t{ 5000 } })
+    {
+        auto const input = std::vector<std::byte>(size, std::byte{ 7 });
+
+        auto encoded = std::vector<std::byte>{};
+        rans::encoder{}(input, encoded);
+
+        auto decoded = std::vector<std::byte>(size);
+        REQUIRE(rans::decoder{}(encoded, decoded) == size);
+        REQUIRE(decoded == input);
+    }
+}
+
+TEST_CASE("Interleaved rANS encode / decode")
+{
+    // Sizes around whole groups of lanes, one symbol and a single symbol
+    // value, so that both the vector and the scalar tail paths are covered
+    for (auto const size : { std::size_t{ 0 },
+                             std::size_t{ 1 },
+                             std::size_t{ 17 },
+                             std::size_t{ 4096 },
+                             std::size_t{ 100'003 } })
+    {
+        for (auto const num_values : { 1u, 3u, 200u })
+        {
+            auto input = std::vector<std::byte>{};
+            for (auto const r : random_samples(size, num_values))
+            {
+                input.push_back(
+                    static_cast<std::byte>(r % 2u == 0u ? r / 2u : r));
+            }
+
+            auto encoded = std::vector<std::byte>{};
+            rans::interleaved_encoder{}(input, encoded);
+
+            auto decoded = std::vector<std::byte>(size);
+            REQUIRE(rans::interleaved_decoder{}(encoded, decoded) == size);
+            REQUIRE(decoded == input);
+
+            auto scalar_decoded = std::vector<std::byte>(size);
+            REQUIRE(rans::interleaved_decoder{ false }(encoded,
+                                                       scalar_decoded) == size);
+            REQUIRE(scalar_decoded == input);
+
+            if (size != 0u)
+            {
+                encoded.pop_back();
+                REQUIRE_THROWS_AS(rans::interleaved_decoder{}(encoded, decoded),
+                                  rans::decode_error);
+            }
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/utils/saturate.hpp>
+
+TEST_CASE("Saturating to bytes matches clamping")
+{
+    using limits = std::numeric_limits<std::int16_t>;
+
+    auto input = std::vector<std::int16_t>{};
+    for (auto value = int{ limits::min() }; value <= limits::max(); ++value)
+    {
+        input.push_back(static_cast<std::int16_t>(value));
+    }
+
+    auto expected = std::vector<std::uint8_t>{};
+    for (auto const value : input)
+    {
+        expected.push_back(static_cast<std::uint8_t>(
+            std::clamp(value, std::int16_t{ 0 }, std::int16_t{ 255 })));
+    }
+
+    auto const check = [&](std::size_t const first, std::size_t const count)
+    {
+        auto const values = std::span{ input }.subspan(first, count);
+        auto const clamped = std::span{ expected }.subspan(first, count);
+
+        // The output starts as far off its alignment as the input
+        auto const shift = first % 2u;
+
+        for (auto const allow_simd : { false, true })
+        {
+            auto output = std::vector<std::uint8_t>(shift + count);
+            pa171::saturate_to_bytes(values, output.data() + shift, allow_simd);
+            REQUIRE(std::ranges::equal(
+                std::span{ output }.subspan(shift), clamped));
+        }
+    };
+
+    // Lengths around whole vectors of both kernels, starting on and off
+    // their alignment
+    for (auto const offset : { std::size_t{ 0 }, std::size_t{ 1 } })
+    {
+        check(offset, input.size() - offset);
+
+        for (auto const count : { 15u, 16u, 31u, 32u, 33u })
+        {
+            // Consecutive windows, so that every value is narrowed
+            for (auto first = offset; first + count <= input.size();
+                 first += count)
+            {
+                check(first, count);
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/subband_decoder.hpp>
+#include <pa171/coding/subband_encoder.hpp>
+#include <pa171/quantization/haar_iwt.hpp>
+
+namespace subband = pa171::coding::subband;
+namespace quantization = pa171::quantization;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+// Values shrinking towards the finer levels, like quantized details
+auto
+make_values(std::span<quantization::subband const> const subbands)
+    -> std::vector<std::byte>
+{
+    auto size = std::size_t{ 0 };
+    for (auto const& band : subbands)
+    {
+        size += band.size();
+    }
+
+    auto const samples = random_samples(size, 256u);
+    auto values = std::vector<std::byte>{};
+
+    for (auto const& band : subbands)
+    {
+        for (auto i = std::size_t{ 0 }; i < band.size(); ++i)
+        {
+            auto const r = static_cast<int>(samples[values.size()]);
+            auto const is_detail =
+                band.kind != quantization::subband_kind::approximation and
+                band.kind != quantization::subband_kind::samples;
+            auto const shift = 6u - std::min(band.level, std::size_t{ 6 });
+            auto const value = is_detail ? (r - 128) >> shift : r - 128;
+            values.push_back(static_cast<std::byte>(value));
+        }
+    }
+
+    return values;
+}
+
+} // namespace
+
+TEST_CASE("Subband encode / decode")
+{
+    using quantizer = quantization::haar_iwt<std::uint8_t, std::int16_t>;
+
+    for (auto const& [width, height, levels] :
+         { std::tuple{ 1u, 1u, std::optional<std::size_t>{} },
+           std::tuple{ 32u, 32u, std::optional<std::size_t>{} },
+           std::tuple{ 37u, 5u, std::optional<std::size_t>{} },
+           std::tuple{ 64u, 48u, std::optional<std::size_t>{ 2u } },
+           std::tuple{ 19u, 1u, std::optional<std::size_t>{ 0u } } })
+    {
+        // Two regions with the same layout
+        auto subbands = std::vector<quantization::subband>{};
+        quantizer::subbands(width, height, levels, subbands);
+        quantizer::subbands(width, height, levels, subbands);
+
+        auto size = std::size_t{ 0 };
+        for (auto const& band : subbands)
+        {
+            size += band.size();
+        }
+        REQUIRE(size == 2u * width * height);
+
+        auto const input = make_values(subbands);
+
+        auto encoded = std::vector<std::byte>{};
+        subband::encoder{}(input, subbands, encoded);
+
+        auto decoded = std::vector<std::byte>(input.size());
+        REQUIRE(subband::decoder{}(encoded, subbands, decoded) == input.size());
+        REQUIRE(decoded == input);
+
+        encoded.pop_back();
+        REQUIRE_THROWS_AS(subband::decoder{}(encoded, subbands, decoded),
+                          subband::decode_error);
+    }
+}
+
+TEST_CASE("Subband encode / decode samples")
+{
+    auto const subbands = std::vector<quantization::subband>{
+        { quantization::subband_kind::samples, 0u, 100u, 80u },
+    };
+
+    // A smooth gradient crossing the middle of the unsigned range
+    auto input = std::vector<std::byte>{};
+    for (auto y = 0u; y < 80u; ++y)
+    {
+        for (auto x = 0u; x < 100u; ++x)
+        {
+            input.push_back(static_cast<std::byte>(80u + x + y));
+        }
+    }
+
+    auto encoded = std::vector<std::byte>{};
+    subband::encoder{}(input, subbands, encoded);
+
+    REQUIRE(encoded.size() < input.size() / 8u);
+
+    auto decoded = std::vector<std::byte>(input.size());
+    REQUIRE(subband::decoder{}(encoded, subbands, decoded) == input.size());
+    REQUIRE(decoded == input);
+
+    auto const other_subbands = std::vector<quantization::subband>{
+        { quantization::subband_kind::samples, 0u, 100u, 79u },
+    };
+    REQUIRE_THROWS_AS(subband::decoder{}(encoded, other_subbands, decoded),
+                      subband::decode_error);
+}
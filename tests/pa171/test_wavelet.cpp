@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/transform/wavelet.hpp>
+#include <pa171/utils/view_2d.hpp>
+
+namespace transform = pa171::transform;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::int16_t>
+{
+    auto samples = std::vector<std::int16_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = static_cast<std::int16_t>((seed >> 16u) % max);
+    }
+
+    return samples;
+}
+
+// Checks that the wavelet gives the same results with and without SIMD
+// kernels, and that its inverse restores the input
+template<typename Wavelet>
+void check_wavelet(Wavelet const& wavelet, int const magnitude)
+{
+    auto const generic = wavelet.without_simd();
+
+    for (auto size = std::size_t{ 2 }; size < 100u; ++size)
+    {
+        auto input = random_samples(size, 2u * magnitude + 1u);
+        for (auto& value : input)
+        {
+            value = static_cast<std::int16_t>(value - magnitude);
+        }
+
+        auto approx = std::vector<std::int16_t>((size + 1u) / 2u);
+        auto detail = std::vector<std::int16_t>(size / 2u);
+        wavelet(input, approx.begin(), detail.begin());
+
+        auto generic_approx = std::vector<std::int16_t>(approx.size());
+        auto generic_detail = std::vector<std::int16_t>(detail.size());
+        generic(input, generic_approx.begin(), generic_detail.begin());
+        REQUIRE(approx == generic_approx);
+        REQUIRE(detail == generic_detail);
+
+        auto even = std::vector<std::int16_t>(approx.size());
+        auto odd = std::vector<std::int16_t>(detail.size());
+        wavelet.inverse()(approx, detail, even.begin(), odd.begin());
+
+        auto generic_even = std::vector<std::int16_t>(approx.size());
+        auto generic_odd = std::vector<std::int16_t>(detail.size());
+        generic.inverse()(
+            approx, detail, generic_even.begin(), generic_odd.begin());
+        REQUIRE(even == generic_even);
+        REQUIRE(odd == generic_odd);
+
+        for (auto i = std::size_t{ 0 }; i < size; ++i)
+        {
+            REQUIRE(input[i] == (i % 2u == 0u ? even[i / 2u] : odd[i / 2u]));
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("Integer wavelets match their generic lifting steps")
+{
+    using transform::boundary_extension;
+
+    for (auto const boundary :
+         { boundary_extension::periodic, boundary_extension::symmetric })
+    {
+        // The largest magnitude takes the db4 steps out of the int16_t range
+        for (auto const magnitude : { 1, 255, 4000, 32767 })
+        {
+            check_wavelet(
+                transform::haar_iwt<std::int16_t>.with_boundary(boundary),
+                magnitude);
+            check_wavelet(
+                transform::bior_2_2_iwt<std::int16_t>.with_boundary(boundary),
+                magnitude);
+            check_wavelet(
+                transform::db4_iwt<std::int16_t>.with_boundary(boundary),
+                magnitude);
+        }
+    }
+}
+
+TEST_CASE("Scaled integer wavelets are exactly invertible and keep the range")
+{
+    for (auto const magnitude : { 1, 255, 32767 })
+    {
+        check_wavelet(transform::scaled_bior_2_2_iwt<std::int16_t>, magnitude);
+        check_wavelet(transform::scaled_db4_iwt<std::int16_t>, magnitude);
+    }
+
+    // The approximation of a constant stays close to it, instead of growing
+    auto const constant = std::vector<std::int16_t>(32u, 200);
+    auto const keeps_range = [&](auto const& wavelet)
+    {
+        auto approx = std::vector<std::int16_t>(16u);
+        auto detail = std::vector<std::int16_t>(16u);
+        wavelet(constant, approx.begin(), detail.begin());
+
+        return std::ranges::all_of(approx,
+                                   [](std::int16_t const value)
+                                   { return std::abs(value - 200) <= 2; });
+    };
+
+    REQUIRE(keeps_range(transform::scaled_bior_2_2_iwt<std::int16_t>));
+    REQUIRE(keeps_range(transform::scaled_db4_iwt<std::int16_t>));
+}
+
+TEST_CASE("Column transforms match the 1D transform of each column")
+{
+    auto const wavelet = pa171::transform::bior_2_2_iwt<std::int16_t>;
+
+    for (auto const height : { 2u, 5u, 16u })
+    {
+        // Wide enough to have vectorised columns and some left over
+        auto const width = std::size_t{ 37 };
+
+        auto image = random_samples(width * height, 256u);
+
+        auto const input = image;
+        auto buffer = std::vector<std::int16_t>{};
+        wavelet.transform_columns(
+            pa171::view_2d{ image.begin(), width, height }, buffer);
+
+        auto column = std::vector<std::int16_t>(height);
+        auto approx = std::vector<std::int16_t>((height + 1u) / 2u);
+        auto detail = std::vector<std::int16_t>(height / 2u);
+        for (auto j = std::size_t{ 0 }; j < width; ++j)
+        {
+            for (auto i = std::size_t{ 0 }; i < height; ++i)
+            {
+                column[i] = input[i * width + j];
+            }
+
+            wavelet(column, approx.begin(), detail.begin());
+            for (auto i = std::size_t{ 0 }; i < height; ++i)
+            {
+                REQUIRE(image[i * width + j] ==
+                        (i < approx.size() ? approx[i]
+                                           : detail[i - approx.size()]));
+            }
+        }
+
+        wavelet.inverse().transform_columns(
+            pa171::view_2d{ image.begin(), width, height }, buffer);
+        REQUIRE(image == input);
+    }
+}
+
+TEST_CASE("In-place 2D transform lifts the columns, then the rows")
+{
+    auto const wavelet = pa171::transform::db4_iwt<std::int16_t>;
+
+    for (auto const& [width, height] :
+         { std::pair{ 45u, 23u }, std::pair{ 1u, 9u }, std::pair{ 8u, 1u } })
+    {
+        auto image = random_samples(width * height, 256u);
+
+        // One level with 1D transforms, each laid out as approximation then
+        // detail
+        auto expected = image;
+        auto const transform_1d = [&](std::size_t const first,
+                                      std::size_t const stride,
+                                      std::size_t const size)
+        {
+            if (size < 2u)
+            {
+                return;
+            }
+
+            auto signal = std::vector<std::int16_t>(size);
+            for (auto i = std::size_t{ 0 }; i < size; ++i)
+            {
+                signal[i] = expected[first + i * stride];
+            }
+
+            auto approx = std::vector<std::int16_t>((size + 1u) / 2u);
+            auto detail = std::vector<std::int16_t>(size / 2u);
+            wavelet(signal, approx.begin(), detail.begin());
+
+            for (auto i = std::size_t{ 0 }; i < size; ++i)
+            {
+                expected[first + i * stride] =
+                    i < approx.size() ? approx[i] : detail[i - approx.size()];
+            }
+        };
+
+        for (auto j = std::size_t{ 0 }; j < width; ++j)
+        {
+            transform_1d(j, width, height);
+        }
+
+        for (auto i = std::size_t{ 0 }; i < height; ++i)
+        {
+            transform_1d(i * width, 1u, width);
+        }
+
+        auto transform =
+            pa171::transform::recursive_2d_wavelet_transform<std::int16_t>{};
+        transform.transform_in_place(
+            pa171::view_2d{ image.begin(), width, height }, wavelet, 1u);
+        REQUIRE(image == expected);
+    }
+}
+
+TEST_CASE("In-place inverse 2D transform restores the in-place transform")
+{
+    auto const wavelet = transform::db4_iwt<std::int16_t>;
+
+    for (auto const& [width, height] :
+         { std::pair{ 45u, 23u }, std::pair{ 1u, 9u }, std::pair{ 8u, 1u } })
+    {
+        for (auto const num_iters :
+             { std::optional<std::size_t>{}, std::optional<std::size_t>{ 2u } })
+        {
+            auto image = random_samples(width * height, 256u);
+
+            auto const input = image;
+            auto forward =
+                transform::recursive_2d_wavelet_transform<std::int16_t>{};
+            forward.transform_in_place(
+                pa171::view_2d{ image.begin(), width, height },
+                wavelet,
+                num_iters);
+
+            auto inverse =
+                transform::inv_recursive_2d_wavelet_transform<std::int16_t>{};
+            inverse.transform_in_place(
+                pa171::view_2d{ image.begin(), width, height },
+                wavelet.inverse(),
+                num_iters);
+            REQUIRE(image == input);
+        }
+    }
+}
+
+TEST_CASE("Streaming 2D transform matches the in-place one")
+{
+    auto const check = [](auto const& wavelet)
+    {
+        for (auto const& [width, height] : { std::pair{ 37u, 29u },
+                                             std::pair{ 16u, 64u },
+                                             std::pair{ 3u, 2u },
+                                             std::pair{ 1u, 7u },
+                                             std::pair{ 6u, 1u } })
+        {
+            for (auto const num_iters :
+                 { std::optional<std::size_t>{},
+                   std::optional<std::size_t>{ 2u } })
+            {
+                auto image = random_samples(width * height, 256u);
+
+                auto result = std::vector<std::int16_t>(image.size());
+                auto written = std::vector<int>(image.size());
+                auto streaming = transform::streaming_2d_wavelet_transform{
+                    wavelet,
+                    width,
+                    height,
+                    num_iters,
+                    [&](std::size_t /*level*/,
+                        std::size_t const x,
+                        std::size_t const y,
+                        std::span<std::int16_t const> const values)
+                    {
+                        for (auto c = std::size_t{ 0 }; c < values.size(); ++c)
+                        {
+                            result[y * width + x + c] = values[c];
+                            ++written[y * width + x + c];
+                        }
+                    }
+                };
+
+                for (auto i = std::size_t{ 0 }; i < height; ++i)
+                {
+                    streaming.push_row(
+                        std::span{ image }.subspan(i * width, width));
+                }
+
+                auto transform =
+                    transform::recursive_2d_wavelet_transform<std::int16_t>{};
+                transform.transform_in_place(
+                    pa171::view_2d{ image.begin(), width, height },
+                    wavelet,
+                    num_iters);
+
+                REQUIRE(result == image);
+                REQUIRE(std::ranges::all_of(
+                    written, [](int const count) { return count == 1; }));
+            }
+        }
+    };
+
+    using transform::boundary_extension;
+
+    for (auto const boundary :
+         { boundary_extension::periodic, boundary_extension::symmetric })
+    {
+        check(transform::haar_iwt<std::int16_t>.with_boundary(boundary));
+        check(transform::db4_iwt<std::int16_t>.with_boundary(boundary));
+        check(transform::bior_2_2_iwt<std::int16_t>.with_boundary(boundary));
+    }
+}
+
+TEST_CASE("Subband runs of the in-place layout match the streaming ones")
+{
+    auto const wavelet = transform::haar_iwt<std::int16_t>;
+
+    for (auto const& [width, height] :
+         { std::pair{ 37u, 29u }, std::pair{ 1u, 7u }, std::pair{ 6u, 1u } })
+    {
+        for (auto const num_iters :
+             { std::optional<std::size_t>{}, std::optional<std::size_t>{ 2u } })
+        {
+            auto image = random_samples(width * height, 256u);
+
+            // The level of each value, as given with its run
+            auto const record = [&](std::vector<int>& levels)
+            {
+                return [&](std::size_t const level,
+                           std::size_t const x,
+                           std::size_t const y,
+                           std::span<std::int16_t const> const values)
+                {
+                    for (auto c = std::size_t{ 0 }; c < values.size(); ++c)
+                    {
+                        REQUIRE(levels[y * width + x + c] == -1);
+                        levels[y * width + x + c] = static_cast<int>(level);
+                    }
+                };
+            };
+
+            auto streaming_levels = std::vector<int>(image.size(), -1);
+            auto streaming = transform::streaming_2d_wavelet_transform{
+                wavelet, width, height, num_iters, record(streaming_levels)
+            };
+            for (auto i = std::size_t{ 0 }; i < height; ++i)
+            {
+                streaming.push_row(
+                    std::span{ image }.subspan(i * width, width));
+            }
+
+            auto in_place_levels = std::vector<int>(image.size(), -1);
+            auto in_place =
+                transform::recursive_2d_wavelet_transform<std::int16_t>{};
+            in_place.transform_in_place(
+                pa171::view_2d{ image.begin(), width, height },
+                wavelet,
+                num_iters);
+            transform::for_each_subband_run(
+                pa171::view_2d{ image.begin(), width, height },
+                num_iters,
+                record(in_place_levels));
+
+            REQUIRE(in_place_levels == streaming_levels);
+        }
+    }
+}
+
+TEST_CASE("Symmetric extension keeps the details of a ramp small at its ends")
+{
+    auto const wavelet = transform::bior_2_2_iwt<std::int16_t>;
+
+    for (auto const size : { 32u, 33u })
+    {
+        auto ramp = std::vector<std::int16_t>(size);
+        for (auto i = std::size_t{ 0 }; i < size; ++i)
+        {
+            ramp[i] = static_cast<std::int16_t>(4u * i);
+        }
+
+        auto const max_detail = [&](auto const& transform)
+        {
+            auto approx = std::vector<std::int16_t>((size + 1u) / 2u);
+            auto detail = std::vector<std::int16_t>(size / 2u);
+            transform(ramp, approx.begin(), detail.begin());
+
+            return std::ranges::max(detail | std::views::transform(
+                                                 [](std::int16_t const value)
+                                                 { return std::abs(value); }));
+        };
+
+        REQUIRE(max_detail(wavelet) > 16);
+        REQUIRE(max_detail(wavelet.with_boundary(
+                    transform::boundary_extension::symmetric)) <= 8);
+    }
+}
+
+TEST_CASE("Parallel 2D transforms match the serial ones")
+{
+    auto const wavelet = transform::bior_2_2_iwt<std::int16_t>;
+
+    for (auto const& [width, height] :
+         { std::pair{ 300u, 250u }, std::pair{ 517u, 389u } })
+    {
+        auto image = random_samples(width * height, 256u);
+
+        auto serial = std::vector<std::int16_t>(image.size());
+        auto parallel = std::vector<std::int16_t>(image.size());
+        auto transform =
+            transform::recursive_2d_wavelet_transform<std::int16_t>{};
+        transform(pa171::view_2d{ image.cbegin(), width, height },
+                  serial.begin(),
+                  wavelet);
+        transform(pa171::view_2d{ image.cbegin(), width, height },
+                  parallel.begin(),
+                  wavelet,
+                  std::nullopt,
+                  4u);
+        REQUIRE(parallel == serial);
+
+        auto restored = std::vector<std::int16_t>(image.size());
+        auto inverse =
+            transform::inv_recursive_2d_wavelet_transform<std::int16_t>{};
+        inverse(parallel,
+                pa171::view_2d{ restored.begin(), width, height },
+                wavelet.inverse(),
+                std::nullopt,
+                4u);
+        REQUIRE(restored == image);
+    }
+}
@@ -0,0 +1,71 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <pa171/coding/zero_run.hpp>
+
+namespace zero_run = pa171::coding::zero_run;
+
+namespace
+{
+
+// Pseudo-random samples in [0, max), the same sequence on every platform
+auto
+random_samples(std::size_t const size, std::uint32_t const max)
+    -> std::vector<std::uint32_t>
+{
+    auto samples = std::vector<std::uint32_t>(size);
+    auto seed = std::uint32_t{ 1 };
+    for (auto& sample : samples)
+    {
+        seed = seed * 1103515245u + 12345u;
+        sample = (seed >> 16u) % max;
+    }
+
+    return samples;
+}
+
+} // namespace
+
+TEST_CASE("Zero run encode / decode")
+{
+    for (auto const size : { std::size_t{ 0 },
+                             std::size_t{ 1 },
+                             std::size_t{ 200 },
+                             std::size_t{ 100'000 } })
+    {
+        for (auto const zeros_in_64 : { 0u, 32u, 63u, 64u })
+        {
+            auto input = std::vector<std::byte>{};
+            for (auto const r : random_samples(size, 64u))
+            {
+                input.push_back(
+                    static_cast<std::byte>(r < zeros_in_64 ? 0u : r + 1u));
+            }
+
+            auto encoded = std::vector<std::byte>{};
+            zero_run::encode(input, encoded);
+            REQUIRE(encoded.size() <= zero_run::max_encoded_size(size));
+
+            auto decoded = std::vector<std::byte>(size);
+            REQUIRE(zero_run::decode(encoded, decoded) == size);
+            REQUIRE(decoded == input);
+
+            if (size != 0u)
+            {
+                auto too_small = std::vector<std::byte>(size - 1u);
+                REQUIRE_THROWS_AS(zero_run::decode(encoded, too_small),
+                                  zero_run::decode_error);
+            }
+        }
+    }
+
+    // A run length must not be cut off
+    auto const truncated = std::vector<std::byte>{ std::byte{ 0 },
+                                                   std::byte{ 0x80 } };
+    auto decoded = std::vector<std::byte>(1000);
+    REQUIRE_THROWS_AS(zero_run::decode(truncated, decoded),
+                      zero_run::decode_error);
+}